@@ -0,0 +1,296 @@
+/**
+ * Multi-pattern keyword search, Aho-Corasick automaton.
+ *
+ * The automaton is a complete DFA stored as one flat table of
+ * states x byte classes. Bytes that occur in no pattern share class 0,
+ * so a row is usually a few dozen entries instead of 256. Entries hold
+ * the row offset of the next state, with AC_OUT set when that state
+ * ends at least one pattern, so the search loop is one load per byte.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <charset.h>
+#include <dispatch.h>
+#include <ahocorasick.h>
+
+//#define ASSERT(cond)
+#define ASSERT(cond) assert(cond)
+
+#define AC_OUT  (0x80000000u)
+#define AC_NONE (0xFFFFFFFFu)
+
+// Skip ahead with the vector set span while in the root state when the
+// patterns start with at most this many distinct bytes.
+#define AC_PREFILTER_MAX_FIRST (16)
+
+struct ms_ac {
+  uint32_t *delta;        // states x classes, row offset | AC_OUT
+  uint32_t *out;          // per state, last pattern ending there
+  uint32_t *dict;         // per state, next state on fail chain with output
+  uint32_t *same;         // per pattern, previous pattern with same text
+  size_t *lens;           // per pattern, length
+  size_t count;           // number of patterns
+  uint32_t classes;       // byte classes, row length
+  int prefilter;          // skip to first bytes in root state
+  ms_charset first;       // first bytes of all patterns
+  unsigned char cls[256]; // byte class of every byte value
+};
+
+//----------------------------------------------------------------------
+/**
+ * Free matcher
+ *
+ * @param ac  Matcher, may be NULL
+ */
+void ms_ac_destroy(ms_ac *ac)
+{
+  if (ac) {
+    free(ac->delta);
+    free(ac->out);
+    free(ac->dict);
+    free(ac->same);
+    free(ac->lens);
+    free(ac);
+  }
+}
+
+//----------------------------------------------------------------------
+/**
+ * Build matcher from keyword list
+ *
+ * @param patterns  Keywords, may contain any byte when lens is given
+ * @param lens      Keyword lengths, NULL if keywords are zero terminated
+ * @param count     Number of keywords
+ *
+ * @return Matcher, NULL if out of memory. Empty keywords never match.
+ */
+ms_ac * ms_ac_create(const char * const *patterns, const size_t *lens, size_t count)
+{
+  unsigned char used[256] = { 0 };
+  uint32_t *fail  = NULL;
+  uint32_t *queue = NULL;
+  uint32_t states = 1;
+  uint32_t head   = 0;
+  uint32_t tail   = 0;
+  size_t first_bytes = 0;
+  size_t total = 1;
+  size_t i;
+  size_t k;
+  ms_ac *ac;
+
+  ASSERT(patterns || !count);
+
+  ac = (ms_ac *) calloc(1, sizeof(*ac));
+  if (!ac) {
+    return NULL;
+  }
+  ac->count = count;
+  ac->lens  = (size_t *) malloc((count ? count : 1) * sizeof(size_t));
+  ac->same  = (uint32_t *) malloc((count ? count : 1) * sizeof(uint32_t));
+  if (!ac->lens || !ac->same || (count >= AC_NONE)) {
+    goto fail;
+  }
+
+  // byte classes, and an upper bound of the number of states
+  ms_charset_init(&ac->first, "");
+  for (i = 0; i < count; i++) {
+    const unsigned char *p = (const unsigned char *) patterns[i];
+
+    ac->lens[i] = lens ? lens[i] : __ms_string_ops.strlen(patterns[i]);
+    total += ac->lens[i];
+    for (k = 0; k < ac->lens[i]; k++) {
+      used[p[k]] = 1;
+    }
+    if (ac->lens[i] && !MS_CHARSET_HAS(&ac->first, p[0])) {
+      ms_charset_add(&ac->first, p[0]);
+      first_bytes++;
+    }
+  }
+  ac->classes = 1;
+  for (i = 0; i < 256; i++) {
+    ac->cls[i] = used[i] ? (unsigned char) ac->classes++ : 0;
+  }
+  ac->prefilter = (first_bytes <= AC_PREFILTER_MAX_FIRST);
+
+  // row offsets must fit beside the output flag
+  if (total > (AC_OUT - 1) / ac->classes) {
+    goto fail;
+  }
+  ac->delta = (uint32_t *) malloc(total * ac->classes * sizeof(uint32_t));
+  ac->out   = (uint32_t *) malloc(total * sizeof(uint32_t));
+  ac->dict  = (uint32_t *) malloc(total * sizeof(uint32_t));
+  fail      = (uint32_t *) malloc(total * sizeof(uint32_t));
+  queue     = (uint32_t *) malloc(total * sizeof(uint32_t));
+  if (!ac->delta || !ac->out || !ac->dict || !fail || !queue) {
+    goto fail;
+  }
+  for (i = 0; i < total * ac->classes; i++) {
+    ac->delta[i] = AC_NONE;
+  }
+  for (i = 0; i < total; i++) {
+    ac->out[i]  = AC_NONE;
+    ac->dict[i] = AC_NONE;
+  }
+
+  // trie
+  for (i = 0; i < count; i++) {
+    const unsigned char *p = (const unsigned char *) patterns[i];
+    uint32_t s = 0;
+
+    if (ac->lens[i] == 0) {
+      ac->same[i] = AC_NONE;
+      continue;
+    }
+    for (k = 0; k < ac->lens[i]; k++) {
+      uint32_t *t = &ac->delta[s * ac->classes + ac->cls[p[k]]];
+      if (*t == AC_NONE) {
+        *t = states++;
+      }
+      s = *t;
+    }
+    ac->same[i] = ac->out[s];
+    ac->out[s]  = (uint32_t) i;
+  }
+
+  // fail links breadth first, completing the rows into a DFA on the way
+  for (k = 0; k < ac->classes; k++) {
+    uint32_t v = ac->delta[k];
+    if (v == AC_NONE) {
+      ac->delta[k] = 0;
+    }
+    else {
+      fail[v] = 0;
+      queue[tail++] = v;
+    }
+  }
+  while (head < tail) {
+    uint32_t u = queue[head++];
+
+    for (k = 0; k < ac->classes; k++) {
+      uint32_t v = ac->delta[u * ac->classes + k];
+      uint32_t f = ac->delta[fail[u] * ac->classes + k];
+
+      if (v == AC_NONE) {
+        ac->delta[u * ac->classes + k] = f;
+      }
+      else {
+        fail[v] = f;
+        ac->dict[v] = (ac->out[f] != AC_NONE) ? f : ac->dict[f];
+        queue[tail++] = v;
+      }
+    }
+  }
+
+  // states to row offsets, flag states with output
+  for (i = 0; i < states * ac->classes; i++) {
+    uint32_t t = ac->delta[i];
+    ac->delta[i] = (t * ac->classes) |
+      (((ac->out[t] != AC_NONE) || (ac->dict[t] != AC_NONE)) ? AC_OUT : 0);
+  }
+
+  // give back the rows of the upper bound that were not needed
+  if (states < total) {
+    uint32_t *shrunk = (uint32_t *) realloc(ac->delta, states * ac->classes * sizeof(uint32_t));
+    if (shrunk) {
+      ac->delta = shrunk;
+    }
+  }
+
+  free(fail);
+  free(queue);
+  return ac;
+
+fail:
+  free(fail);
+  free(queue);
+  ms_ac_destroy(ac);
+  return NULL;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Report all patterns ending in a state
+ *
+ * @param ac     Matcher
+ * @param s      Entry of the state, row offset | AC_OUT
+ * @param end    Offset just past the last matched byte
+ * @param found  Number of matches, updated
+ * @param cb     Callback, may be NULL
+ * @param ctx    Callback context
+ *
+ * @return Non-zero if callback asked to stop
+ */
+static int __ac_report(const ms_ac *ac, uint32_t s, size_t end, size_t *found,
+                       ms_ac_callback cb, void *ctx)
+{
+  uint32_t t;
+  uint32_t id;
+
+  for (t = (s & ~AC_OUT) / ac->classes; t != AC_NONE; t = ac->dict[t]) {
+    for (id = ac->out[t]; id != AC_NONE; id = ac->same[id]) {
+      (*found)++;
+      if (cb && cb(ctx, id, end - ac->lens[id])) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Find all occurrences of all patterns in one pass
+ *
+ * @param ac   Matcher
+ * @param buf  Buffer to search, need not be zero terminated
+ * @param len  Buffer length
+ * @param cb   Called for every match in order of match end, may be NULL
+ * @param ctx  Passed to cb
+ *
+ * @return Number of matches reported
+ */
+size_t ms_ac_search(const ms_ac *ac, const char *buf, size_t len,
+                    ms_ac_callback cb, void *ctx)
+{
+  const unsigned char *p   = (const unsigned char *) buf;
+  const unsigned char *end = p + len;
+  const uint32_t *delta;
+  size_t found = 0;
+  uint32_t s = 0;
+
+  ASSERT(ac);
+  ASSERT(buf || !len);
+
+  delta = ac->delta;
+
+  if (ac->prefilter) {
+    while (p < end) {
+      // in root no match is in progress, jump to the next possible start
+      if (s == 0) {
+        p += __ms_string_ops.span_set_n((const char *) p, (size_t)(end - p), &ac->first, 0);
+        if (p == end) {
+          break;
+        }
+      }
+      s = delta[(s & ~AC_OUT) + ac->cls[*p++]];
+      if ((s & AC_OUT) &&
+          __ac_report(ac, s, (size_t)(p - (const unsigned char *) buf), &found, cb, ctx)) {
+        break;
+      }
+    }
+  }
+  else {
+    while (p < end) {
+      s = delta[(s & ~AC_OUT) + ac->cls[*p++]];
+      if ((s & AC_OUT) &&
+          __ac_report(ac, s, (size_t)(p - (const unsigned char *) buf), &found, cb, ctx)) {
+        break;
+      }
+    }
+  }
+  return found;
+}
@@ -0,0 +1,29 @@
+#ifndef _AHOCORASICK_H_
+#define _AHOCORASICK_H_
+
+#include <stddef.h>
+
+/**
+ * Compiled multi-pattern matcher (Aho-Corasick automaton).
+ * Build once from a keyword list, then search any number of buffers;
+ * a built matcher is read-only and can be shared between threads.
+ */
+typedef struct ms_ac ms_ac;
+
+/**
+ * Match callback
+ *
+ * @param ctx         User context passed to ms_ac_search()
+ * @param pattern_id  Index of the pattern in the build list
+ * @param offset      Offset of the first matched byte in the buffer
+ *
+ * @return 0 to continue searching, non-zero to stop
+ */
+typedef int (*ms_ac_callback)(void *ctx, size_t pattern_id, size_t offset);
+
+ms_ac * ms_ac_create(const char * const *patterns, const size_t *lens, size_t count);
+void ms_ac_destroy(ms_ac *ac);
+size_t ms_ac_search(const ms_ac *ac, const char *buf, size_t len,
+                    ms_ac_callback cb, void *ctx);
+
+#endif /* _AHOCORASICK_H_ */
@@ -0,0 +1,76 @@
+#ifndef _ASCII_H_
+#define _ASCII_H_
+
+/**
+ * Internal locale-free ASCII character classification and case mapping.
+ * Bytes 0x80-0xFF belong to no class and map to themselves, whatever
+ * the process locale is. Everything is inline and branch-free: classes
+ * are one load from a flag table, digits and case mapping are plain
+ * arithmetic so loops using them can be vectorized.
+ */
+
+#include <stdint.h>
+
+#define MS_ASCII_SPACE  (0x01) // ' ', '\t', '\n', '\v', '\f', '\r'
+#define MS_ASCII_DIGIT  (0x02) // '0'-'9'
+#define MS_ASCII_XDIGIT (0x04) // '0'-'9', 'A'-'F', 'a'-'f'
+#define MS_ASCII_UPPER  (0x08) // 'A'-'Z'
+#define MS_ASCII_LOWER  (0x10) // 'a'-'z'
+#define MS_ASCII_ALPHA  (MS_ASCII_UPPER | MS_ASCII_LOWER)
+#define MS_ASCII_ALNUM  (MS_ASCII_ALPHA | MS_ASCII_DIGIT)
+
+// MS_ASCII_* flags of every byte value
+extern const uint8_t __ms_ascii_class[256];
+// value of every hex digit, 0xFF for all other bytes
+extern const uint8_t __ms_ascii_xvalue[256];
+
+static inline int __ascii_is(int c, unsigned int cls)
+{
+  return __ms_ascii_class[(unsigned char) c] & cls;
+}
+
+static inline int __ascii_isspace(int c)
+{
+  return __ascii_is(c, MS_ASCII_SPACE);
+}
+
+static inline int __ascii_isdigit(int c)
+{
+  return (unsigned int)((unsigned char) c - '0') < 10;
+}
+
+static inline int __ascii_isxdigit(int c)
+{
+  return __ascii_is(c, MS_ASCII_XDIGIT);
+}
+
+static inline int __ascii_isalnum(int c)
+{
+  return __ascii_is(c, MS_ASCII_ALNUM);
+}
+
+/**
+ * Value of a hex digit
+ *
+ * @param c  Character
+ *
+ * @return Value 0 to 15, 0xFF if not a hex digit
+ */
+static inline unsigned int __ascii_xvalue(int c)
+{
+  return __ms_ascii_xvalue[(unsigned char) c];
+}
+
+static inline int __ascii_tolower(int c)
+{
+  c = (unsigned char) c;
+  return c | (((unsigned int)(c - 'A') < 26) << 5);
+}
+
+static inline int __ascii_toupper(int c)
+{
+  c = (unsigned char) c;
+  return c & ~(((unsigned int)(c - 'a') < 26) << 5);
+}
+
+#endif /* _ASCII_H_ */
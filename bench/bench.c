@@ -0,0 +1,989 @@
+/**
+ * Microbenchmarks of every function in string.h, printf.h and scanf.h,
+ * side by side with the host libc where it has the same function, and
+ * of the column parsers against the strtoull()/strtod() loop they replace.
+ *
+ * The library is linked statically, so its functions replace the libc
+ * ones for the whole program. The libc versions are looked up with
+ * dlsym(RTLD_NEXT, name), which skips the program and finds libc.
+ *
+ * Usage: ms_bench [--quick] [--full] [--ms <per point>] [--filter <name>]
+ *                 [--csv <file>] [--json <file>]
+ *
+ * A table is written to stderr, results to the --csv/--json files.
+ * stdout is left to the functions under test.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include <string.h>
+#include <printf.h>
+#include <scanf.h>
+#include <column.h>
+#include <itoa.h>
+#include <dtoa.h>
+#include <codec.h>
+
+//----------------------------------------------------------------------
+// Buffers, large enough for the biggest length plus alignment slack
+
+#define BENCH_MAX_LEN (1 << 20)
+#define BENCH_SLACK   (4096)
+
+static char buf_src[BENCH_MAX_LEN + BENCH_SLACK];
+static char buf_src2[BENCH_MAX_LEN + BENCH_SLACK];
+static char buf_dst[2 * BENCH_MAX_LEN + BENCH_SLACK];
+static char buf_work[BENCH_MAX_LEN + BENCH_SLACK];
+
+// Column output, at most one field per two bytes
+static uint64_t col_u64[BENCH_MAX_LEN / 2 + 1];
+static int64_t  col_i64[BENCH_MAX_LEN / 2 + 1];
+static double   col_f64[BENCH_MAX_LEN / 2 + 1];
+
+// Set members, more than the span functions compare directly
+#define BENCH_SET     "abcdefgh"
+#define BENCH_OUTSIDE 'z'
+#define BENCH_DELIMS  " ,;\t"
+
+//----------------------------------------------------------------------
+/**
+ * Input of one measured call
+ */
+struct bench_arg {
+  char *dst;            // destination buffer
+  const char *src;      // source, haystack or first string
+  const char *src2;     // needle or second string
+  size_t len;           // length of src
+  size_t len2;          // length of src2
+  int c;                // searched byte
+  const char *chars;    // character set as string
+  ms_charset *set;      // character set compiled
+  char *work;           // scratch copy for destructive functions
+  void *libc;           // host libc version of the function
+  void *(*reset)(void *, const void *, size_t); // host memcpy, resets work
+};
+
+typedef size_t (*bench_fn)(const struct bench_arg *a);
+
+// Input shapes, what the grid parameters mean for a function
+enum bench_shape {
+  SHAPE_STR,        // string of len, c at pos
+  SHAPE_MEM,        // memory of len, c at pos
+  SHAPE_CMP,        // two strings of len, first difference at pos
+  SHAPE_COPY,       // copy string of len into dst
+  SHAPE_SEARCH,     // haystack of len, needle at pos
+  SHAPE_SPAN_IN,    // run of set members, non-member at pos
+  SHAPE_SPAN_OUT,   // run of non-members, member at pos
+  SHAPE_TOKENS,     // words of 7 characters and a delimiter
+  SHAPE_FMT_STR,    // %s argument of len
+  SHAPE_NUM_INT,    // fixed integer texts
+  SHAPE_NUM_FLOAT,  // fixed floating-point texts
+  SHAPE_COL_INT,    // integers separated by commas and newlines
+  SHAPE_COL_FLOAT,  // decimal fractions separated by commas and newlines
+  SHAPE_HEX,        // hex digits of len
+  SHAPE_BASE64,     // base64 text of len rounded down to groups
+  SHAPE_FIXED       // no input, fixed arguments
+};
+
+//----------------------------------------------------------------------
+// Call wrappers. Each function gets two: one calling the library and one
+// calling the libc version through the same type, from a single call
+// expression in which f is the function.
+
+#define BENCH(id, fn, call)                                          \
+  static size_t ms_##id(const struct bench_arg *a)                   \
+  {                                                                  \
+    __typeof__(&fn) f = fn;                                          \
+    (void) f;                                                        \
+    return (size_t)(call);                                           \
+  }                                                                  \
+  static size_t lc_##id(const struct bench_arg *a)                   \
+  {                                                                  \
+    __typeof__(&fn) f = (__typeof__(&fn)) a->libc;                   \
+    return (size_t)(call);                                           \
+  }
+
+// library only, no libc counterpart
+#define BENCH_MS(id, fn, call)                                       \
+  static size_t ms_##id(const struct bench_arg *a)                   \
+  {                                                                  \
+    __typeof__(&fn) f = fn;                                          \
+    (void) f;                                                        \
+    return (size_t)(call);                                           \
+  }
+
+BENCH(memchr,      memchr,      f(a->src, a->c, a->len))
+BENCH(memrchr,     memrchr,     f(a->src, a->c, a->len))
+BENCH(memmem,      memmem,      f(a->src, a->len, a->src2, a->len2))
+BENCH(memcpy,      memcpy,      f(a->dst, a->src, a->len))
+BENCH(memmove,     memmove,     f(a->dst, a->src, a->len))
+BENCH(memset,      memset,      f(a->dst, a->c, a->len))
+BENCH(memcmp,      memcmp,      f(a->src, a->src2, a->len))
+BENCH(strcmp,      strcmp,      f(a->src, a->src2))
+BENCH(strncmp,     strncmp,     f(a->src, a->src2, a->len))
+BENCH(strlen,      strlen,      f(a->src))
+BENCH(strnlen,     strnlen,     f(a->src, a->len))
+BENCH(strstr,      strstr,      f(a->src, a->src2))
+BENCH(strchr,      strchr,      f(a->src, a->c))
+BENCH(strchrnul,   strchrnul,   f(a->src, a->c))
+BENCH_MS(strnchr,  strnchr,     f(a->src, a->len, a->c))
+BENCH(strrchr,     strrchr,     f(a->src, a->c))
+BENCH(strcat,      strcat,      (a->dst[0] = '\0', f(a->dst, a->src)))
+BENCH(strncat,     strncat,     (a->dst[0] = '\0', f(a->dst, a->src, a->len)))
+BENCH(strcpy,      strcpy,      f(a->dst, a->src))
+BENCH(stpcpy,      stpcpy,      f(a->dst, a->src))
+BENCH(stpncpy,     stpncpy,     f(a->dst, a->src, a->len))
+BENCH(strlcpy,     strlcpy,     f(a->dst, a->src, a->len + 1))
+BENCH(strlcat,     strlcat,     (a->dst[0] = '\0', f(a->dst, a->src, a->len + 1)))
+BENCH(strncasecmp, strncasecmp, f(a->src, a->src2, a->len))
+BENCH(strcasecmp,  strcasecmp,  f(a->src, a->src2))
+BENCH_MS(memcasecmp, memcasecmp, f(a->src, a->src2, a->len))
+BENCH(strcasestr,  strcasestr,  f(a->src, a->src2))
+BENCH(strspn,      strspn,      f(a->src, a->chars))
+BENCH(strcspn,     strcspn,     f(a->src, a->chars))
+BENCH(strpbrk,     strpbrk,     f(a->src, a->chars))
+BENCH_MS(strspn_set,  strspn_set,  f(a->src, a->set))
+BENCH_MS(strcspn_set, strcspn_set, f(a->src, a->set))
+BENCH_MS(strpbrk_set, strpbrk_set, f(a->src, a->set))
+BENCH_MS(ms_charset_init, ms_charset_init, (f(a->set, a->chars), 0))
+
+BENCH(strtoull,    strtoull,    f(a->src, NULL, 0))
+BENCH(strtoll,     strtoll,     f(a->src, NULL, 0))
+BENCH(strtoul,     strtoul,     f(a->src, NULL, 0))
+BENCH(strtol,      strtol,      f(a->src, NULL, 0))
+BENCH_MS(strntoull, strntoull,  f(a->src, a->src + a->len, 0, NULL))
+BENCH_MS(strntoll,  strntoll,   f(a->src, a->src + a->len, 0, NULL))
+#if MS_HAVE_INT128
+BENCH_MS(strtou128, strtou128,  f(a->src, NULL, 0))
+#endif
+BENCH(strtod,      strtod,      f(a->src, NULL))
+BENCH(strtof,      strtof,      f(a->src, NULL))
+BENCH(strtold,     strtold,     f(a->src, NULL))
+BENCH_MS(strntod,   strntod,    f(a->src, a->src + a->len, NULL))
+BENCH(atof,        atof,        f(a->src))
+
+//----------------------------------------------------------------------
+// atoi takes a pointer to the string pointer here, unlike libc
+
+static size_t ms_atoi(const struct bench_arg *a)
+{
+  const char *s = a->src;
+  return (size_t) atoi(&s);
+}
+
+static size_t lc_atoi(const struct bench_arg *a)
+{
+  int (*f)(const char *) = (int (*)(const char *)) a->libc;
+  return (size_t) f(a->src);
+}
+
+//----------------------------------------------------------------------
+// Tokenizers write to their input, every call tokenizes a fresh copy
+
+#define BENCH_TOK(id, fn, first, next)                               \
+  static size_t id(const struct bench_arg *a, __typeof__(&fn) f)     \
+  {                                                                  \
+    char *last = NULL;                                               \
+    size_t n = 0;                                                    \
+    char *t;                                                         \
+    (void) last;                                                     \
+    a->reset(a->work, a->src, a->len + 1);                           \
+    for (t = (first); t; t = (next)) {                               \
+      n++;                                                           \
+    }                                                                \
+    return n;                                                        \
+  }
+
+BENCH_TOK(tok_strtok,       strtok,       f(a->work, a->chars),         f(NULL, a->chars))
+BENCH_TOK(tok_strtok_r,     strtok_r,     f(a->work, a->chars, &last),  f(NULL, a->chars, &last))
+BENCH_TOK(tok_strtok_set,   strtok_set,   f(a->work, a->set),           f(NULL, a->set))
+BENCH_TOK(tok_strtok_r_set, strtok_r_set, f(a->work, a->set, &last),    f(NULL, a->set, &last))
+
+static size_t ms_strtok(const struct bench_arg *a)
+{
+  return tok_strtok(a, strtok);
+}
+
+static size_t lc_strtok(const struct bench_arg *a)
+{
+  return tok_strtok(a, (__typeof__(&strtok)) a->libc);
+}
+
+static size_t ms_strtok_r(const struct bench_arg *a)
+{
+  return tok_strtok_r(a, strtok_r);
+}
+
+static size_t lc_strtok_r(const struct bench_arg *a)
+{
+  return tok_strtok_r(a, (__typeof__(&strtok_r)) a->libc);
+}
+
+static size_t ms_strtok_set(const struct bench_arg *a)
+{
+  return tok_strtok_set(a, strtok_set);
+}
+
+static size_t ms_strtok_r_set(const struct bench_arg *a)
+{
+  return tok_strtok_r_set(a, strtok_r_set);
+}
+
+static size_t ms_ms_tokenizer_next(const struct bench_arg *a)
+{
+  ms_tokenizer tok;
+  ms_token t;
+  size_t n = 0;
+
+  ms_tokenizer_init(&tok, a->src, a->len, a->set, 0);
+  while (ms_tokenizer_next(&tok, &t)) {
+    n++;
+  }
+  return n;
+}
+
+//----------------------------------------------------------------------
+// Formatting, the v* functions are called through a variadic helper
+
+static int call_vsprintf(__typeof__(&vsprintf) f, char *out, const char *fmt, ...)
+{
+  va_list args;
+  int ret;
+
+  va_start(args, fmt);
+  ret = f(out, fmt, args);
+  va_end(args);
+  return ret;
+}
+
+static int call_vsnprintf(__typeof__(&vsnprintf) f, char *out, size_t size, const char *fmt, ...)
+{
+  va_list args;
+  int ret;
+
+  va_start(args, fmt);
+  ret = f(out, size, fmt, args);
+  va_end(args);
+  return ret;
+}
+
+static int call_pprint(char *out, const char *fmt, ...)
+{
+  va_list args;
+  int ret;
+
+  va_start(args, fmt);
+  ret = pprint(&out, fmt, args);
+  va_end(args);
+  return ret;
+}
+
+// compiled formats, compiled on first use and kept
+static int call_fmt_print(const char *format, char *out, ...)
+{
+  static ms_fmt *fmt;
+  ms_sink sink;
+  va_list args;
+  int ret;
+
+  if (!fmt)
+    fmt = ms_fmt_compile(format);
+  ms_sink_mem(&sink, out);
+  va_start(args, out);
+  ret = ms_fmt_exec(fmt, &sink, args);
+  va_end(args);
+  return ret;
+}
+
+static int call_vprint(__typeof__(&ms_vprint) f, char *out, const char *fmt, ...)
+{
+  ms_sink sink;
+  va_list args;
+  int ret;
+
+  ms_sink_mem(&sink, out);
+  va_start(args, fmt);
+  ret = f(&sink, fmt, args);
+  va_end(args);
+  return ret;
+}
+
+// sinks are set up per call, as for one message; file and fd go to /dev/null
+static ms_sink bench_out;
+
+static FILE *bench_null(void)
+{
+  static FILE *fp;
+
+  if (!fp)
+    fp = fopen("/dev/null", "w");
+  return fp;
+}
+
+static int bench_null_fn(void *ctx, const char *s, size_t n)
+{
+  return 0;
+}
+
+static int call_scan_read(const char *format, const char *buf, ...)
+{
+  static ms_scan *scan;
+  va_list args;
+  int ret;
+
+  if (!scan)
+    scan = ms_scan_compile(format);
+  va_start(args, buf);
+  ret = ms_scan_exec(scan, buf, args);
+  va_end(args);
+  return ret;
+}
+
+static int call_vsscanf(__typeof__(&vsscanf) f, const char *buf, const char *fmt, ...)
+{
+  va_list args;
+  int ret;
+
+  va_start(args, fmt);
+  ret = f(buf, fmt, args);
+  va_end(args);
+  return ret;
+}
+
+BENCH(sprintf_s,    sprintf,   f(a->dst, "%s", a->src))
+BENCH(sprintf_int,  sprintf,   f(a->dst, "%d %u %x", -123456, 4000000000u, 0xBEEFu))
+BENCH(sprintf_ll,   sprintf,   f(a->dst, "%lld %llx", -1234567890123LL, 0x123456789ABCULL))
+BENCH(sprintf_pad,  sprintf,   f(a->dst, "[%-12s|%08d|%6x]", "key", 42, 255u))
+BENCH(sprintf_flt,  sprintf,   f(a->dst, "%f %e %g", 3.14159, -2.5e-10, 1234567.0))
+BENCH(snprintf_s,   snprintf,  f(a->dst, a->len + 1, "%s", a->src))
+BENCH(snprintf_int, snprintf,  f(a->dst, 64, "%d %u %x", -123456, 4000000000u, 0xBEEFu))
+BENCH(snprintf_len, snprintf,  f(NULL, 0, "[%-12s|%08d|%6x]", "key", 42, 255u))
+BENCH(vsprintf_int, vsprintf,  call_vsprintf(f, a->dst, "%d %u %x", -123456, 4000000000u, 0xBEEFu))
+BENCH(vsnprintf_int, vsnprintf, call_vsnprintf(f, a->dst, 64, "%d %u %x", -123456, 4000000000u, 0xBEEFu))
+BENCH_MS(pprint_int, pprint,   call_pprint(a->dst, "%d %u %x", -123456, 4000000000u, 0xBEEFu))
+BENCH_MS(fmt_pad,  ms_fmt_exec, call_fmt_print("[%-12s|%08d|%6x]", a->dst, "key", 42, 255u))
+BENCH_MS(print_s,    ms_print,  (ms_sink_mem(&bench_out, a->dst), f(&bench_out, "%s", a->src)))
+BENCH_MS(print_fd_s, ms_print,  (ms_sink_fd(&bench_out, fileno(bench_null())), f(&bench_out, "%s", a->src)))
+BENCH_MS(vprint_int, ms_vprint, call_vprint(f, a->dst, "%d %u %x", -123456, 4000000000u, 0xBEEFu))
+BENCH_MS(out_mem,  ms_sink_mem,      (f(&bench_out, a->dst),
+                                      ms_print(&bench_out, "%d %u %x", -123456, 4000000000u, 0xBEEFu)))
+BENCH_MS(out_buf,  ms_sink_buf,      (f(&bench_out, a->dst, 16),
+                                      ms_print(&bench_out, "%d %u %x", -123456, 4000000000u, 0xBEEFu)))
+BENCH_MS(out_file, ms_sink_file,     (f(&bench_out, bench_null()),
+                                      ms_print(&bench_out, "%d %u %x", -123456, 4000000000u, 0xBEEFu)))
+BENCH_MS(out_fd,   ms_sink_fd,       (f(&bench_out, fileno(bench_null())),
+                                      ms_print(&bench_out, "%d %u %x", -123456, 4000000000u, 0xBEEFu)))
+BENCH_MS(out_fn,   ms_sink_callback, (f(&bench_out, bench_null_fn, NULL),
+                                      ms_print(&bench_out, "%d %u %x", -123456, 4000000000u, 0xBEEFu)))
+
+BENCH_MS(itoa_u32,    ms_u32toa,     f(4000000000u, a->dst))
+BENCH_MS(itoa_u64_1,  ms_u64toa,     f(7, a->dst))
+BENCH_MS(itoa_u64_20, ms_u64toa,     f(18446744073709551615ULL, a->dst))
+BENCH_MS(itoa_i64,    ms_i64toa,     f(-1234567890123LL, a->dst))
+BENCH_MS(itoa_hex,    ms_u64toa_hex, f(0x123456789ABCULL, a->dst, 0))
+BENCH_MS(itoa_oct,    ms_u64toa_oct, f(0777777ULL, a->dst))
+#if MS_HAVE_INT128
+BENCH_MS(itoa_u128,   ms_u128toa,    f(MS_U128_MAX, a->dst))
+#endif
+BENCH_MS(dtoa_short,  ms_dtoa,       f(0.1, a->dst))
+BENCH_MS(dtoa_long,   ms_dtoa,       f(-2.2250738585072014e-308, a->dst))
+
+BENCH_MS(ms_hex_encode,    ms_hex_encode,    f(a->dst, a->src, a->len, 0))
+BENCH_MS(ms_hex_decode,    ms_hex_decode,    f(a->dst, a->src, a->len, NULL))
+BENCH_MS(ms_base64_encode, ms_base64_encode, f(a->dst, a->src, a->len))
+BENCH_MS(ms_base64_decode, ms_base64_decode, f(a->dst, a->src, a->len, NULL))
+
+static int scan_i;
+static unsigned int scan_u;
+static long long scan_ll;
+static char scan_s[64];
+
+BENCH(sscanf_int,  sscanf,  f("-123456 4000000000 beef", "%d %u %x", &scan_i, &scan_u, &scan_u))
+BENCH(sscanf_str,  sscanf,  f("key value 1234567890123", "%s %s %lld", scan_s, scan_s, &scan_ll))
+BENCH(vsscanf_int, vsscanf, call_vsscanf(f, "-123456 4000000000 beef", "%d %u %x", &scan_i, &scan_u, &scan_u))
+BENCH_MS(scan_int, ms_scan_exec, call_scan_read("%d %u %x", "-123456 4000000000 beef", &scan_i, &scan_u, &scan_u))
+
+//----------------------------------------------------------------------
+// Column parsers, compared with converting field by field with endp
+
+#define BENCH_COLUMN(id, type, arr, conv, call)                      \
+  static size_t ms_##id(const struct bench_arg *a)                   \
+  {                                                                  \
+    return id(a->src, a->len, a->set, arr, sizeof(arr) / sizeof(arr[0]), NULL); \
+  }                                                                  \
+  static size_t lc_##id(const struct bench_arg *a)                   \
+  {                                                                  \
+    __typeof__(&conv) f = (__typeof__(&conv)) a->libc;               \
+    const char *p = a->src;                                          \
+    size_t n = 0;                                                    \
+    char *e;                                                         \
+                                                                     \
+    while (p < a->src + a->len) {                                    \
+      arr[n++] = (type)(call);                                       \
+      p = e + 1;                                                     \
+    }                                                                \
+    return n;                                                        \
+  }
+
+BENCH_COLUMN(ms_parse_column_u64, uint64_t, col_u64, strtoull, f(p, &e, 10))
+BENCH_COLUMN(ms_parse_column_i64, int64_t,  col_i64, strtoll,  f(p, &e, 10))
+BENCH_COLUMN(ms_parse_column_f64, double,   col_f64, strtod,   f(p, &e))
+
+//----------------------------------------------------------------------
+/**
+ * One benchmarked function
+ */
+struct bench_case {
+  const char *name;     // function name, also looked up in libc
+  const char *variant;  // what the arguments are, if not obvious
+  enum bench_shape shape;
+  int by_pos;           // match position is a grid parameter
+  bench_fn ms;          // library version
+  bench_fn lc;          // libc version, NULL if none
+  const char *libc_name; // libc function lc calls, if not name
+};
+
+#define CASE(id, shape, by_pos)            { #id, "", shape, by_pos, ms_##id, lc_##id, NULL }
+#define CASE_MS(id, shape, by_pos)         { #id, "", shape, by_pos, ms_##id, NULL, NULL }
+#define CASE_V(fn, id, var, shape)         { #fn, var, shape, 0, ms_##id, lc_##id, NULL }
+#define CASE_V_MS(fn, id, var, shape)      { #fn, var, shape, 0, ms_##id, NULL, NULL }
+#define CASE_L(id, libc, shape)            { #id, "vs " libc " loop", shape, 0, ms_##id, lc_##id, libc }
+
+static const struct bench_case bench_cases[] = {
+  CASE(memchr,               SHAPE_MEM,       1),
+  CASE(memrchr,              SHAPE_MEM,       1),
+  CASE(memmem,               SHAPE_SEARCH,    1),
+  CASE(memcpy,               SHAPE_COPY,      0),
+  CASE(memmove,              SHAPE_COPY,      0),
+  CASE(memset,               SHAPE_COPY,      0),
+  CASE(memcmp,               SHAPE_CMP,       1),
+  CASE(strcmp,               SHAPE_CMP,       1),
+  CASE(strncmp,              SHAPE_CMP,       1),
+  CASE(strlen,               SHAPE_STR,       0),
+  CASE(strnlen,              SHAPE_STR,       0),
+  CASE(strstr,               SHAPE_SEARCH,    1),
+  CASE(strchr,               SHAPE_STR,       1),
+  CASE(strchrnul,            SHAPE_STR,       1),
+  CASE_MS(strnchr,           SHAPE_STR,       1),
+  CASE(strrchr,              SHAPE_STR,       1),
+  CASE(strcat,               SHAPE_COPY,      0),
+  CASE(strncat,              SHAPE_COPY,      0),
+  CASE(strcpy,               SHAPE_COPY,      0),
+  CASE(stpcpy,               SHAPE_COPY,      0),
+  CASE(stpncpy,              SHAPE_COPY,      0),
+  CASE(strlcpy,              SHAPE_COPY,      0),
+  CASE(strlcat,              SHAPE_COPY,      0),
+  CASE(strncasecmp,          SHAPE_CMP,       1),
+  CASE(strcasecmp,           SHAPE_CMP,       1),
+  CASE_MS(memcasecmp,        SHAPE_CMP,       1),
+  CASE(strcasestr,           SHAPE_SEARCH,    1),
+  CASE(strspn,               SHAPE_SPAN_IN,   1),
+  CASE(strcspn,              SHAPE_SPAN_OUT,  1),
+  CASE(strpbrk,              SHAPE_SPAN_OUT,  1),
+  CASE_MS(strspn_set,        SHAPE_SPAN_IN,   1),
+  CASE_MS(strcspn_set,       SHAPE_SPAN_OUT,  1),
+  CASE_MS(strpbrk_set,       SHAPE_SPAN_OUT,  1),
+  CASE_MS(ms_charset_init,   SHAPE_FIXED,     0),
+  CASE(strtok,               SHAPE_TOKENS,    0),
+  CASE(strtok_r,             SHAPE_TOKENS,    0),
+  CASE_MS(strtok_set,        SHAPE_TOKENS,    0),
+  CASE_MS(strtok_r_set,      SHAPE_TOKENS,    0),
+  CASE_MS(ms_tokenizer_next, SHAPE_TOKENS,    0),
+  CASE(strtoull,             SHAPE_NUM_INT,   0),
+  CASE(strtoll,              SHAPE_NUM_INT,   0),
+  CASE(strtoul,              SHAPE_NUM_INT,   0),
+  CASE(strtol,               SHAPE_NUM_INT,   0),
+  CASE_MS(strntoull,         SHAPE_NUM_INT,   0),
+  CASE_MS(strntoll,          SHAPE_NUM_INT,   0),
+#if MS_HAVE_INT128
+  CASE_MS(strtou128,         SHAPE_NUM_INT,   0),
+#endif
+  CASE(atoi,                 SHAPE_NUM_INT,   0),
+  CASE(strtod,               SHAPE_NUM_FLOAT, 0),
+  CASE(strtof,               SHAPE_NUM_FLOAT, 0),
+  CASE(strtold,              SHAPE_NUM_FLOAT, 0),
+  CASE_MS(strntod,           SHAPE_NUM_FLOAT, 0),
+  CASE(atof,                 SHAPE_NUM_FLOAT, 0),
+  CASE_V(sprintf,   sprintf_s,     "%s",            SHAPE_FMT_STR),
+  CASE_V(sprintf,   sprintf_int,   "%d %u %x",      SHAPE_FIXED),
+  CASE_V(sprintf,   sprintf_ll,    "%lld %llx",     SHAPE_FIXED),
+  CASE_V(sprintf,   sprintf_pad,   "[%-12s|%08d|%6x]", SHAPE_FIXED),
+  CASE_V(sprintf,   sprintf_flt,   "%f %e %g",      SHAPE_FIXED),
+  CASE_V(snprintf,  snprintf_s,    "%s",            SHAPE_FMT_STR),
+  CASE_V(snprintf,  snprintf_int,  "%d %u %x",      SHAPE_FIXED),
+  CASE_V(snprintf,  snprintf_len,  "NULL, 0",       SHAPE_FIXED),
+  CASE_V(vsprintf,  vsprintf_int,  "%d %u %x",      SHAPE_FIXED),
+  CASE_V(vsnprintf, vsnprintf_int, "%d %u %x",      SHAPE_FIXED),
+  CASE_V_MS(pprint, pprint_int,    "%d %u %x",      SHAPE_FIXED),
+  CASE_V_MS(ms_fmt_exec, fmt_pad,  "[%-12s|%08d|%6x]", SHAPE_FIXED),
+  CASE_V_MS(ms_print,  print_s,     "%s",            SHAPE_FMT_STR),
+  CASE_V_MS(ms_print,  print_fd_s,  "fd, %s",        SHAPE_FMT_STR),
+  CASE_V_MS(ms_vprint, vprint_int,  "%d %u %x",      SHAPE_FIXED),
+  CASE_V_MS(ms_sink_mem,      out_mem,  "%d %u %x",     SHAPE_FIXED),
+  CASE_V_MS(ms_sink_buf,      out_buf,  "16, %d %u %x", SHAPE_FIXED),
+  CASE_V_MS(ms_sink_file,     out_file, "%d %u %x",     SHAPE_FIXED),
+  CASE_V_MS(ms_sink_fd,       out_fd,   "%d %u %x",     SHAPE_FIXED),
+  CASE_V_MS(ms_sink_callback, out_fn,   "%d %u %x",     SHAPE_FIXED),
+  CASE_V_MS(ms_u32toa,     itoa_u32,    "4000000000",           SHAPE_FIXED),
+  CASE_V_MS(ms_u64toa,     itoa_u64_1,  "7",                    SHAPE_FIXED),
+  CASE_V_MS(ms_u64toa,     itoa_u64_20, "18446744073709551615", SHAPE_FIXED),
+  CASE_V_MS(ms_i64toa,     itoa_i64,    "-1234567890123",       SHAPE_FIXED),
+  CASE_V_MS(ms_u64toa_hex, itoa_hex,    "123456789abc",         SHAPE_FIXED),
+  CASE_V_MS(ms_u64toa_oct, itoa_oct,    "777777",               SHAPE_FIXED),
+#if MS_HAVE_INT128
+  CASE_V_MS(ms_u128toa,    itoa_u128,   "340282366920938463463374607431768211455", SHAPE_FIXED),
+#endif
+  CASE_V_MS(ms_dtoa,       dtoa_short,  "0.1",                  SHAPE_FIXED),
+  CASE_V_MS(ms_dtoa,       dtoa_long,   "-2.2250738585072014e-308", SHAPE_FIXED),
+  CASE_MS(ms_hex_encode,     SHAPE_MEM,       0),
+  CASE_MS(ms_hex_decode,     SHAPE_HEX,       0),
+  CASE_MS(ms_base64_encode,  SHAPE_MEM,       0),
+  CASE_MS(ms_base64_decode,  SHAPE_BASE64,    0),
+  CASE_V(sscanf,    sscanf_int,    "%d %u %x",      SHAPE_FIXED),
+  CASE_V(sscanf,    sscanf_str,    "%s %s %lld",    SHAPE_FIXED),
+  CASE_V(vsscanf,   vsscanf_int,   "%d %u %x",      SHAPE_FIXED),
+  CASE_V_MS(ms_scan_exec, scan_int, "%d %u %x",     SHAPE_FIXED),
+  CASE_L(ms_parse_column_u64, "strtoull", SHAPE_COL_INT),
+  CASE_L(ms_parse_column_i64, "strtoll",  SHAPE_COL_INT),
+  CASE_L(ms_parse_column_f64, "strtod",   SHAPE_COL_FLOAT),
+};
+
+static const char * const bench_ints[] = {
+  "7", "65535", "1234567890", "18446744073709551615", "0x7fffffff", "0777"
+};
+
+static const char * const bench_floats[] = {
+  "1", "3.14159", "-2.5e-3", "6.02214076e23", "1.7976931348623157e308",
+  "4.9406564584124654e-324", "123456789012345678901234567890.125"
+};
+
+//----------------------------------------------------------------------
+// Measurement
+
+struct bench_opts {
+  double ms_per_point;  // target time of one measurement
+  int quick;            // fewer lengths
+  int full;             // more alignments
+  const char *filter;   // only this function
+  FILE *csv;
+  FILE *json;
+  int json_first;
+};
+
+static volatile size_t bench_sink;
+
+static double bench_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static uint64_t bench_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+__attribute__((noinline))
+static void bench_run(bench_fn fn, const struct bench_arg *a, size_t iters)
+{
+  size_t acc = 0;
+
+  while (iters--) {
+    acc += fn(a);
+  }
+  bench_sink = acc;
+}
+
+/**
+ * Time one function on one input
+ *
+ * @param fn      Function wrapper
+ * @param a       Input
+ * @param target  Target time in ns
+ * @param ns      Out parameter, ns per call
+ * @param ticks   Out parameter, time stamp counter ticks per call
+ *
+ * @return Number of calls per timed run
+ */
+static size_t bench_measure(bench_fn fn, const struct bench_arg *a, double target,
+                            double *ns, double *ticks)
+{
+  size_t iters = 1;
+  double t;
+  int rep;
+
+  // grow until one run takes a tenth of the target
+  for (;;) {
+    double t0 = bench_now_ns();
+    bench_run(fn, a, iters);
+    t = bench_now_ns() - t0;
+    if ((t >= target / 10) || (iters >= ((size_t) 1 << 40))) {
+      break;
+    }
+    iters = (t < target / 1000) ? (iters * 16) : (iters * 2);
+  }
+
+  // best of several runs
+  *ns = 1e300;
+  *ticks = 1e300;
+  for (rep = 0; rep < 5; rep++) {
+    double   t0 = bench_now_ns();
+    uint64_t c0 = bench_ticks();
+    double   dt;
+    double   dc;
+
+    bench_run(fn, a, iters);
+    dc = (double)(bench_ticks() - c0) / (double) iters;
+    dt = (bench_now_ns() - t0) / (double) iters;
+    if (dt < *ns) {
+      *ns = dt;
+      *ticks = dc;
+    }
+  }
+  return iters;
+}
+
+//----------------------------------------------------------------------
+// Inputs
+
+static uint32_t bench_rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+  bench_rand_state = bench_rand_state * 1103515245u + 12345u;
+  return bench_rand_state >> 16;
+}
+
+/**
+ * Fill with letters not in the search byte, set or needle
+ */
+static void bench_fill(char *p, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    p[i] = (char)('i' + (bench_rand() % 16));
+  }
+}
+
+#define NEEDLE "needle:HayStack"
+#define BENCH_BASE64 "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+
+/**
+ * Prepare input of a shape, pos is the match position or len for none
+ */
+static void bench_setup(const struct bench_case *bc, struct bench_arg *a,
+                        size_t len, size_t align, size_t pos, size_t fixed)
+{
+  char *src  = buf_src + align;
+  char *src2 = buf_src2 + ((align * 3) & 63);
+  size_t i;
+
+  a->dst   = buf_dst + 64;
+  a->src   = src;
+  a->src2  = src2;
+  a->len   = len;
+  a->len2  = 0;
+  a->c     = 'Q';
+  a->chars = BENCH_SET;
+  a->work  = buf_work;
+
+  switch (bc->shape) {
+  case SHAPE_STR:
+  case SHAPE_MEM:
+  case SHAPE_COPY:
+  case SHAPE_FMT_STR:
+    bench_fill(src, len);
+    if (pos < len) {
+      src[pos] = (char) a->c;
+    }
+    src[len] = '\0';
+    break;
+
+  case SHAPE_CMP:
+    bench_fill(src, len);
+    src[len] = '\0';
+    a->reset(src2, src, len + 1);
+    if (pos < len) {
+      src2[pos] = 'A';
+    }
+    break;
+
+  case SHAPE_SEARCH:
+    bench_fill(src, len);
+    src[len] = '\0';
+    a->src2 = NEEDLE;
+    a->len2 = sizeof(NEEDLE) - 1;
+    if ((pos < len) && (len >= a->len2)) {
+      if (pos + a->len2 > len) {
+        pos = len - a->len2;
+      }
+      a->reset(src + pos, NEEDLE, a->len2);
+    }
+    break;
+
+  case SHAPE_SPAN_IN:
+    for (i = 0; i < len; i++) {
+      src[i] = BENCH_SET[bench_rand() % (sizeof(BENCH_SET) - 1)];
+    }
+    if (pos < len) {
+      src[pos] = BENCH_OUTSIDE;
+    }
+    src[len] = '\0';
+    break;
+
+  case SHAPE_SPAN_OUT:
+    for (i = 0; i < len; i++) {
+      src[i] = BENCH_OUTSIDE;
+    }
+    if (pos < len) {
+      src[pos] = BENCH_SET[0];
+    }
+    src[len] = '\0';
+    break;
+
+  case SHAPE_TOKENS:
+    a->chars = BENCH_DELIMS;
+    bench_fill(src, len);
+    for (i = 7; i < len; i += 8) {
+      src[i] = BENCH_DELIMS[(i >> 3) & 3];
+    }
+    src[len] = '\0';
+    break;
+
+  case SHAPE_COL_INT:
+  case SHAPE_COL_FLOAT:
+    a->chars = ",\n";
+    for (i = 0; i < len;) {
+      // 1 to 12 digits, with a fraction for floats
+      size_t digits = 1 + (bench_rand() % 12);
+      size_t k;
+
+      for (k = 0; (k < digits) && (i < len); k++, i++) {
+        src[i] = (char)('0' + (k ? (bench_rand() % 10) : (1 + bench_rand() % 9)));
+        if ((bc->shape == SHAPE_COL_FLOAT) && (k == digits / 2) && (k + 1 < digits) &&
+            (i + 2 < len)) {
+          src[++i] = '.';
+        }
+      }
+      if (i + 1 < len) {
+        src[i++] = (bench_rand() & 7) ? ',' : '\n';
+      }
+      else {
+        len = i;
+      }
+    }
+    a->len = len;
+    src[len] = '\0';
+    break;
+
+  case SHAPE_HEX:
+    for (i = 0; i < len; i++) {
+      src[i] = "0123456789abcdefABCDEF"[bench_rand() % 22];
+    }
+    src[len] = '\0';
+    break;
+
+  case SHAPE_BASE64:
+    a->len = len & ~(size_t) 3;
+    for (i = 0; i < a->len; i++) {
+      src[i] = BENCH_BASE64[bench_rand() % 64];
+    }
+    src[a->len] = '\0';
+    break;
+
+  case SHAPE_NUM_INT:
+    a->src = bench_ints[fixed];
+    a->len = __builtin_strlen(a->src);
+    break;
+
+  case SHAPE_NUM_FLOAT:
+    a->src = bench_floats[fixed];
+    a->len = __builtin_strlen(a->src);
+    break;
+
+  case SHAPE_FIXED:
+    a->len = 0;
+    break;
+  }
+  ms_charset_init(a->set, a->chars);
+}
+
+//----------------------------------------------------------------------
+// Output
+
+static void bench_report(struct bench_opts *o, const struct bench_case *bc,
+                         const struct bench_arg *a, size_t align, const char *pos,
+                         const char *impl, size_t calls, double ns, double ticks)
+{
+  double bpc = (ticks > 0 && a->len) ? ((double) a->len / ticks) : 0;
+
+  if (o->csv) {
+    fprintf(o->csv, "%s,\"%s\",%s,%zu,%zu,%s,%zu,%.3f,%.4f\n",
+            bc->name, bc->variant, impl, a->len, align, pos, calls, ns, bpc);
+  }
+  if (o->json) {
+    fprintf(o->json, "%s\n  {\"function\": \"%s\", \"variant\": \"%s\", \"impl\": \"%s\", "
+            "\"len\": %zu, \"align\": %zu, \"pos\": \"%s\", \"calls\": %zu, "
+            "\"ns_per_call\": %.3f, \"bytes_per_cycle\": %.4f}",
+            o->json_first ? "" : ",", bc->name, bc->variant, impl,
+            a->len, align, pos, calls, ns, bpc);
+    o->json_first = 0;
+  }
+}
+
+/**
+ * Measure one grid point for the library and libc
+ */
+static void bench_point(struct bench_opts *o, const struct bench_case *bc,
+                        struct bench_arg *a, size_t align, const char *pos)
+{
+  double ns_ms;
+  double ns_lc = 0;
+  double ticks;
+  size_t calls;
+
+  calls = bench_measure(bc->ms, a, o->ms_per_point * 1e6, &ns_ms, &ticks);
+  bench_report(o, bc, a, align, pos, "ministring", calls, ns_ms, ticks);
+
+  if (bc->lc && a->libc) {
+    calls = bench_measure(bc->lc, a, o->ms_per_point * 1e6, &ns_lc, &ticks);
+    bench_report(o, bc, a, align, pos, "libc", calls, ns_lc, ticks);
+  }
+
+  fprintf(stderr, "%-18s %-18s %8zu %5zu %-4s %12.2f", bc->name, bc->variant,
+          a->len, align, pos, ns_ms);
+  if (ns_lc > 0) {
+    fprintf(stderr, " %12.2f %8.2fx\n", ns_lc, ns_lc / ns_ms);
+  }
+  else {
+    fprintf(stderr, " %12s %9s\n", "-", "-");
+  }
+}
+
+//----------------------------------------------------------------------
+static int bench_arg_is(const char *arg, const char *name)
+{
+  return strcmp(arg, name) == 0;
+}
+
+static double bench_arg_num(const char *s)
+{
+  return strtod(s, NULL);
+}
+
+int main(int argc, char **argv)
+{
+  static const size_t aligns_default[] = { 0, 3 };
+  static const size_t aligns_full[]    = { 0, 1, 3, 7, 15, 31 };
+  struct bench_opts o = { 1.0, 0, 0, NULL, NULL, NULL, 1 };
+  ms_charset set;
+  size_t n_aligns;
+  const size_t *aligns;
+  size_t i;
+  int k;
+
+  for (k = 1; k < argc; k++) {
+    if (bench_arg_is(argv[k], "--quick")) {
+      o.quick = 1;
+    }
+    else if (bench_arg_is(argv[k], "--full")) {
+      o.full = 1;
+    }
+    else if (bench_arg_is(argv[k], "--ms") && (k + 1 < argc)) {
+      o.ms_per_point = bench_arg_num(argv[++k]);
+    }
+    else if (bench_arg_is(argv[k], "--filter") && (k + 1 < argc)) {
+      o.filter = argv[++k];
+    }
+    else if (bench_arg_is(argv[k], "--csv") && (k + 1 < argc)) {
+      o.csv = fopen(argv[++k], "w");
+    }
+    else if (bench_arg_is(argv[k], "--json") && (k + 1 < argc)) {
+      o.json = fopen(argv[++k], "w");
+    }
+    else {
+      fprintf(stderr, "usage: %s [--quick] [--full] [--ms <per point>] [--filter <name>] "
+              "[--csv <file>] [--json <file>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  aligns   = o.full ? aligns_full : aligns_default;
+  n_aligns = o.full ? (sizeof(aligns_full) / sizeof(aligns_full[0]))
+                    : (sizeof(aligns_default) / sizeof(aligns_default[0]));
+
+  if (o.csv) {
+    fprintf(o.csv, "function,variant,impl,len,align,pos,calls,ns_per_call,bytes_per_cycle\n");
+  }
+  if (o.json) {
+    fprintf(o.json, "[");
+  }
+  fprintf(stderr, "%-18s %-18s %8s %5s %-4s %12s %12s %9s\n",
+          "function", "variant", "len", "align", "pos", "ns", "libc ns", "speedup");
+
+  for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+    const struct bench_case *bc = &bench_cases[i];
+    struct bench_arg a;
+    size_t len;
+    size_t al;
+
+    if (o.filter && !bench_arg_is(o.filter, bc->name)) {
+      continue;
+    }
+
+    a.set   = &set;
+    a.reset = (void *(*)(void *, const void *, size_t)) dlsym(RTLD_NEXT, "memcpy");
+    a.libc  = bc->lc ? dlsym(RTLD_NEXT, bc->libc_name ? bc->libc_name : bc->name) : NULL;
+
+    // fixed inputs
+    if ((bc->shape == SHAPE_NUM_INT) || (bc->shape == SHAPE_NUM_FLOAT) ||
+        (bc->shape == SHAPE_FIXED)) {
+      size_t n = (bc->shape == SHAPE_NUM_INT) ? (sizeof(bench_ints) / sizeof(bench_ints[0])) :
+                 (bc->shape == SHAPE_NUM_FLOAT) ? (sizeof(bench_floats) / sizeof(bench_floats[0])) : 1;
+      size_t f;
+
+      for (f = 0; f < n; f++) {
+        bench_setup(bc, &a, 0, 0, 0, f);
+        bench_point(&o, bc, &a, 0, "-");
+      }
+      continue;
+    }
+
+    // grid of length x alignment x match position
+    for (len = 1; len <= BENCH_MAX_LEN; len *= (o.quick ? 4 : 2)) {
+      for (al = 0; al < n_aligns; al++) {
+        bench_setup(bc, &a, len, aligns[al], len, 0);
+        bench_point(&o, bc, &a, aligns[al], bc->by_pos ? "none" : "-");
+        if (bc->by_pos) {
+          bench_setup(bc, &a, len, aligns[al], len - 1, 0);
+          bench_point(&o, bc, &a, aligns[al], "end");
+          if (len >= 4) {
+            bench_setup(bc, &a, len, aligns[al], len / 2, 0);
+            bench_point(&o, bc, &a, aligns[al], "mid");
+          }
+        }
+      }
+    }
+  }
+
+  if (o.json) {
+    fprintf(o.json, "\n]\n");
+    fclose(o.json);
+  }
+  if (o.csv) {
+    fclose(o.csv);
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef _CHARSET_H_
+#define _CHARSET_H_
+
+/**
+ * Precompiled character set, for repeated span/break/token calls
+ * with the same set. Build with ms_charset_init(), treat as opaque.
+ */
+typedef struct ms_charset {
+  unsigned char bits[32];   // one bit per byte value
+  unsigned char nib_lo[16]; // vector lookup, bytes 0x00-0x7F
+  unsigned char nib_hi[16]; // vector lookup, bytes 0x80-0xFF
+} ms_charset;
+
+#define MS_CHARSET_HAS(set, c) \
+  (((set)->bits[(unsigned char)(c) >> 3] >> ((unsigned char)(c) & 7)) & 1)
+
+void ms_charset_init(ms_charset *set, const char *chars);
+void ms_charset_add(ms_charset *set, int c);
+
+#endif /* _CHARSET_H_ */
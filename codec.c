@@ -0,0 +1,253 @@
+/**
+ * Hexadecimal and base64 encoding of binary buffers.
+ *
+ * The public functions go through the dispatch table. The vector kernels
+ * convert whole blocks and hand the tail, and any block with an invalid
+ * byte, to the portable versions below, which find the exact offset.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <codec.h>
+#include <dispatch.h>
+#include <ascii.h>
+
+//#define ASSERT(cond)
+#define ASSERT(cond) assert(cond)
+
+static const char __hex_lower[16] = "0123456789abcdef";
+static const char __hex_upper[16] = "0123456789ABCDEF";
+
+static const char __b64_chars[64] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+//----------------------------------------------------------------------
+/**
+ * Get value of base64 character
+ *
+ * @param c  Character
+ *
+ * @return Six bit value, 64 if not in the alphabet
+ */
+static inline unsigned int __b64_value(unsigned char c)
+{
+  if ((unsigned int)(c - 'A') < 26) {
+    return c - 'A';
+  }
+  if ((unsigned int)(c - 'a') < 26) {
+    return c - 'a' + 26;
+  }
+  if ((unsigned int)(c - '0') < 10) {
+    return c - '0' + 52;
+  }
+  if (c == '+') {
+    return 62;
+  }
+  return (c == '/') ? 63 : 64;
+}
+
+//----------------------------------------------------------------------
+size_t __ms_hex_encode_generic(char *dst, const unsigned char *src, size_t n, int upper)
+{
+  const char *digits = upper ? __hex_upper : __hex_lower;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    dst[2 * i]       = digits[src[i] >> 4];
+    dst[(2 * i) + 1] = digits[src[i] & 15];
+  }
+  return 2 * n;
+}
+
+//----------------------------------------------------------------------
+size_t __ms_hex_decode_generic(unsigned char *dst, const char *src, size_t n, size_t *bad)
+{
+  const unsigned char *s = (const unsigned char *) src;
+  size_t i;
+
+  for (i = 0; i + 2 <= n; i += 2) {
+    // above 15 if not a hex digit
+    unsigned int hi = __ascii_xvalue(s[i]);
+    unsigned int lo = __ascii_xvalue(s[i + 1]);
+
+    if ((hi | lo) > 15) {
+      *bad = i + (hi <= 15);
+      return i / 2;
+    }
+    dst[i / 2] = (unsigned char)((hi << 4) | lo);
+  }
+  // a lone digit at the end is not a byte
+  *bad = i;
+  return i / 2;
+}
+
+//----------------------------------------------------------------------
+size_t __ms_base64_encode_generic(char *dst, const unsigned char *src, size_t n)
+{
+  char *d = dst;
+  size_t i;
+
+  for (i = 0; i + 3 <= n; i += 3) {
+    uint32_t w = ((uint32_t) src[i] << 16) | ((uint32_t) src[i + 1] << 8) | src[i + 2];
+
+    d[0] = __b64_chars[w >> 18];
+    d[1] = __b64_chars[(w >> 12) & 63];
+    d[2] = __b64_chars[(w >> 6) & 63];
+    d[3] = __b64_chars[w & 63];
+    d += 4;
+  }
+  if (i < n) {
+    uint32_t w = (uint32_t) src[i] << 16;
+
+    if (i + 1 < n) {
+      w |= (uint32_t) src[i + 1] << 8;
+    }
+    d[0] = __b64_chars[w >> 18];
+    d[1] = __b64_chars[(w >> 12) & 63];
+    d[2] = (i + 1 < n) ? __b64_chars[(w >> 6) & 63] : '=';
+    d[3] = '=';
+    d += 4;
+  }
+  return (size_t)(d - dst);
+}
+
+//----------------------------------------------------------------------
+size_t __ms_base64_decode_generic(unsigned char *dst, const char *src, size_t n, size_t *bad)
+{
+  const unsigned char *s = (const unsigned char *) src;
+  unsigned char *d = dst;
+  unsigned int v[4];
+  uint32_t w;
+  size_t i;
+  size_t m;
+  size_t k;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    v[0] = __b64_value(s[i]);
+    v[1] = __b64_value(s[i + 1]);
+    v[2] = __b64_value(s[i + 2]);
+    v[3] = __b64_value(s[i + 3]);
+    if ((v[0] | v[1] | v[2] | v[3]) > 63) {
+      break;
+    }
+    w = (v[0] << 18) | (v[1] << 12) | (v[2] << 6) | v[3];
+    d[0] = (unsigned char)(w >> 16);
+    d[1] = (unsigned char)(w >> 8);
+    d[2] = (unsigned char) w;
+    d += 3;
+  }
+
+  *bad = n;
+  if (i == n) {
+    return (size_t)(d - dst);
+  }
+
+  // last group, short, padded or with an invalid byte
+  m = ((n - i) < 4) ? (n - i) : 4;
+  for (k = 0; (k < m) && ((v[k] = __b64_value(s[i + k])) <= 63); k++) {
+  }
+  if ((k < 2) || ((k < m) && !((m == 4) && (s[i + k] == '=')))) {
+    // less than a byte, or not padding
+    *bad = (k < m) ? (i + k) : i;
+    return (size_t)(d - dst);
+  }
+  if (k < m) {
+    // padding fills the group and ends the input
+    if ((k == 2) && (s[i + 3] != '=')) {
+      *bad = i + 3;
+      return (size_t)(d - dst);
+    }
+    if (i + 4 < n) {
+      // the padded group is whole, only what follows is rejected
+      *bad = i + 4;
+    }
+  }
+
+  w = (v[0] << 18) | (v[1] << 12) | ((k > 2) ? (v[2] << 6) : 0);
+  d[0] = (unsigned char)(w >> 16);
+  if (k > 2) {
+    d[1] = (unsigned char)(w >> 8);
+  }
+  return (size_t)(d - dst) + k - 1;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Encode bytes as hex digits, two per byte
+ *
+ * @param dst    Output, MS_HEX_ENCODE_LEN(n) characters
+ * @param src    Bytes to encode
+ * @param n      Number of bytes
+ * @param upper  Use upper case letters
+ *
+ * @return Number of characters written
+ */
+size_t ms_hex_encode(char *dst, const void *src, size_t n, int upper)
+{
+  ASSERT(dst || !n);
+  ASSERT(src || !n);
+
+  return __ms_string_ops.hex_encode(dst, (const unsigned char *) src, n, upper);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Decode hex digits to bytes
+ *
+ * @param dst  Output, MS_HEX_DECODE_LEN(n) bytes
+ * @param src  Hex digits
+ * @param n    Number of digits
+ * @param bad  Out parameter, offset of first undecodable digit, n if none
+ *
+ * @return Number of bytes written
+ */
+size_t ms_hex_decode(void *dst, const char *src, size_t n, size_t *bad)
+{
+  size_t ignored;
+
+  ASSERT(dst || (n < 2));
+  ASSERT(src || !n);
+
+  return __ms_string_ops.hex_decode((unsigned char *) dst, src, n, bad ? bad : &ignored);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Encode bytes as base64, padded with '='
+ *
+ * @param dst  Output, MS_BASE64_ENCODE_LEN(n) characters
+ * @param src  Bytes to encode
+ * @param n    Number of bytes
+ *
+ * @return Number of characters written
+ */
+size_t ms_base64_encode(char *dst, const void *src, size_t n)
+{
+  ASSERT(dst || !n);
+  ASSERT(src || !n);
+
+  return __ms_string_ops.base64_encode(dst, (const unsigned char *) src, n);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Decode base64 to bytes
+ *
+ * @param dst  Output, MS_BASE64_DECODE_LEN(n) bytes
+ * @param src  Base64 text
+ * @param n    Number of characters
+ * @param bad  Out parameter, offset of first undecodable character, n if none
+ *
+ * @return Number of bytes written
+ */
+size_t ms_base64_decode(void *dst, const char *src, size_t n, size_t *bad)
+{
+  size_t ignored;
+
+  ASSERT(dst || (n < 2));
+  ASSERT(src || !n);
+
+  return __ms_string_ops.base64_decode((unsigned char *) dst, src, n, bad ? bad : &ignored);
+}
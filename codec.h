@@ -0,0 +1,31 @@
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include <stddef.h>
+
+/**
+ * Hexadecimal and base64 (RFC 4648, standard alphabet) encoding of
+ * binary buffers.
+ *
+ * Encoders write exactly the encoded length, without a terminator, and
+ * return it. Decoders return the number of bytes written and set *bad
+ * to the offset of the first input byte that could not be decoded, or
+ * to the input length if all of it was; bad may be NULL. Everything up
+ * to the last complete byte group before the bad offset is decoded.
+ *
+ * Hex decoding takes both letter cases. Base64 decoding takes the final
+ * group with or without '=' padding, and nothing after the padding.
+ */
+
+// Output buffer sizes
+#define MS_HEX_ENCODE_LEN(n)    ((n) * 2)
+#define MS_HEX_DECODE_LEN(n)    ((n) / 2)
+#define MS_BASE64_ENCODE_LEN(n) ((((n) + 2) / 3) * 4)
+#define MS_BASE64_DECODE_LEN(n) ((((n) + 3) / 4) * 3)
+
+size_t ms_hex_encode(char *dst, const void *src, size_t n, int upper);
+size_t ms_hex_decode(void *dst, const char *src, size_t n, size_t *bad);
+size_t ms_base64_encode(char *dst, const void *src, size_t n);
+size_t ms_base64_decode(void *dst, const char *src, size_t n, size_t *bad);
+
+#endif /* _CODEC_H_ */
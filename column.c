@@ -0,0 +1,327 @@
+/**
+ * Bulk numeric field conversion.
+ *
+ * The buffer is indexed a block at a time: the set kernel marks every
+ * separator in a bitmap, and the fields are then visited by counting
+ * trailing zeros of the bitmap words, without looking at bytes between
+ * separators. Integer fields of up to 16 digits are checked and
+ * converted with two word loads, since their length is already known.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <string.h>
+#include <column.h>
+#include <dispatch.h>
+#include <swar.h>
+
+//#define ASSERT(cond)
+#define ASSERT(cond) assert(cond)
+
+// Bytes indexed per call of the set kernel, a multiple of 64
+#define COLUMN_BLOCK (512)
+
+// Field types
+#define COLUMN_U64 (0)
+#define COLUMN_I64 (1)
+#define COLUMN_F64 (2)
+
+//----------------------------------------------------------------------
+/**
+ * Get index of lowest set bit
+ *
+ * @param m  Non-zero word
+ *
+ * @return Bit index
+ */
+static inline unsigned int __ctz64(uint64_t m)
+{
+#if defined(__GNUC__)
+  return (unsigned int) __builtin_ctzll(m);
+#else
+  unsigned int n = 0;
+
+  while (!(m & 1)) {
+    m >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert an unsigned decimal field
+ *
+ * @param p         Start of field
+ * @param n         Field length
+ * @param end       End of buffer, loads never reach it
+ * @param val       Out parameter, converted value
+ * @param overflow  Out parameter, set if the value saturated
+ *
+ * @return Non-zero if the whole field is a number
+ */
+static inline int __field_u64(const char *p, size_t n, const char *end,
+                              uint64_t *val, int *overflow)
+{
+  ms_parse_result r;
+
+#if SWAR_ENABLED
+  if ((n - 1) < (2 * SWAR_BYTES)) {
+    char tmp[2 * SWAR_BYTES];
+    const char *q = p;
+    uint64_t lo;
+    uint64_t hi;
+    unsigned int k;
+
+    // close to the end of the buffer, work on a zero padded copy
+    if ((size_t)(end - p) < sizeof(tmp)) {
+      size_t i;
+
+      for (i = 0; i < sizeof(tmp); i++) {
+        tmp[i] = (i < (size_t)(end - p)) ? p[i] : '\0';
+      }
+      q = tmp;
+    }
+
+    k = __swar_digits(__swar_load_le(q), 10, &hi);
+    if (n <= SWAR_BYTES) {
+      if (k == n) {
+        *val = hi;
+        return 1;
+      }
+      if (k < n) {
+        return 0;
+      }
+    }
+    else if (k == SWAR_BYTES) {
+      k = __swar_digits(__swar_load_le(q + SWAR_BYTES), 10, &lo);
+      if (k == n - SWAR_BYTES) {
+        *val = (hi * __swar_scale10[k]) + lo;
+        return 1;
+      }
+      if (k < n - SWAR_BYTES) {
+        return 0;
+      }
+    }
+    else {
+      return 0;
+    }
+    // the separator is a digit itself, let the converter decide
+  }
+#endif
+
+  *val = strntoull(p, p + n, 10, &r);
+  *overflow |= r.overflow;
+  return (n > 0) && (r.len == n);
+}
+
+/**
+ * Convert a signed decimal field
+ *
+ * @param p         Start of field
+ * @param n         Field length
+ * @param end       End of buffer, loads never reach it
+ * @param val       Out parameter, converted value
+ * @param overflow  Out parameter, set if the value saturated
+ *
+ * @return Non-zero if the whole field is a number
+ */
+static inline int __field_i64(const char *p, size_t n, const char *end,
+                              int64_t *val, int *overflow)
+{
+  uint64_t mag;
+  int negative = 0;
+
+  if ((n > 1) && ((*p == '-') || (*p == '+'))) {
+    negative = (*p == '-');
+    p++;
+    n--;
+  }
+  if (!__field_u64(p, n, end, &mag, overflow)) {
+    return 0;
+  }
+
+  if (negative) {
+    if (mag > (uint64_t) INT64_MAX + 1) {
+      *overflow = 1;
+      mag = (uint64_t) INT64_MAX + 1;
+    }
+    *val = (int64_t)(0 - mag);
+  }
+  else {
+    if (mag > INT64_MAX) {
+      *overflow = 1;
+      mag = INT64_MAX;
+    }
+    *val = (int64_t) mag;
+  }
+  return 1;
+}
+
+/**
+ * Convert a floating-point field
+ *
+ * @param p         Start of field
+ * @param n         Field length
+ * @param val       Out parameter, converted value
+ * @param overflow  Out parameter, set if the value is out of range
+ *
+ * @return Non-zero if the whole field is a number
+ */
+static inline int __field_f64(const char *p, size_t n, double *val, int *overflow)
+{
+  ms_parse_result r;
+
+  *val = strntod(p, p + n, &r);
+  *overflow |= r.overflow;
+  return (n > 0) && (r.len == n);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert fields of one type, inlined into each public function
+ *
+ * @param buf   Buffer
+ * @param len   Buffer length
+ * @param sep   Separator set
+ * @param out   Output array of the field type
+ * @param max   Size of output array
+ * @param res   Out parameter, consumed length and overflow, may be NULL
+ * @param type  COLUMN_* field type
+ *
+ * @return Number of fields stored
+ */
+static inline size_t __parse_column(const char *buf, size_t len, const ms_charset *sep,
+                                    void *out, size_t max, ms_parse_result *res, int type)
+{
+  uint64_t bits[COLUMN_BLOCK / 64];
+  const char *end   = buf + len;
+  const char *field = buf;
+  size_t count = 0;
+  int overflow = 0;
+  size_t base;
+  int ok;
+
+  ASSERT(buf || !len);
+  ASSERT(sep);
+  ASSERT(out || !max);
+
+  for (base = 0; (base < len) && (count < max); base += COLUMN_BLOCK) {
+    size_t n = ((len - base) < COLUMN_BLOCK) ? (len - base) : COLUMN_BLOCK;
+    size_t w;
+
+    __ms_string_ops.set_bitmap(buf + base, n, sep, bits);
+
+    for (w = 0; w < (n + 63) / 64; w++) {
+      uint64_t m = bits[w];
+
+      for (; m; m &= m - 1) {
+        const char *stop = buf + base + (w * 64) + __ctz64(m);
+        size_t flen = (size_t)(stop - field);
+
+        if (type == COLUMN_U64) {
+          ok = __field_u64(field, flen, end, (uint64_t *) out + count, &overflow);
+        }
+        else if (type == COLUMN_I64) {
+          ok = __field_i64(field, flen, end, (int64_t *) out + count, &overflow);
+        }
+        else {
+          ok = __field_f64(field, flen, (double *) out + count, &overflow);
+        }
+        if (!ok) {
+          goto done;
+        }
+        field = stop + 1;
+        if (++count == max) {
+          goto done;
+        }
+      }
+    }
+  }
+
+  // last field, not followed by a separator
+  if ((count < max) && (field < end)) {
+    size_t flen = (size_t)(end - field);
+
+    if (type == COLUMN_U64) {
+      ok = __field_u64(field, flen, end, (uint64_t *) out + count, &overflow);
+    }
+    else if (type == COLUMN_I64) {
+      ok = __field_i64(field, flen, end, (int64_t *) out + count, &overflow);
+    }
+    else {
+      ok = __field_f64(field, flen, (double *) out + count, &overflow);
+    }
+    if (ok) {
+      field = end;
+      count++;
+    }
+  }
+
+done:
+  if (res) {
+    res->len      = (size_t)(field - buf);
+    res->overflow = overflow;
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert unsigned decimal fields
+ *
+ * @param buf  Buffer, not zero terminated
+ * @param len  Buffer length
+ * @param sep  Separator set
+ * @param out  Output array
+ * @param max  Size of output array
+ * @param res  Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Number of fields stored
+ */
+size_t ms_parse_column_u64(const char *buf, size_t len, const ms_charset *sep,
+                           uint64_t *out, size_t max, ms_parse_result *res)
+{
+  return __parse_column(buf, len, sep, out, max, res, COLUMN_U64);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert signed decimal fields, with optional sign
+ *
+ * @param buf  Buffer, not zero terminated
+ * @param len  Buffer length
+ * @param sep  Separator set
+ * @param out  Output array
+ * @param max  Size of output array
+ * @param res  Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Number of fields stored
+ */
+size_t ms_parse_column_i64(const char *buf, size_t len, const ms_charset *sep,
+                           int64_t *out, size_t max, ms_parse_result *res)
+{
+  return __parse_column(buf, len, sep, out, max, res, COLUMN_I64);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert floating-point fields, as strtod() reads them
+ *
+ * @param buf  Buffer, not zero terminated
+ * @param len  Buffer length
+ * @param sep  Separator set
+ * @param out  Output array
+ * @param max  Size of output array
+ * @param res  Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Number of fields stored
+ */
+size_t ms_parse_column_f64(const char *buf, size_t len, const ms_charset *sep,
+                           double *out, size_t max, ms_parse_result *res)
+{
+  return __parse_column(buf, len, sep, out, max, res, COLUMN_F64);
+}
@@ -0,0 +1,30 @@
+#ifndef _COLUMN_H_
+#define _COLUMN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <charset.h>
+#include <string.h>
+
+/**
+ * Bulk conversion of separated numeric fields, for example one CSV
+ * column or a newline separated list of samples, in one call.
+ *
+ * Fields are the runs between bytes of the separator set. Conversion
+ * stops at the end of the buffer, after max fields, or at the first
+ * field that is not entirely a number, an empty field included.
+ * The result tells how far the buffer was consumed: past the separator
+ * after the last stored field, or up to the field that stopped it, so
+ * a caller can resume there. res->overflow is set if any stored value
+ * was out of range and saturated.
+ */
+
+size_t ms_parse_column_u64(const char *buf, size_t len, const ms_charset *sep,
+                           uint64_t *out, size_t max, ms_parse_result *res);
+size_t ms_parse_column_i64(const char *buf, size_t len, const ms_charset *sep,
+                           int64_t *out, size_t max, ms_parse_result *res);
+size_t ms_parse_column_f64(const char *buf, size_t len, const ms_charset *sep,
+                           double *out, size_t max, ms_parse_result *res);
+
+#endif /* _COLUMN_H_ */
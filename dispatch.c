@@ -0,0 +1,52 @@
+/**
+ * Run-time selection of string kernels.
+ */
+
+#include <dispatch.h>
+
+//----------------------------------------------------------------------
+// Every entry at its portable version
+#define MS_STRING_OPS_GENERIC { \
+  __ms_strlen_generic,          \
+  __ms_strnlen_generic,         \
+  __ms_memchr_generic,          \
+  __ms_memrchr_generic,         \
+  __ms_strchr_generic,          \
+  __ms_strchrnul_generic,       \
+  __ms_strrchr_generic,         \
+  __ms_strcmp_generic,          \
+  __ms_strncmp_generic,         \
+  __ms_memmem_short_generic,    \
+  __ms_span_set_generic,        \
+  __ms_span_set_n_generic,      \
+  __ms_set_bitmap_generic,      \
+  __ms_memcpy_generic,          \
+  __ms_memmove_generic,         \
+  __ms_memset_generic,          \
+  __ms_memcmp_generic,          \
+  __ms_strncasecmp_generic,     \
+  __ms_memcasecmp_generic,      \
+  __ms_memcasemem_generic,      \
+  __ms_hex_encode_generic,      \
+  __ms_hex_decode_generic,      \
+  __ms_base64_encode_generic,   \
+  __ms_base64_decode_generic,   \
+}
+
+const struct ms_string_ops __ms_string_ops_generic = MS_STRING_OPS_GENERIC;
+
+// Portable kernels until the CPU has been inspected, so calls made from
+// other constructors before ours runs are still safe.
+struct ms_string_ops __ms_string_ops = MS_STRING_OPS_GENERIC;
+
+//----------------------------------------------------------------------
+/**
+ * Select kernels for the running CPU, once at startup
+ */
+#if defined(__GNUC__)
+__attribute__((constructor))
+#endif
+static void __ms_dispatch_init(void)
+{
+  __ms_dispatch_x86(&__ms_string_ops);
+}
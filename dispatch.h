@@ -0,0 +1,88 @@
+#ifndef _DISPATCH_H_
+#define _DISPATCH_H_
+
+/**
+ * Internal run-time dispatch of the string kernels.
+ *
+ * Every dispatched function has a portable C version (suffix _generic)
+ * that the table starts out with. At startup the table is upgraded to the
+ * fastest kernels the CPU supports. To add a kernel: add a member below,
+ * point the static initializer in dispatch.c at its generic version, and
+ * select the specialized versions in the matching __ms_dispatch_* hook.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <charset.h>
+
+struct ms_string_ops {
+  size_t (*strlen)(const char *s);
+  size_t (*strnlen)(const char *s, size_t max);
+  void * (*memchr)(const void *src, int c, size_t len);
+  void * (*memrchr)(const void *src, int c, size_t len);
+  char * (*strchr)(const char *s, int c);
+  char * (*strchrnul)(const char *s, int c);
+  char * (*strrchr)(const char *s, int c);
+  int    (*strcmp)(const char *s1, const char *s2);
+  int    (*strncmp)(const char *s1, const char *s2, size_t n);
+  void * (*memmem_short)(const void *hay, size_t hlen, const void *needle, size_t nlen);
+  size_t (*span_set)(const char *s, const struct ms_charset *set, int accept);
+  size_t (*span_set_n)(const char *s, size_t n, const struct ms_charset *set, int accept);
+  void   (*set_bitmap)(const char *s, size_t n, const struct ms_charset *set, uint64_t *bits);
+  void * (*memcpy)(void * __restrict dst, const void * __restrict src, size_t len);
+  void * (*memmove)(void *dst, const void *src, size_t len);
+  void * (*memset)(void *dst, int c, size_t len);
+  int    (*memcmp)(const void *s1, const void *s2, size_t len);
+  int    (*strncasecmp)(const char *s1, const char *s2, size_t n);
+  int    (*memcasecmp)(const void *s1, const void *s2, size_t len);
+  void * (*memcasemem)(const void *hay, size_t hlen, const void *needle, size_t nlen);
+  size_t (*hex_encode)(char *dst, const unsigned char *src, size_t n, int upper);
+  size_t (*hex_decode)(unsigned char *dst, const char *src, size_t n, size_t *bad);
+  size_t (*base64_encode)(char *dst, const unsigned char *src, size_t n);
+  size_t (*base64_decode)(unsigned char *dst, const char *src, size_t n, size_t *bad);
+};
+
+extern struct ms_string_ops __ms_string_ops;
+
+// Portable kernels only, what the table starts out with
+extern const struct ms_string_ops __ms_string_ops_generic;
+
+// Portable versions, string.c
+size_t __ms_strlen_generic(const char *s);
+size_t __ms_strnlen_generic(const char *s, size_t max);
+void * __ms_memchr_generic(const void *src, int c, size_t len);
+void * __ms_memrchr_generic(const void *src, int c, size_t len);
+char * __ms_strchr_generic(const char *s, int c);
+char * __ms_strchrnul_generic(const char *s, int c);
+char * __ms_strrchr_generic(const char *s, int c);
+int    __ms_strcmp_generic(const char *s1, const char *s2);
+int    __ms_strncmp_generic(const char *s1, const char *s2, size_t n);
+void * __ms_memmem_short_generic(const void *hay, size_t hlen, const void *needle, size_t nlen);
+size_t __ms_span_set_generic(const char *s, const struct ms_charset *set, int accept);
+size_t __ms_span_set_n_generic(const char *s, size_t n, const struct ms_charset *set, int accept);
+void   __ms_set_bitmap_generic(const char *s, size_t n, const struct ms_charset *set, uint64_t *bits);
+void * __ms_memcpy_generic(void * __restrict dst, const void * __restrict src, size_t len);
+void * __ms_memmove_generic(void *dst, const void *src, size_t len);
+void * __ms_memset_generic(void *dst, int c, size_t len);
+int    __ms_memcmp_generic(const void *s1, const void *s2, size_t len);
+int    __ms_strncasecmp_generic(const char *s1, const char *s2, size_t n);
+int    __ms_memcasecmp_generic(const void *s1, const void *s2, size_t len);
+void * __ms_memcasemem_generic(const void *hay, size_t hlen, const void *needle, size_t nlen);
+
+// Portable versions, codec.c
+size_t __ms_hex_encode_generic(char *dst, const unsigned char *src, size_t n, int upper);
+size_t __ms_hex_decode_generic(unsigned char *dst, const char *src, size_t n, size_t *bad);
+size_t __ms_base64_encode_generic(char *dst, const unsigned char *src, size_t n);
+size_t __ms_base64_decode_generic(unsigned char *dst, const char *src, size_t n, size_t *bad);
+
+// Kernel tiers, each the widest instruction set a CPU may have
+#define MS_TIER_SSE2   (1)
+#define MS_TIER_SSSE3  (2)
+#define MS_TIER_AVX2   (3)
+
+// Architecture hooks, replace table entries the CPU can do better
+void __ms_dispatch_x86(struct ms_string_ops *ops);
+int  __ms_dispatch_x86_tier(struct ms_string_ops *ops, int tier);
+
+#endif /* _DISPATCH_H_ */
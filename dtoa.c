@@ -0,0 +1,103 @@
+/**
+ * Double to text conversion, the shortest round trip digits.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <dtoa.h>
+#include <fpconv.h>
+
+//#define ASSERT(cond)
+#define ASSERT(cond) assert(cond)
+
+//----------------------------------------------------------------------
+/**
+ * Convert double to the shortest text that reads back the same
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_DTOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_dtoa(double v, char *buf)
+{
+  union { double f; uint64_t u; } b;
+  struct __ms_digits dg;
+  char *p = buf;
+  int x;
+  int i;
+
+  ASSERT(buf);
+
+  b.f = v;
+  if (b.u >> 63) {
+    *p++ = '-';
+  }
+  if (((b.u >> 52) & 0x7FF) == 0x7FF) {
+    const char *s = "inf";
+
+    if (b.u & ((1ULL << 52) - 1)) {
+      // no sign for NaN
+      p = buf;
+      s = "nan";
+    }
+    while (*s) {
+      *p++ = *s++;
+    }
+    *p = '\0';
+    return p;
+  }
+
+  __ms_double_shortest(v, &dg);
+  if (dg.nd == 0) {
+    *p++ = '0';
+    *p = '\0';
+    return p;
+  }
+
+  x = dg.dp - 1;
+  if ((x >= -4) && (x < 17)) {
+    if (dg.dp <= 0) {
+      // 0.000ddd
+      *p++ = '0';
+      *p++ = '.';
+      for (i = dg.dp; i < 0; i++) {
+        *p++ = '0';
+      }
+      for (i = 0; i < dg.nd; i++) {
+        *p++ = dg.d[i];
+      }
+    }
+    else {
+      // ddd000 or ddd.ddd
+      for (i = 0; (i < dg.dp) || (i < dg.nd); i++) {
+        if (i == dg.dp) {
+          *p++ = '.';
+        }
+        *p++ = (i < dg.nd) ? dg.d[i] : '0';
+      }
+    }
+  }
+  else {
+    // d.ddde+xx
+    *p++ = dg.d[0];
+    if (dg.nd > 1) {
+      *p++ = '.';
+      for (i = 1; i < dg.nd; i++) {
+        *p++ = dg.d[i];
+      }
+    }
+    *p++ = 'e';
+    *p++ = (x < 0) ? '-' : '+';
+    x = (x < 0) ? -x : x;
+    if (x >= 100) {
+      *p++ = (char)('0' + (x / 100));
+    }
+    *p++ = (char)('0' + ((x / 10) % 10));
+    *p++ = (char)('0' + (x % 10));
+  }
+  *p = '\0';
+  return p;
+}
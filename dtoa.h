@@ -0,0 +1,19 @@
+#ifndef _DTOA_H_
+#define _DTOA_H_
+
+/**
+ * Double to text conversion.
+ *
+ * ms_dtoa() writes the shortest decimal that strtod() reads back as the
+ * same double, followed by a zero terminator, and returns a pointer to
+ * the terminator. The layout is that of %g with as many digits as
+ * needed: plain notation for decimal exponents -4..16, e notation
+ * otherwise, and "inf", "-inf" or "nan" for the special values.
+ */
+
+// Buffer size enough for any value, terminator included
+#define MS_DTOA_LEN (25)
+
+char *ms_dtoa(double v, char *buf);
+
+#endif /* _DTOA_H_ */
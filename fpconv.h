@@ -0,0 +1,68 @@
+#ifndef _FPCONV_H_
+#define _FPCONV_H_
+
+/**
+ * Internal decimal to binary floating-point conversion, and back.
+ *
+ * The string functions scan the text into a struct __ms_decimal and hand
+ * it to the conversion of the wanted type. Numbers of up to 19 digits are
+ * converted with the Eisel-Lemire algorithm, a 64 by 128 bit product with
+ * a table of powers of five. When that cannot decide the rounding, the
+ * digits are converted exactly with a big decimal. The results are
+ * correctly rounded, ties to even. Hexadecimal numbers are rounded
+ * directly from their bits.
+ *
+ * The other way, the shortest digits that read back as the same double
+ * come from the Schubfach algorithm, and digits at a fixed precision are
+ * rounded from those or, when they end at a tie, from the exact value.
+ */
+
+#include <stdint.h>
+
+// Kinds of scanned numbers
+#define MS_DEC_FINITE (0)
+#define MS_DEC_INF    (1)
+#define MS_DEC_NAN    (2)
+#define MS_DEC_HEX    (3)
+
+/**
+ * Number scanned from text, a finite value is w * 10^q, or w * 2^q for
+ * hexadecimal numbers
+ */
+struct __ms_decimal {
+  uint64_t w;              // first 19 significant digits, 16 for hex
+  int64_t q;               // exponent of the last digit in w
+  int truncated;           // non-zero digits did not fit in w
+  int neg;                 // negative sign
+  int kind;                // MS_DEC_*
+  const char *text;        // mantissa text, digits and point, for the exact path
+  const char *text_end;    // end of mantissa text
+  int64_t exp10;           // exponent written after the mantissa
+};
+
+float __ms_decimal_to_float(const struct __ms_decimal *d, int *range);
+double __ms_decimal_to_double(const struct __ms_decimal *d, int *range);
+long double __ms_decimal_to_ldouble(const struct __ms_decimal *d, int *range);
+
+/**
+ * Digits of a double for formatting, the value is 0.d[0]d[1]... * 10^dp.
+ * Digits are ASCII, not terminated, without trailing zeros; zero has
+ * no digits. The sign is not looked at.
+ */
+#define MS_DIGITS_MAX (800)
+
+struct __ms_digits {
+  char d[MS_DIGITS_MAX];   // an exact double has at most 767 digits
+  int nd;                  // number of digits
+  int dp;                  // position of the decimal point
+};
+
+// Rounding position of __ms_double_digits()
+#define MS_DIGITS_SIG  (0) // n significant digits
+#define MS_DIGITS_FRAC (1) // n digits after the decimal point
+
+// finite values only
+void __ms_double_shortest(double v, struct __ms_digits *out);
+void __ms_double_digits(double v, int mode, int n, struct __ms_digits *out);
+
+#endif /* _FPCONV_H_ */
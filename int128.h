@@ -0,0 +1,21 @@
+#ifndef _INT128_H_
+#define _INT128_H_
+
+/**
+ * 128-bit integer types, on compilers that have them. Everything using
+ * them is left out when MS_HAVE_INT128 is 0.
+ */
+#if defined(__SIZEOF_INT128__)
+#define MS_HAVE_INT128 (1)
+
+__extension__ typedef unsigned __int128 ms_u128;
+__extension__ typedef __int128 ms_i128;
+
+#define MS_U128_MAX (~(ms_u128) 0)
+#define MS_I128_MAX ((ms_i128)(MS_U128_MAX >> 1))
+#define MS_I128_MIN (-MS_I128_MAX - 1)
+#else
+#define MS_HAVE_INT128 (0)
+#endif
+
+#endif /* _INT128_H_ */
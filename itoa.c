@@ -0,0 +1,425 @@
+/**
+ * Integer to text conversion.
+ *
+ * The digit count is computed first, from the bit length and a table
+ * of powers of ten, so the digits can be stored straight into their
+ * final place from the last one backwards, and the text never has to
+ * be reversed or moved. Decimal digits are produced two at a time from
+ * a table of the pairs 00..99, and 64-bit values are split into
+ * 8 digit chunks so most divisions are 32-bit. 128-bit values are split
+ * into 19 digit chunks with a multiply by the reciprocal of 10^19, so
+ * no 128-bit division is ever done.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <itoa.h>
+
+//#define ASSERT(cond)
+#define ASSERT(cond) assert(cond)
+
+// Decimal digit pairs
+static const char __digits2[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const uint64_t __pow10_u64[20] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+  100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static const char __hex_lower[16] = "0123456789abcdef";
+static const char __hex_upper[16] = "0123456789ABCDEF";
+
+//----------------------------------------------------------------------
+/**
+ * Get number of significant bits
+ *
+ * @param v  Value
+ *
+ * @return Bit length, 1 for 0
+ */
+static inline unsigned int __bits64(uint64_t v)
+{
+#if defined(__GNUC__)
+  return 64 - (unsigned int) __builtin_clzll(v | 1);
+#else
+  unsigned int n = 1;
+
+  while (v >>= 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+//----------------------------------------------------------------------
+/**
+ * Get number of decimal digits
+ *
+ * @param v  Value
+ *
+ * @return Digit count, 1 for 0
+ */
+static inline unsigned int __digits10(uint64_t v)
+{
+  // floor(bits * log10(2)) is the count or one less
+  unsigned int t = (__bits64(v) * 1233) >> 12;
+
+  return t + 1 - ((v | 1) < __pow10_u64[t]);
+}
+
+//----------------------------------------------------------------------
+static inline void __put2(char *p, uint32_t r)
+{
+  p[0] = __digits2[2 * r];
+  p[1] = __digits2[(2 * r) + 1];
+}
+
+//----------------------------------------------------------------------
+/**
+ * Store all digits of 32-bit value, backwards
+ *
+ * @param p  One past the last digit
+ * @param v  Value
+ */
+static inline void __put_u32(char *p, uint32_t v)
+{
+  while (v >= 100) {
+    uint32_t q = v / 100;
+    p -= 2;
+    __put2(p, v - (q * 100));
+    v = q;
+  }
+  if (v >= 10) {
+    __put2(p - 2, v);
+  }
+  else {
+    p[-1] = (char)('0' + v);
+  }
+}
+
+//----------------------------------------------------------------------
+/**
+ * Store exactly 8 digits, leading zeros included
+ *
+ * @param p  First digit
+ * @param v  Value below 100000000
+ */
+static inline void __put_8(char *p, uint32_t v)
+{
+  uint32_t hi = v / 10000;
+  uint32_t lo = v - (hi * 10000);
+
+  __put2(p,     hi / 100);
+  __put2(p + 2, hi % 100);
+  __put2(p + 4, lo / 100);
+  __put2(p + 6, lo % 100);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert unsigned value to decimal text
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_U32TOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_u32toa(uint32_t v, char *buf)
+{
+  char *end;
+
+  ASSERT(buf);
+
+  end = buf + __digits10(v);
+  *end = '\0';
+  __put_u32(end, v);
+  return end;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert unsigned value to decimal text
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_U64TOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_u64toa(uint64_t v, char *buf)
+{
+  char *end;
+  char *p;
+
+  ASSERT(buf);
+
+  end = buf + __digits10(v);
+  *end = '\0';
+  p = end;
+  while (v > UINT32_MAX) {
+    uint64_t q = v / 100000000;
+    p -= 8;
+    __put_8(p, (uint32_t)(v - (q * 100000000)));
+    v = q;
+  }
+  __put_u32(p, (uint32_t) v);
+  return end;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert signed value to decimal text, with a '-' if negative
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_I64TOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_i64toa(int64_t v, char *buf)
+{
+  ASSERT(buf);
+
+  if (v < 0) {
+    *buf++ = '-';
+    return ms_u64toa(0 - (uint64_t) v, buf);
+  }
+  return ms_u64toa((uint64_t) v, buf);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert value to hexadecimal text
+ *
+ * @param v      Value
+ * @param buf    Output, at least MS_HEXTOA_LEN bytes
+ * @param upper  Use upper case letters
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_u64toa_hex(uint64_t v, char *buf, int upper)
+{
+  const char *digits = upper ? __hex_upper : __hex_lower;
+  char *end;
+  char *p;
+
+  ASSERT(buf);
+
+  end = buf + ((__bits64(v) + 3) >> 2);
+  *end = '\0';
+  for (p = end; p != buf; v >>= 4) {
+    *--p = digits[v & 15];
+  }
+  return end;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Get length of the decimal text of a value, without converting it
+ *
+ * @param v  Value
+ *
+ * @return Number of digits
+ */
+unsigned int ms_u64len(uint64_t v)
+{
+  return __digits10(v);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Get length of the hexadecimal text of a value, without converting it
+ *
+ * @param v  Value
+ *
+ * @return Number of digits
+ */
+unsigned int ms_u64len_hex(uint64_t v)
+{
+  return (__bits64(v) + 3) >> 2;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert value to octal text
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_OCTTOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_u64toa_oct(uint64_t v, char *buf)
+{
+  char *end;
+  char *p;
+
+  ASSERT(buf);
+
+  end = buf + ((__bits64(v) + 2) / 3);
+  *end = '\0';
+  for (p = end; p != buf; v >>= 3) {
+    *--p = (char)('0' + (v & 7));
+  }
+  return end;
+}
+
+#if MS_HAVE_INT128
+// 10^19, the largest power of ten below 2^64, and its reciprocal
+// floor((2^128 - 1) / 10^19) - 2^64 for __div_1e19()
+#define P19     (10000000000000000000ULL)
+#define P19_INV (0xD83C94FB6D2AC34AULL)
+
+//----------------------------------------------------------------------
+/**
+ * Divide 128-bit value by 10^19 in place
+ *
+ * The upper word is divided by a constant, which compiles to a
+ * multiply. The remainder and the lower word are divided with the
+ * 2-by-1 reciprocal method of Moller and Granlund, "Improved division by
+ * invariant integers" (2011); 10^19 has its top bit set, so it needs no
+ * normalising shift.
+ *
+ * @param hi  Upper 64 bits, also out parameter
+ * @param lo  Lower 64 bits, also out parameter
+ *
+ * @return Remainder
+ */
+static inline uint64_t __div_1e19(uint64_t *hi, uint64_t *lo)
+{
+  const uint64_t u1 = *hi % P19;
+  const uint64_t u0 = *lo;
+  ms_u128 q = ((ms_u128) P19_INV * u1) + (((ms_u128) u1 << 64) | u0);
+  uint64_t q1 = (uint64_t)(q >> 64) + 1;
+  uint64_t r = u0 - (q1 * P19);
+
+  if (r > (uint64_t) q) {
+    q1--;
+    r += P19;
+  }
+  if (r >= P19) {
+    q1++;
+    r -= P19;
+  }
+  *hi /= P19;
+  *lo = q1;
+  return r;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Store exactly 19 digits, leading zeros included
+ *
+ * @param p  First digit
+ * @param v  Value below 10^19
+ */
+static inline void __put_19(char *p, uint64_t v)
+{
+  uint64_t lo = v % 10000000000000000ULL;
+  uint32_t hi = (uint32_t)(v / 10000000000000000ULL);
+
+  p[0] = (char)('0' + (hi / 100));
+  __put2(p + 1, hi % 100);
+  __put_8(p + 3, (uint32_t)(lo / 100000000));
+  __put_8(p + 11, (uint32_t)(lo % 100000000));
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert unsigned 128-bit value to decimal text
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_U128TOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_u128toa(ms_u128 v, char *buf)
+{
+  uint64_t hi = (uint64_t)(v >> 64);
+  uint64_t lo = (uint64_t) v;
+  uint64_t low;
+
+  ASSERT(buf);
+
+  if (!hi) {
+    return ms_u64toa(lo, buf);
+  }
+  low = __div_1e19(&hi, &lo);
+  if (hi) {
+    // at most 39 digits, the lead is a single digit
+    uint64_t mid = __div_1e19(&hi, &lo);
+
+    *buf++ = (char)('0' + lo);
+    __put_19(buf, mid);
+    buf += 19;
+  }
+  else {
+    buf = ms_u64toa(lo, buf);
+  }
+  __put_19(buf, low);
+  buf[19] = '\0';
+  return buf + 19;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert signed 128-bit value to decimal text, with a '-' if negative
+ *
+ * @param v    Value
+ * @param buf  Output, at least MS_I128TOA_LEN bytes
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_i128toa(ms_i128 v, char *buf)
+{
+  ASSERT(buf);
+
+  if (v < 0) {
+    *buf++ = '-';
+    return ms_u128toa(0 - (ms_u128) v, buf);
+  }
+  return ms_u128toa((ms_u128) v, buf);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert 128-bit value to hexadecimal text
+ *
+ * @param v      Value
+ * @param buf    Output, at least MS_HEX128TOA_LEN bytes
+ * @param upper  Use upper case letters
+ *
+ * @return Pointer to the terminator
+ */
+char *ms_u128toa_hex(ms_u128 v, char *buf, int upper)
+{
+  const char *digits = upper ? __hex_upper : __hex_lower;
+  uint64_t hi = (uint64_t)(v >> 64);
+  char *end;
+  char *p;
+
+  ASSERT(buf);
+
+  if (!hi) {
+    return ms_u64toa_hex((uint64_t) v, buf, upper);
+  }
+  end = ms_u64toa_hex(hi, buf, upper) + 16;
+  *end = '\0';
+  for (p = end; p != end - 16; v >>= 4) {
+    *--p = digits[v & 15];
+  }
+  return end;
+}
+#endif
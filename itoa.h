@@ -0,0 +1,41 @@
+#ifndef _ITOA_H_
+#define _ITOA_H_
+
+#include <stdint.h>
+#include <int128.h>
+
+/**
+ * Integer to text conversion.
+ *
+ * Each function writes the digits followed by a zero terminator to buf
+ * and returns a pointer to the terminator, so the text length is the
+ * returned pointer minus buf. No prefix or padding is written, and
+ * hexadecimal letters are lower case unless upper is set.
+ */
+
+// Buffer sizes enough for any value, terminator included
+#define MS_U32TOA_LEN (11)
+#define MS_U64TOA_LEN (21)
+#define MS_I64TOA_LEN (21)
+#define MS_HEXTOA_LEN (17)
+#define MS_OCTTOA_LEN (23)
+#define MS_U128TOA_LEN (40)
+#define MS_I128TOA_LEN (41)
+#define MS_HEX128TOA_LEN (33)
+
+char *ms_u32toa(uint32_t v, char *buf);
+char *ms_u64toa(uint64_t v, char *buf);
+char *ms_i64toa(int64_t v, char *buf);
+char *ms_u64toa_hex(uint64_t v, char *buf, int upper);
+char *ms_u64toa_oct(uint64_t v, char *buf);
+
+unsigned int ms_u64len(uint64_t v);
+unsigned int ms_u64len_hex(uint64_t v);
+
+#if MS_HAVE_INT128
+char *ms_u128toa(ms_u128 v, char *buf);
+char *ms_i128toa(ms_i128 v, char *buf);
+char *ms_u128toa_hex(ms_u128 v, char *buf, int upper);
+#endif
+
+#endif /* _ITOA_H_ */
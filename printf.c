@@ -1,279 +1,1180 @@
-/**
- * This version is based on a public domain version of printf.
- */
-
-#include <stdarg.h>
-#include <stddef.h>
-#include <stdio.h>
-#include <stdint.h>
-#include <string.h>
-
-#include <printf.h>
-
-#define __printchar(out,c) printf("%c",(c));
-
-//---------------------------------------
-
-#define PRINT_PAD_RIGHT (1)
-#define PRINT_PAD_ZERO  (2)
-
-//---------------------------------------
-static int prints(char **out, const char *string, int width, int pad)
-{
-  register int pc = 0;
-  register int padchar = ' ';
-
-  if (width > 0) {
-    register int len = 0;
-    register const char *ptr;
-    for (ptr = string; *ptr; ++ptr)
-      ++len;
-    if (len >= width)
-      width = 0;
-    else
-      width -= len;
-    if (pad & PRINT_PAD_ZERO)
-      padchar = '0';
-  }
-  if (!(pad & PRINT_PAD_RIGHT)) {
-    for (; width > 0; --width) {
-      __printchar(out, padchar);
-      ++pc;
-    }
-  }
-  for (; *string ; ++string) {
-    __printchar(out, *string);
-    ++pc;
-  }
-  for (; width > 0; --width) {
-    __printchar(out, padchar);
-    ++pc;
-  }
-
-  return pc;
-}
-
-/* following length should be enough for 32 bit int */
-#define PRINTI_BUF_LEN  (12)
-
-static int printi(char **out, int i, int b, int sg, int width, int pad, int letbase)
-{
-  char printi_buf[PRINTI_BUF_LEN];
-
-  register char *s;
-  register int t, neg = 0, pc = 0;
-  register unsigned int u = i;
-
-  if (i == 0) {
-    printi_buf[0] = '0';
-    printi_buf[1] = '\0';
-    return prints(out, printi_buf, width, pad);
-  }
-
-  if (sg && (b == 10) && (i < 0)) {
-    neg = 1;
-    u = -i;
-  }
-
-  s = printi_buf + PRINTI_BUF_LEN - 1;
-  *s = '\0';
-
-  while (u) {
-    t = u % b;
-    if (t >= 10)
-      t += letbase - '0'- 10;
-    *--s = t + '0';
-    u /= b;
-  }
-
-  if (neg) {
-    if (width && (pad & PRINT_PAD_ZERO)) {
-      __printchar(out, '-');
-      ++pc;
-      --width;
-    } else {
-      *--s = '-';
-    }
-  }
-
-  return pc + prints(out, s, width, pad);
-}
-
-//------------------------------------------------------
-int pprint(char **out, const char *format, va_list args)
-{
-  register int width, pad, longlong;
-  register int pc = 0;
-  char scr[2];
-
-  for (; *format != 0; ++format) {
-    if (*format == '%') {
-      ++format;
-      width = pad = longlong = 0;
-      if (*format == '\0')
-        break;
-      if (*format == '%')
-        goto print_out;
-      if (*format == '-') {
-        ++format;
-        pad = PRINT_PAD_RIGHT;
-      }
-      while (*format == '0') {
-        ++format;
-        pad |= PRINT_PAD_ZERO;
-      }
-      for (; (*format >= '0') && (*format <= '9'); ++format) {
-        width *= 10;
-        width += *format - '0';
-      }
-      if (*format == 'l') {
-        ++format;
-        if (*format == 'l') {
-          ++format;
-          longlong = 1;
-        }
-      }
-      if (*format == 'h') {
-        ++format;
-        if (*format == 'h') {
-          ++format;
-        }
-      }
-
-      char fmt = *format;
-      switch (fmt) {
-      case 'd':
-      case 'i':
-      case 'x':
-      case 'X':
-      case 'u': {
-        int  intbase = 10;
-        char ascbase = 'a';
-        int  addsign = 1;
-        int  width_longlong = 0;
-        int  ival_hi = 0;
-        int  ival;
-
-        if (longlong) {
-          long long llval = va_arg( args, long long );
-          // fix width if longlong (only works for X)
-          width_longlong = width;
-          if (width > 8) {
-            width = 8;
-          }
-          ival    = (int)(llval << 32);
-          ival_hi = (int)(llval & 0xFFFFFFFF);
-        }
-        else {
-          // short int and char is converted to long int by compiler
-          ival = va_arg( args, int );
-        }
-
-        if (fmt == 'x') {
-          intbase = 16;
-          addsign = 0;
-        }
-        else if (fmt == 'X') {
-          intbase = 16;
-          addsign = 0;
-          ascbase = 'A';
-        }
-        else if (fmt == 'u') {
-          addsign = 0;
-        }
-
-        // skip if zero and long long
-        if (!(longlong && (ival == 0) && (width_longlong <= 8))) {
-          int printed_chars = printi(out, ival, intbase, addsign, width, pad, ascbase);
-          pc += printed_chars;
-          width_longlong -= printed_chars;
-        }
-
-        if (longlong) {
-          pc += printi(out, ival_hi, intbase, addsign, width_longlong, pad, ascbase);
-        }
-        continue;
-      }
-      case 'p': {
-        register int p = va_arg( args, int );
-        pc += printi(out, p, 16, 0, width, pad, 'A');
-        continue;
-      }
-      case 's': {
-        register char *s = (char *)va_arg( args, char * );
-        pc += prints(out, s ? s : "(null)", width, pad);
-        continue;
-      }
-      case 'c': {
-        /* char are converted to int then pushed on the stack */
-        scr[0] = (char)va_arg( args, int );
-        scr[1] = '\0';
-        pc += prints(out, scr, width, pad);
-        continue;
-      }
-      default:
-        break;
-      } // switch
-
-    } else {
-      print_out: __printchar(out, *format);
-      ++pc;
-    }
-  }
-  if (out)
-    **out = '\0';
-  va_end(args );
-  return pc;
-}
-
-//----------------------------------------------------
-// if out is NULL, send to stdout (0)
-int sprintf(char *out, const char *format, ...)
-{
-  int ret;
-  va_list args;
-  va_start(args, format);
-  if (out)
-    ret = pprint(&out, format, args);
-  else
-    ret = pprint(0, format, args);
-  return ret;
-}
-
-//----------------------------------------------------
-// TODO: check size n
-int snprintf(char *out, size_t size, const char *format, ...)
-{
-  int ret;
-  va_list args;
-  va_start(args, format);
-  if (out)
-    ret = pprint(&out, format, args);
-  else
-    ret = pprint(0, format, args);
-  return ret;
-}
-
-//----------------------------------------------------
-// if out is NULL, send to stdout (0)
-int vsprintf(char *out, const char *format, va_list args)
-{
-  int ret;
-  if (out)
-    ret = pprint(&out, format, args);
-  else
-    ret = pprint(0, format, args);
-  return ret;
-}
-
-//----------------------------------------------------
-// TODO: check size n
-int vsnprintf(char *out, size_t size, const char *format, va_list args)
-{
-  int ret;
-  if (out)
-    ret = pprint(&out, format, args);
-  else
-    ret = pprint(0, format, args);
-  return ret;
-}
+/**
+ * This version is based on a public domain version of printf.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <printf.h>
+#include <dispatch.h>
+#include <itoa.h>
+#include <fpconv.h>
+#include <ascii.h>
+
+//---------------------------------------
+// Output sinks
+
+static inline void __sink_put(ms_sink *sink, const char *s, size_t n)
+{
+  if (n <= sink->room) {
+    __ms_string_ops.memcpy(sink->p, s, n);
+    sink->p    += n;
+    sink->room -= n;
+  } else {
+    sink->spill(sink, s, n);
+  }
+}
+
+static inline void __sink_putc(ms_sink *sink, char c)
+{
+  if (sink->room) {
+    *sink->p++ = c;
+    sink->room--;
+  } else {
+    sink->spill(sink, &c, 1);
+  }
+}
+
+// n copies of c, in blocks when they do not fit the room
+static void __sink_fill(ms_sink *sink, char c, size_t n)
+{
+  char fill[64];
+
+  if (n <= sink->room) {
+    __ms_string_ops.memset(sink->p, c, n);
+    sink->p    += n;
+    sink->room -= n;
+    return;
+  }
+  __ms_string_ops.memset(fill, c, (n < sizeof(fill)) ? n : sizeof(fill));
+  while (n > 0) {
+    size_t k = (n < sizeof(fill)) ? n : sizeof(fill);
+    __sink_put(sink, fill, k);
+    n -= k;
+  }
+}
+
+#define __printchar(out,c) __sink_putc((out),(c))
+
+static void __sink_drop(ms_sink *sink, const char *s, size_t n)
+{
+}
+
+// nothing more can be stored, text only has to be counted
+static inline int __sink_full(const ms_sink *sink)
+{
+  return (sink->room == 0) && (sink->spill == __sink_drop);
+}
+
+// memory sinks, the terminator is not counted and written over next call
+static void __sink_mem_finish(ms_sink *sink)
+{
+  if (sink->p)
+    *sink->p = '\0';
+}
+
+// bounded buffer, keep what fits and drop the rest
+static void __sink_buf_spill(ms_sink *sink, const char *s, size_t n)
+{
+  __ms_string_ops.memcpy(sink->p, s, sink->room);
+  sink->p    += sink->room;
+  sink->room  = 0;
+  sink->spill = __sink_drop;
+}
+
+// hand text on to the file, fd or callback
+static int __sink_emit(ms_sink *sink, const char *s, size_t n)
+{
+  if (sink->fn)
+    return sink->fn(sink->ctx, s, n);
+  if (sink->fp)
+    return (fwrite(s, 1, n, sink->fp) == n) ? 0 : -1;
+  while (n > 0) {
+    ssize_t w = write(sink->fd, s, n);
+    if (w < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    s += w;
+    n -= (size_t) w;
+  }
+  return 0;
+}
+
+static void __sink_stage_finish(ms_sink *sink)
+{
+  size_t n = (size_t)(sink->p - sink->stage);
+
+  sink->p    = sink->stage;
+  sink->room = MS_SINK_STAGE;
+  if (n && !sink->error && __sink_emit(sink, sink->stage, n)) {
+    sink->error = 1;
+    sink->spill = __sink_drop;
+    sink->room  = 0;
+  }
+}
+
+// stage full, spans longer than the stage bypass it
+static void __sink_stage_spill(ms_sink *sink, const char *s, size_t n)
+{
+  __sink_stage_finish(sink);
+  if (sink->error)
+    return;
+  if (n < MS_SINK_STAGE) {
+    __sink_put(sink, s, n);
+  } else if (__sink_emit(sink, s, n)) {
+    sink->error = 1;
+    sink->spill = __sink_drop;
+    sink->room  = 0;
+  }
+}
+
+static void __sink_init(ms_sink *sink)
+{
+  sink->p      = sink->stage;
+  sink->room   = MS_SINK_STAGE;
+  sink->spill  = __sink_stage_spill;
+  sink->finish = __sink_stage_finish;
+  sink->fp     = NULL;
+  sink->fd     = -1;
+  sink->fn     = NULL;
+  sink->ctx    = NULL;
+  sink->error  = 0;
+}
+
+//---------------------------------------
+/**
+ * Set up sink writing to memory without bound, zero terminated
+ *
+ * @param sink  Sink
+ * @param buf   Output buffer
+ */
+void ms_sink_mem(ms_sink *sink, char *buf)
+{
+  __sink_init(sink);
+  sink->p      = buf;
+  sink->room   = SIZE_MAX;
+  sink->spill  = __sink_drop;
+  sink->finish = __sink_mem_finish;
+}
+
+//---------------------------------------
+/**
+ * Set up sink writing at most size bytes to memory, the terminator
+ * included. Text that does not fit is dropped.
+ *
+ * @param sink  Sink
+ * @param buf   Output buffer, may be NULL if size is 0
+ * @param size  Size of buffer
+ */
+void ms_sink_buf(ms_sink *sink, char *buf, size_t size)
+{
+  __sink_init(sink);
+  sink->p      = size ? buf : NULL;
+  sink->room   = size ? (size - 1) : 0;
+  sink->spill  = size ? __sink_buf_spill : __sink_drop;
+  sink->finish = __sink_mem_finish;
+}
+
+//---------------------------------------
+/**
+ * Set up sink writing to a stdio stream, one fwrite() per stage
+ *
+ * @param sink  Sink
+ * @param fp    Stream
+ */
+void ms_sink_file(ms_sink *sink, FILE *fp)
+{
+  __sink_init(sink);
+  sink->fp = fp;
+}
+
+//---------------------------------------
+/**
+ * Set up sink writing to a file descriptor, one write() per stage
+ *
+ * @param sink  Sink
+ * @param fd    File descriptor
+ */
+void ms_sink_fd(ms_sink *sink, int fd)
+{
+  __sink_init(sink);
+  sink->fd = fd;
+}
+
+//---------------------------------------
+/**
+ * Set up sink passing text to a callback, one call per stage
+ *
+ * @param sink  Sink
+ * @param fn    Output function
+ * @param ctx   User context for fn
+ */
+void ms_sink_callback(ms_sink *sink, ms_sink_fn fn, void *ctx)
+{
+  __sink_init(sink);
+  sink->fn  = fn;
+  sink->ctx = ctx;
+}
+
+//---------------------------------------
+
+#define PRINT_PAD_RIGHT (1)
+#define PRINT_PAD_ZERO  (2)
+
+//---------------------------------------
+static int printsn(ms_sink *out, const char *string, int len, int width, int pad)
+{
+  register int pc = 0;
+  register int padchar = ' ';
+
+  if (__sink_full(out))
+    return (width > len) ? width : len;
+  if (width > 0) {
+    if (len >= width)
+      width = 0;
+    else
+      width -= len;
+    if (pad & PRINT_PAD_ZERO)
+      padchar = '0';
+  }
+  if (!(pad & PRINT_PAD_RIGHT) && (width > 0)) {
+    __sink_fill(out, (char) padchar, (size_t) width);
+    pc += width;
+    width = 0;
+  }
+  if (len > 0) {
+    __sink_put(out, string, (size_t) len);
+    pc += len;
+  }
+  if (width > 0) {
+    __sink_fill(out, (char) padchar, (size_t) width);
+    pc += width;
+  }
+
+  return pc;
+}
+
+//---------------------------------------
+// at most prec characters if prec >= 0, string need not be terminated then
+static int prints(ms_sink *out, const char *string, int prec, int width, int pad)
+{
+  size_t len = (prec < 0) ? __ms_string_ops.strlen(string) :
+                            __ms_string_ops.strnlen(string, (size_t) prec);
+
+  return printsn(out, string, (int) len, width, pad);
+}
+
+//---------------------------------------
+// integer with a precision: zeros after the sign up to prec digits, the
+// '0' flag does not apply and the width is padded with spaces
+static int printprec(ms_sink *out, const char *digits, int len, int neg, int prec, int width, int pad)
+{
+  int zeros = (prec > len) ? (prec - len) : 0;
+  int n = neg + zeros + len;
+  int fill = (width > n) ? (width - n) : 0;
+
+  if (!(pad & PRINT_PAD_RIGHT) && (fill > 0)) {
+    __sink_fill(out, ' ', (size_t) fill);
+  }
+  if (neg) {
+    __printchar(out, '-');
+  }
+  if (zeros > 0) {
+    __sink_fill(out, '0', (size_t) zeros);
+  }
+  if (len > 0) {
+    __sink_put(out, digits, (size_t) len);
+  }
+  if ((pad & PRINT_PAD_RIGHT) && (fill > 0)) {
+    __sink_fill(out, ' ', (size_t) fill);
+  }
+  return n + fill;
+}
+
+/* following length should be enough for 64 bit int, any base */
+#define PRINTI_BUF_LEN  (MS_I64TOA_LEN)
+
+// Integer argument sizes, from the length modifier
+#define PRINT_SIZE_INT       (0)
+#define PRINT_SIZE_CHAR      (1)
+#define PRINT_SIZE_SHORT     (2)
+#define PRINT_SIZE_LONG      (3)
+#define PRINT_SIZE_LONGLONG  (4)
+#define PRINT_SIZE_SIZE_T    (5)
+#define PRINT_SIZE_INTMAX    (6)
+#define PRINT_SIZE_PTRDIFF   (7)
+#define PRINT_SIZE_LONGDOUBLE (8)
+#define PRINT_SIZE_INT128    (9)
+#define PRINT_SIZE_PTR       (10)
+
+// digits come from the itoa tables, already at their final place
+static int printi(ms_sink *out, unsigned long long u, int b, int sg, int width, int pad, int letbase,
+                  int prec)
+{
+  char printi_buf[PRINTI_BUF_LEN];
+  char *end;
+  int pc = 0;
+
+  if (__sink_full(out)) {
+    // measure only, no digits
+    int neg = sg && (b == 10) && ((long long) u < 0);
+    int len = (b == 16) ? (int) ms_u64len_hex(u) : (int) ms_u64len(neg ? (0 - u) : u);
+
+    if (prec >= 0) {
+      len = (!u && !prec) ? 0 : (prec > len) ? prec : len;
+    }
+    len += neg;
+    return (width > len) ? width : len;
+  }
+  if (prec >= 0) {
+    int neg = sg && (b == 10) && ((long long) u < 0);
+
+    end = (b == 16) ? ms_u64toa_hex(u, printi_buf, letbase == 'A') :
+                      ms_u64toa(neg ? (0 - u) : u, printi_buf);
+    // zero with precision 0 has no digits
+    return printprec(out, printi_buf, (u || prec) ? (int)(end - printi_buf) : 0, neg, prec,
+                     width, pad);
+  }
+  if (sg && (b == 10) && ((long long) u < 0)) {
+    if (width && (pad & PRINT_PAD_ZERO)) {
+      __printchar(out, '-');
+      ++pc;
+      --width;
+      end = ms_u64toa(0 - u, printi_buf);
+    } else {
+      end = ms_i64toa((long long) u, printi_buf);
+    }
+  } else if (b == 16) {
+    end = ms_u64toa_hex(u, printi_buf, letbase == 'A');
+  } else {
+    end = ms_u64toa(u, printi_buf);
+  }
+
+  return pc + printsn(out, printi_buf, (int)(end - printi_buf), width, pad);
+}
+
+#if MS_HAVE_INT128
+//---------------------------------------
+// digit count of a 128-bit value from its halves, no digits generated
+static int printlen128(ms_u128 u, int b)
+{
+  uint64_t hi = (uint64_t)(u >> 64);
+  ms_u128 p = (ms_u128) 10000000000000000000ull * 10;
+  int len = 20;
+
+  if (!hi)
+    return (b == 16) ? (int) ms_u64len_hex((uint64_t) u) : (int) ms_u64len((uint64_t) u);
+  if (b == 16)
+    return 16 + (int) ms_u64len_hex(hi);
+  // at least 2^64, which has 20 digits
+  for (; (len < 39) && (u >= p); len++)
+    p *= 10;
+  return len;
+}
+
+//---------------------------------------
+static int printi128(ms_sink *out, ms_u128 u, int b, int sg, int width, int pad, int letbase,
+                     int prec)
+{
+  char printi_buf[MS_I128TOA_LEN];
+  char *end;
+  int pc = 0;
+
+  if (__sink_full(out)) {
+    // measure only, no digits
+    int neg = sg && (b == 10) && ((ms_i128) u < 0);
+    int len = printlen128(neg ? (0 - u) : u, b);
+
+    if (prec >= 0) {
+      len = (!u && !prec) ? 0 : (prec > len) ? prec : len;
+    }
+    len += neg;
+    return (width > len) ? width : len;
+  }
+  if (prec >= 0) {
+    int neg = sg && (b == 10) && ((ms_i128) u < 0);
+
+    end = (b == 16) ? ms_u128toa_hex(u, printi_buf, letbase == 'A') :
+                      ms_u128toa(neg ? (0 - u) : u, printi_buf);
+    return printprec(out, printi_buf, (u || prec) ? (int)(end - printi_buf) : 0, neg, prec,
+                     width, pad);
+  }
+  if (sg && (b == 10) && ((ms_i128) u < 0)) {
+    if (width && (pad & PRINT_PAD_ZERO)) {
+      __printchar(out, '-');
+      ++pc;
+      --width;
+      end = ms_u128toa(0 - u, printi_buf);
+    } else {
+      end = ms_i128toa((ms_i128) u, printi_buf);
+    }
+  } else if (b == 16) {
+    end = ms_u128toa_hex(u, printi_buf, letbase == 'A');
+  } else {
+    end = ms_u128toa(u, printi_buf);
+  }
+
+  return pc + printsn(out, printi_buf, (int)(end - printi_buf), width, pad);
+}
+#endif
+
+//------------------------------------------------------
+// Floating-point conversions. The text is described as runs of digits
+// and zeros around the point, so precisions far beyond the exact digits
+// need no buffer.
+
+struct print_float {
+  char pre[4];             // sign and 0x
+  int npre;
+  const char *s1;          // integer digits
+  int n1;
+  int z1;                  //   and zeros after them
+  int point;               // decimal point
+  int z2;                  // fraction zeros before the digits
+  const char *s2;          // fraction digits
+  int n2;
+  int z3;                  //   and zeros after them
+  char exp[8];             // exponent
+  int nexp;
+};
+
+static int printz(ms_sink *out, int c, int n)
+{
+  if (n <= 0)
+    return 0;
+  __sink_fill(out, (char) c, (size_t) n);
+  return n;
+}
+
+static int printpf(ms_sink *out, const struct print_float *f, int width, int pad)
+{
+  register int pc = 0;
+  int len = f->npre + f->n1 + f->z1 + f->point + f->z2 + f->n2 + f->z3 + f->nexp;
+  int fill = (width > len) ? (width - len) : 0;
+
+  if (!(pad & (PRINT_PAD_RIGHT | PRINT_PAD_ZERO)))
+    pc += printz(out, ' ', fill);
+  pc += printsn(out, f->pre, f->npre, 0, 0);
+  if ((pad & PRINT_PAD_ZERO) && !(pad & PRINT_PAD_RIGHT))
+    pc += printz(out, '0', fill);
+  pc += printsn(out, f->s1, f->n1, 0, 0);
+  pc += printz(out, '0', f->z1);
+  pc += printz(out, '.', f->point);
+  pc += printz(out, '0', f->z2);
+  pc += printsn(out, f->s2, f->n2, 0, 0);
+  pc += printz(out, '0', f->z3);
+  pc += printsn(out, f->exp, f->nexp, 0, 0);
+  if (pad & PRINT_PAD_RIGHT)
+    pc += printz(out, ' ', fill);
+  return pc;
+}
+
+// exponent after the mantissa, at least mind digits
+static void printexp(struct print_float *f, int c, int x, int mind)
+{
+  char *end;
+
+  f->exp[0] = (char) c;
+  f->exp[1] = (x < 0) ? '-' : '+';
+  f->nexp = 2;
+  if ((x > -10) && (x < 10) && (mind > 1))
+    f->exp[f->nexp++] = '0';
+  end = ms_u32toa((x < 0) ? (unsigned int) -x : (unsigned int) x, f->exp + f->nexp);
+  f->nexp = (int)(end - f->exp);
+}
+
+// fixed notation of the digits, prec fraction digits
+static void printfixed(struct print_float *f, const struct __ms_digits *dg, int prec)
+{
+  int lead = (dg->dp > 0) ? dg->dp : 0;
+
+  if (dg->dp > 0) {
+    f->s1 = dg->d;
+    f->n1 = (dg->nd < dg->dp) ? dg->nd : dg->dp;
+    f->z1 = dg->dp - f->n1;
+  } else {
+    f->s1 = "0";
+    f->n1 = 1;
+  }
+  f->point = (prec > 0);
+  f->z2 = (-dg->dp > prec) ? prec : ((dg->dp < 0) ? -dg->dp : 0);
+  f->s2 = dg->d + lead;
+  f->n2 = (dg->nd > lead) ? (dg->nd - lead) : 0;
+  f->z3 = prec - f->z2 - f->n2;
+}
+
+// e notation of the digits, prec fraction digits
+static void printsci(struct print_float *f, const struct __ms_digits *dg, int prec, int upper)
+{
+  f->s1 = dg->nd ? dg->d : "0";
+  f->n1 = 1;
+  f->point = (prec > 0);
+  f->s2 = dg->d + 1;
+  f->n2 = (dg->nd > 1) ? (dg->nd - 1) : 0;
+  f->z3 = prec - f->n2;
+  printexp(f, upper ? 'E' : 'e', dg->nd ? (dg->dp - 1) : 0, 2);
+}
+
+// %a, hexadecimal significand and binary exponent
+static void printhex(struct print_float *f, uint64_t mant, int exp, int prec, int upper,
+                     char *buf)
+{
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  uint64_t lead = (exp != 0);
+  int x = (exp == 0) ? ((mant == 0) ? 0 : -1022) : (exp - 1023);
+  int n = 13;
+  int i;
+
+  f->pre[f->npre++] = '0';
+  f->pre[f->npre++] = upper ? 'X' : 'x';
+  if (prec < 0) {
+    // as many digits as needed
+    for (; (n > 0) && !(mant & 15); --n)
+      mant >>= 4;
+  } else if (prec < 13) {
+    // round half to even to prec digits, may carry into the lead digit
+    int shift = 4 * (13 - prec);
+    uint64_t rem = mant & ((1ULL << shift) - 1);
+    uint64_t half = 1ULL << (shift - 1);
+
+    mant >>= shift;
+    if ((rem > half) || ((rem == half) && ((prec ? mant : lead) & 1)))
+      mant++;
+    n = prec;
+    lead += mant >> (4 * n);
+    mant &= (1ULL << (4 * n)) - 1;
+  }
+  for (i = n - 1; i >= 0; --i, mant >>= 4)
+    buf[i + 1] = digits[mant & 15];
+  buf[0] = digits[lead];
+  f->s1 = buf;
+  f->n1 = 1;
+  f->s2 = buf + 1;
+  f->n2 = n;
+  f->z3 = (prec > n) ? (prec - n) : 0;
+  f->point = (n + f->z3 > 0);
+  printexp(f, upper ? 'P' : 'p', x, 1);
+}
+
+static int printd(ms_sink *out, double v, int fmt, int prec, int width, int pad)
+{
+  union { double f; uint64_t u; } b;
+  struct print_float f = { { 0 }, 0, "", 0, 0, 0, 0, "", 0, 0, { 0 }, 0 };
+  struct __ms_digits dg;
+  char hex[14];
+  int upper = (fmt >= 'A') && (fmt <= 'Z');
+  uint64_t mant;
+  int exp;
+
+  b.f = v;
+  mant = b.u & ((1ULL << 52) - 1);
+  exp = (int)((b.u >> 52) & 0x7FF);
+  if (b.u >> 63)
+    f.pre[f.npre++] = '-';
+
+  if (exp == 0x7FF) {
+    // no zero padding for inf and nan
+    f.s1 = mant ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+    f.n1 = 3;
+    return printpf(out, &f, width, pad & ~PRINT_PAD_ZERO);
+  }
+
+  switch (fmt) {
+  case 'a':
+  case 'A':
+    printhex(&f, mant, exp, prec, upper, hex);
+    break;
+  case 'e':
+  case 'E':
+    prec = (prec < 0) ? 6 : prec;
+    __ms_double_digits(v, MS_DIGITS_SIG, prec + 1, &dg);
+    printsci(&f, &dg, prec, upper);
+    break;
+  case 'g':
+  case 'G': {
+    int x;
+
+    // prec significant digits, trailing zeros dropped
+    prec = (prec < 0) ? 6 : ((prec == 0) ? 1 : prec);
+    __ms_double_digits(v, MS_DIGITS_SIG, prec, &dg);
+    x = dg.nd ? (dg.dp - 1) : 0;
+    if ((x < prec) && (x >= -4)) {
+      printfixed(&f, &dg, prec - 1 - x);
+    } else {
+      printsci(&f, &dg, prec - 1, upper);
+    }
+    f.z3 = 0;
+    if (f.n2 == 0)
+      f.z2 = 0;
+    f.point = (f.n2 > 0);
+    break;
+  }
+  default:
+    prec = (prec < 0) ? 6 : prec;
+    __ms_double_digits(v, MS_DIGITS_FRAC, prec, &dg);
+    printfixed(&f, &dg, prec);
+    break;
+  }
+  return printpf(out, &f, width, pad);
+}
+
+//------------------------------------------------------
+// Floating-point conversion for printf.hpp, which writes the other
+// conversions itself
+int __ms_print_double(ms_sink *out, double v, int fmt, int prec, int width, int left, int zero)
+{
+  return printd(out, v, fmt, prec, width, (left ? PRINT_PAD_RIGHT : 0) | (zero ? PRINT_PAD_ZERO : 0));
+}
+
+//------------------------------------------------------
+// String conversion and sink access for printf.hpp, which keeps out of
+// the sink fields
+
+int __ms_print_string(ms_sink *out, const char *s, int prec, int width, int left, int zero)
+{
+  return prints(out, s ? s : "(null)", prec, width, (left ? PRINT_PAD_RIGHT : 0) | (zero ? PRINT_PAD_ZERO : 0));
+}
+
+void __ms_print_span(ms_sink *out, const char *s, size_t n)
+{
+  __sink_put(out, s, n);
+}
+
+void __ms_print_fill(ms_sink *out, char c, size_t n)
+{
+  __sink_fill(out, c, n);
+}
+
+// nothing more is stored, the text only has to be counted
+int __ms_print_full(const ms_sink *out)
+{
+  return __sink_full(out);
+}
+
+//------------------------------------------------------
+// One conversion, as parsed from the format string
+
+struct print_spec {
+  char fmt;                // conversion character, 0 for none
+  char size;               // PRINT_SIZE_*
+  char pad;                // PRINT_PAD_*
+  char sign;               // integer is signed
+  char base;               // integer base
+  char letbase;            // 'a' or 'A' for hex digits
+  int width;
+  int prec;                // -1 if not given
+};
+
+/**
+ * Parse one conversion
+ *
+ * @param format  First character after the '%'
+ * @param spec    Out parameter, parsed conversion, spec->fmt is 0 if the
+ *                conversion character is not supported
+ *
+ * @return Conversion character, the terminator if the format ended
+ */
+static const char *printspec(const char *format, struct print_spec *spec)
+{
+  int width = 0;
+  int prec = -1;
+  int pad = 0;
+  int size = PRINT_SIZE_INT;
+
+  if (*format == '-') {
+    ++format;
+    pad = PRINT_PAD_RIGHT;
+  }
+  while (*format == '0') {
+    ++format;
+    pad |= PRINT_PAD_ZERO;
+  }
+  for (; __ascii_isdigit(*format); ++format) {
+    width *= 10;
+    width += *format - '0';
+  }
+  if (*format == '.') {
+    ++format;
+    prec = 0;
+    for (; __ascii_isdigit(*format); ++format) {
+      prec *= 10;
+      prec += *format - '0';
+    }
+  }
+  switch (*format) {
+  case 'l':
+    ++format;
+    size = PRINT_SIZE_LONG;
+    if (*format == 'l') {
+      ++format;
+      size = PRINT_SIZE_LONGLONG;
+    }
+    break;
+  case 'h':
+    ++format;
+    size = PRINT_SIZE_SHORT;
+    if (*format == 'h') {
+      ++format;
+      size = PRINT_SIZE_CHAR;
+    }
+    break;
+  case 'z':
+    ++format;
+    size = PRINT_SIZE_SIZE_T;
+    break;
+  case 'j':
+    ++format;
+    size = PRINT_SIZE_INTMAX;
+    break;
+  case 't':
+    ++format;
+    size = PRINT_SIZE_PTRDIFF;
+    break;
+  case 'L':
+    ++format;
+    size = PRINT_SIZE_LONGDOUBLE;
+    break;
+#if MS_HAVE_INT128
+  case 'I':
+    // I128, 128-bit integer
+    if ((format[1] == '1') && (format[2] == '2') && (format[3] == '8')) {
+      format += 4;
+      size = PRINT_SIZE_INT128;
+    }
+    break;
+#endif
+  default:
+    break;
+  }
+
+  spec->fmt     = 0;
+  spec->size    = (char) size;
+  spec->pad     = (char) pad;
+  spec->sign    = 0;
+  spec->base    = 10;
+  spec->letbase = 'a';
+  spec->width   = width;
+  spec->prec    = prec;
+
+  switch (*format) {
+  case 'd':
+  case 'i':
+    spec->sign = 1;
+    break;
+  case 'X':
+    spec->letbase = 'A';
+    // fall-through
+  case 'x':
+    spec->base = 16;
+    break;
+  case 'p':
+    spec->size = PRINT_SIZE_PTR;
+    spec->base = 16;
+    spec->letbase = 'A';
+    break;
+  case 'u':
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  case 'a':
+  case 'A':
+  case 's':
+  case 'c':
+    break;
+  default:
+    // not supported, the character is dropped
+    return format;
+  }
+  spec->fmt = *format;
+  return format;
+}
+
+/**
+ * Format one conversion
+ *
+ * @param out   Sink
+ * @param spec  Conversion
+ * @param args  Arguments, the conversion's one is taken
+ *
+ * @return Number of characters written
+ */
+static int printconv(ms_sink *out, const struct print_spec *spec, va_list *args)
+{
+  const int width = spec->width;
+  const int pad = spec->pad;
+  unsigned long long uval;
+  char scr[1];
+
+  switch (spec->fmt) {
+  case 'd':
+  case 'i':
+  case 'x':
+  case 'X':
+  case 'u':
+  case 'p':
+    // fetch at full width, signed values sign extended
+    switch (spec->size) {
+    case PRINT_SIZE_CHAR:
+      uval = spec->sign ? (unsigned long long)(signed char) va_arg( *args, int ) :
+                          (unsigned char) va_arg( *args, unsigned int );
+      break;
+    case PRINT_SIZE_SHORT:
+      uval = spec->sign ? (unsigned long long)(short) va_arg( *args, int ) :
+                          (unsigned short) va_arg( *args, unsigned int );
+      break;
+    case PRINT_SIZE_LONG:
+      uval = spec->sign ? (unsigned long long) va_arg( *args, long ) :
+                          va_arg( *args, unsigned long );
+      break;
+    case PRINT_SIZE_LONGLONG:
+      uval = va_arg( *args, unsigned long long );
+      break;
+    case PRINT_SIZE_SIZE_T:
+      uval = spec->sign ? (unsigned long long)(ptrdiff_t) va_arg( *args, size_t ) :
+                          va_arg( *args, size_t );
+      break;
+    case PRINT_SIZE_INTMAX:
+      uval = va_arg( *args, uintmax_t );
+      break;
+    case PRINT_SIZE_PTRDIFF:
+      uval = (unsigned long long) va_arg( *args, ptrdiff_t );
+      break;
+    case PRINT_SIZE_PTR:
+      uval = (uintptr_t) va_arg( *args, void * );
+      break;
+#if MS_HAVE_INT128
+    case PRINT_SIZE_INT128:
+      return printi128(out, va_arg( *args, ms_u128 ), spec->base, spec->sign, width, pad,
+                       spec->letbase, spec->prec);
+#endif
+    default:
+      uval = spec->sign ? (unsigned long long) va_arg( *args, int ) :
+                          va_arg( *args, unsigned int );
+      break;
+    }
+    return printi(out, uval, spec->base, spec->sign, width, pad, spec->letbase, spec->prec);
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  case 'a':
+  case 'A': {
+    // long double is printed at double precision
+    double dval = (spec->size == PRINT_SIZE_LONGDOUBLE) ? (double) va_arg( *args, long double ) :
+                                                          va_arg( *args, double );
+    return printd(out, dval, spec->fmt, spec->prec, width, pad);
+  }
+  case 's': {
+    register char *s = (char *)va_arg( *args, char * );
+    return prints(out, s ? s : "(null)", spec->prec, width, pad);
+  }
+  case 'c':
+    /* char are converted to int then pushed on the stack */
+    scr[0] = (char)va_arg( *args, int );
+    return printsn(out, scr, 1, width, pad);
+  default:
+    return 0;
+  }
+}
+
+/**
+ * Find literal run at the start of format
+ *
+ * @param format  Format string
+ * @param start   Out parameter, first literal character
+ *
+ * @return End of the run, format itself if it starts with a conversion
+ */
+static inline const char *printlit(const char *format, const char **start)
+{
+  // a "%%" is a run starting at its second '%'
+  if (*format == '%') {
+    if (format[1] != '%') {
+      *start = format;
+      return format;
+    }
+    ++format;
+  }
+  *start = format;
+  return __ms_string_ops.strchrnul(format + 1, '%');
+}
+
+//------------------------------------------------------
+/**
+ * Format to a sink
+ *
+ * @param out     Sink
+ * @param format  Format string
+ * @param args    Arguments, read through a copy, va_end() is the caller's
+ *
+ * @return Number of characters written, -1 if the sink failed
+ */
+int ms_vprint(ms_sink *out, const char *format, va_list args)
+{
+  struct print_spec spec;
+  register int pc = 0;
+  va_list ap;
+
+  va_copy(ap, args);
+  while (*format != 0) {
+    const char *lit;
+    const char *end = printlit(format, &lit);
+
+    if (end != format) {
+      // literal run up to the next conversion
+      __sink_put(out, lit, (size_t)(end - lit));
+      pc += (int)(end - lit);
+      format = end;
+      continue;
+    }
+    format = printspec(format + 1, &spec);
+    if (*format == '\0')
+      break;
+    pc += printconv(out, &spec, &ap);
+    ++format;
+  }
+  va_end(ap);
+  out->finish(out);
+  return out->error ? -1 : pc;
+}
+
+//------------------------------------------------------
+// Precompiled format: the conversions parsed once, literal runs copied
+// to the text after the op list.
+
+struct ms_fmt_op {
+  struct print_spec spec;  // conversion, spec.fmt is 0 for a literal run
+  size_t off;              // literal run in text
+  size_t len;
+};
+
+struct ms_fmt {
+  size_t nops;
+  struct ms_fmt_op *ops;
+  char *text;
+};
+
+/**
+ * Parse format into ops, or only count them if ops is NULL
+ *
+ * @param format  Format string
+ * @param ops     Output ops, may be NULL
+ * @param text    Output literal text, may be NULL
+ * @param ntext   Out parameter, length of literal text
+ *
+ * @return Number of ops
+ */
+static size_t __fmt_parse(const char *format, struct ms_fmt_op *ops, char *text, size_t *ntext)
+{
+  struct print_spec spec;
+  size_t nops = 0;
+  size_t off = 0;
+  int prev_lit = 0;
+
+  while (*format != 0) {
+    const char *lit;
+    const char *end = printlit(format, &lit);
+
+    if (end != format) {
+      size_t n = (size_t)(end - lit);
+
+      // runs split by "%%" are joined
+      if (!prev_lit) {
+        if (ops) {
+          ops[nops].spec.fmt = 0;
+          ops[nops].off = off;
+          ops[nops].len = 0;
+        }
+        nops++;
+        prev_lit = 1;
+      }
+      if (ops) {
+        __ms_string_ops.memcpy(text + off, lit, n);
+        ops[nops - 1].len += n;
+      }
+      off += n;
+      format = end;
+      continue;
+    }
+    format = printspec(format + 1, &spec);
+    if (*format == '\0')
+      break;
+    if (spec.fmt) {
+      if (ops) {
+        ops[nops].spec = spec;
+        ops[nops].off = 0;
+        ops[nops].len = 0;
+      }
+      nops++;
+      prev_lit = 0;
+    }
+    ++format;
+  }
+  *ntext = off;
+  return nops;
+}
+
+//------------------------------------------------------
+/**
+ * Compile format string for repeated use with ms_fmt_exec()
+ *
+ * @param format  Format string, need not outlive the result
+ *
+ * @return Compiled format, NULL if out of memory
+ */
+ms_fmt *ms_fmt_compile(const char *format)
+{
+  size_t ntext;
+  size_t nops = __fmt_parse(format, NULL, NULL, &ntext);
+  ms_fmt *fmt = (ms_fmt *) malloc(sizeof(ms_fmt) + (nops * sizeof(struct ms_fmt_op)) + ntext);
+
+  if (!fmt)
+    return NULL;
+  fmt->nops = nops;
+  fmt->ops  = (struct ms_fmt_op *)(fmt + 1);
+  fmt->text = (char *)(fmt->ops + nops);
+  __fmt_parse(format, fmt->ops, fmt->text, &ntext);
+  return fmt;
+}
+
+//------------------------------------------------------
+void ms_fmt_destroy(ms_fmt *fmt)
+{
+  free(fmt);
+}
+
+//------------------------------------------------------
+/**
+ * Format to a sink with a compiled format
+ *
+ * @param fmt   Compiled format
+ * @param out   Sink
+ * @param args  Arguments
+ *
+ * @return Number of characters written, -1 if the sink failed
+ */
+int ms_fmt_exec(const ms_fmt *fmt, ms_sink *out, va_list args)
+{
+  const struct ms_fmt_op *op = fmt->ops;
+  const struct ms_fmt_op *end = op + fmt->nops;
+  register int pc = 0;
+  va_list ap;
+
+  va_copy(ap, args);
+  for (; op != end; ++op) {
+    if (op->spec.fmt) {
+      pc += printconv(out, &op->spec, &ap);
+    } else {
+      __sink_put(out, fmt->text + op->off, op->len);
+      pc += (int) op->len;
+    }
+  }
+  va_end(ap);
+  out->finish(out);
+  return out->error ? -1 : pc;
+}
+
+//----------------------------------------------------
+int ms_fmt_print(const ms_fmt *fmt, ms_sink *sink, ...)
+{
+  int ret;
+  va_list args;
+  va_start(args, sink);
+  ret = ms_fmt_exec(fmt, sink, args);
+  va_end(args);
+  return ret;
+}
+
+//----------------------------------------------------
+int ms_print(ms_sink *sink, const char *format, ...)
+{
+  int ret;
+  va_list args;
+  va_start(args, format);
+  ret = ms_vprint(sink, format, args);
+  va_end(args);
+  return ret;
+}
+
+//----------------------------------------------------
+// if out is NULL, send to stdout, else *out is left at the terminator
+int pprint(char **out, const char *format, va_list args)
+{
+  ms_sink sink;
+  int ret;
+
+  if (out)
+    ms_sink_mem(&sink, *out);
+  else
+    ms_sink_file(&sink, stdout);
+  ret = ms_vprint(&sink, format, args);
+  if (out)
+    *out = sink.p;
+  return ret;
+}
+
+//----------------------------------------------------
+// if out is NULL, send to stdout (0)
+int sprintf(char *out, const char *format, ...)
+{
+  int ret;
+  va_list args;
+  va_start(args, format);
+  if (out)
+    ret = pprint(&out, format, args);
+  else
+    ret = pprint(0, format, args);
+  va_end(args);
+  return ret;
+}
+
+//----------------------------------------------------
+// C99 semantics: at most size bytes are stored, the terminator included,
+// and the return value is the length the whole text would have. With
+// size 0 nothing is written, out may be NULL, and the text is only
+// measured. If out is NULL and size is not 0, send to stdout.
+int snprintf(char *out, size_t size, const char *format, ...)
+{
+  int ret;
+  va_list args;
+  va_start(args, format);
+  ret = vsnprintf(out, size, format, args);
+  va_end(args);
+  return ret;
+}
+
+//----------------------------------------------------
+// if out is NULL, send to stdout (0)
+int vsprintf(char *out, const char *format, va_list args)
+{
+  int ret;
+  if (out)
+    ret = pprint(&out, format, args);
+  else
+    ret = pprint(0, format, args);
+  return ret;
+}
+
+//----------------------------------------------------
+// same as snprintf
+int vsnprintf(char *out, size_t size, const char *format, va_list args)
+{
+  ms_sink sink;
+
+  if (!out && size)
+    return pprint(0, format, args);
+  ms_sink_buf(&sink, out, size);
+  return ms_vprint(&sink, format, args);
+}
@@ -1,12 +1,80 @@
-#ifndef _PRINTF_H_
-#define _PRINTF_H_
-
-#include <stdarg.h>
-
-int pprint(char **out, const char *format, va_list args);
-int sprintf(char *out, const char *format, ...);
-int snprintf(char *out, size_t size, const char *format, ...);
-int vsprintf(char *out, const char *format, va_list args);
-int vsnprintf(char *out, size_t size, const char *format, va_list args);
-
-#endif /*_PRINTF_H_*/
+#ifndef _PRINTF_H_
+#define _PRINTF_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Output sink for the formatter. Text is handed over in spans: a sink
+ * has a window of room bytes at p that spans are copied into, and only
+ * a span that does not fit goes through spill(). Memory sinks write
+ * straight into the caller's buffer. File, fd and callback sinks collect
+ * the text in the stage buffer and pass it on when the stage is full and
+ * at the end of every formatting call. Set up with one of the
+ * ms_sink_*() functions, treat the fields as opaque. A sink can be used
+ * for any number of calls; memory sinks append after the previous text.
+ * A bounded sink of size 0 stores nothing and only measures the text,
+ * and the formatter skips digit generation for it where it can.
+ */
+#define MS_SINK_STAGE (512)
+
+/**
+ * Callback sink output function
+ *
+ * @param ctx  User context passed to ms_sink_callback()
+ * @param s    Text, not zero terminated
+ * @param n    Length of text
+ *
+ * @return 0 on success, non-zero to fail the formatting call
+ */
+typedef int (*ms_sink_fn)(void *ctx, const char *s, size_t n);
+
+typedef struct ms_sink {
+  char *p;        // write position
+  size_t room;    // bytes that can be copied to p without spill()
+  void (*spill)(struct ms_sink *sink, const char *s, size_t n);
+  void (*finish)(struct ms_sink *sink);
+  FILE *fp;       // file sink
+  int fd;         // fd sink
+  ms_sink_fn fn;  // callback sink
+  void *ctx;
+  int error;      // output failed, the rest is dropped
+  char stage[MS_SINK_STAGE];
+} ms_sink;
+
+void ms_sink_mem(ms_sink *sink, char *buf);
+void ms_sink_buf(ms_sink *sink, char *buf, size_t size);
+void ms_sink_file(ms_sink *sink, FILE *fp);
+void ms_sink_fd(ms_sink *sink, int fd);
+void ms_sink_callback(ms_sink *sink, ms_sink_fn fn, void *ctx);
+
+int ms_print(ms_sink *sink, const char *format, ...);
+int ms_vprint(ms_sink *sink, const char *format, va_list args);
+
+/**
+ * Precompiled format string. Compile once with ms_fmt_compile(), then
+ * format any number of times without parsing the format again. A
+ * compiled format is read-only and can be shared between threads.
+ */
+typedef struct ms_fmt ms_fmt;
+
+ms_fmt *ms_fmt_compile(const char *format);
+void ms_fmt_destroy(ms_fmt *fmt);
+int ms_fmt_exec(const ms_fmt *fmt, ms_sink *sink, va_list args);
+int ms_fmt_print(const ms_fmt *fmt, ms_sink *sink, ...);
+
+// Internal, for printf.hpp
+int __ms_print_double(ms_sink *out, double v, int fmt, int prec, int width, int left, int zero);
+int __ms_print_string(ms_sink *out, const char *s, int prec, int width, int left, int zero);
+void __ms_print_span(ms_sink *out, const char *s, size_t n);
+void __ms_print_fill(ms_sink *out, char c, size_t n);
+int __ms_print_full(const ms_sink *out);
+
+int pprint(char **out, const char *format, va_list args);
+int sprintf(char *out, const char *format, ...);
+int snprintf(char *out, size_t size, const char *format, ...);
+int vsprintf(char *out, const char *format, va_list args);
+int vsnprintf(char *out, size_t size, const char *format, va_list args);
+
+#endif /*_PRINTF_H_*/
@@ -0,0 +1,542 @@
+#ifndef _PRINTF_HPP_
+#define _PRINTF_HPP_
+
+/**
+ * Compile-time formatting for C++17 and later.
+ *
+ * The format string is parsed by the compiler, with the same % syntax
+ * as pprint(), and every call site gets its own formatter: a fixed
+ * sequence of literal copies and typed writers, with no format parsing
+ * and no va_arg at run time. Arguments are checked against the
+ * conversions at compile time, a mismatch or an unsupported conversion
+ * does not compile.
+ *
+ *   ms::print(&sink, MS_FMT("[%-12s|%08d|%6x]"), key, n, flags);
+ *   ms::print<"[%-12s|%08d|%6x]">(&sink, key, n, flags);   // C++20
+ *
+ * Integers are written here with the itoa functions, strings and
+ * floating-point conversions go to the library's formatters, and all
+ * text reaches the sink through the library's span and fill functions.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <printf.h>
+#include <itoa.h>
+}
+
+// Format string for ms::print() and friends, as a type
+#define MS_FMT(s)                                                        \
+  ([] {                                                                  \
+    struct ms_fmt_src {                                                  \
+      static constexpr const char *str() { return s; }                   \
+    };                                                                   \
+    return ms_fmt_src{};                                                 \
+  }())
+
+namespace ms {
+namespace detail {
+
+//----------------------------------------------------------------------
+// Parsed format
+
+enum class kind : unsigned char {
+  lit,   // literal text
+  sint,  // d, i
+  uint,  // u
+  hex,   // x, X, p
+  str,   // s
+  chr,   // c
+  flt    // f, F, e, E, g, G, a, A
+};
+
+// Sizes from the length modifier, as in printf.c
+enum class size : unsigned char {
+  int_, char_, short_, long_, longlong, size_t_, intmax, ptrdiff, longdouble, int128, ptr
+};
+
+struct op {
+  kind k = kind::lit;
+  size sz = size::int_;
+  bool left = false;     // '-'
+  bool zero = false;     // '0'
+  bool upper = false;    // X, p
+  char conv = 0;
+  int width = 0;
+  int prec = -1;
+  std::size_t off = 0;   // literal text in the format
+  std::size_t len = 0;
+};
+
+template <std::size_t N>
+struct program {
+  op ops[N ? N : 1];
+  std::size_t nops = 0;
+  std::size_t nargs = 0;
+  std::size_t arg[N ? N : 1] = {};  // argument index of each conversion
+};
+
+// Compile-time error, a throw is not allowed in a constant expression
+inline void format_error(const char *) {}
+
+constexpr bool is_digit(char c)
+{
+  return (c >= '0') && (c <= '9');
+}
+
+/**
+ * Parse format, or only count the ops if ops is null
+ *
+ * @return Number of ops
+ */
+constexpr std::size_t parse(const char *f, op *ops)
+{
+  std::size_t n = 0;
+  std::size_t i = 0;
+
+  while (f[i]) {
+    // literal run up to the next conversion, a "%%" starts one at its second '%'
+    if ((f[i] != '%') || (f[i + 1] == '%')) {
+      std::size_t start = i + (f[i] == '%');
+      std::size_t end = start + 1;
+
+      while (f[end] && (f[end] != '%'))
+        ++end;
+      if (ops) {
+        ops[n] = op{};
+        ops[n].off = start;
+        ops[n].len = end - start;
+      }
+      ++n;
+      i = end;
+      continue;
+    }
+
+    op o{};
+    ++i;
+    if (f[i] == '-') {
+      o.left = true;
+      ++i;
+    }
+    while (f[i] == '0') {
+      o.zero = true;
+      ++i;
+    }
+    for (; is_digit(f[i]); ++i)
+      o.width = (o.width * 10) + (f[i] - '0');
+    if (f[i] == '.') {
+      o.prec = 0;
+      for (++i; is_digit(f[i]); ++i)
+        o.prec = (o.prec * 10) + (f[i] - '0');
+    }
+    switch (f[i]) {
+    case 'l':
+      ++i;
+      o.sz = size::long_;
+      if (f[i] == 'l') {
+        ++i;
+        o.sz = size::longlong;
+      }
+      break;
+    case 'h':
+      ++i;
+      o.sz = size::short_;
+      if (f[i] == 'h') {
+        ++i;
+        o.sz = size::char_;
+      }
+      break;
+    case 'z': ++i; o.sz = size::size_t_; break;
+    case 'j': ++i; o.sz = size::intmax; break;
+    case 't': ++i; o.sz = size::ptrdiff; break;
+    case 'L': ++i; o.sz = size::longdouble; break;
+    case 'I':
+      if ((f[i + 1] == '1') && (f[i + 2] == '2') && (f[i + 3] == '8')) {
+        i += 4;
+        o.sz = size::int128;
+      }
+      break;
+    default:
+      break;
+    }
+
+    o.conv = f[i];
+    switch (f[i]) {
+    case 'd':
+    case 'i':
+      o.k = kind::sint;
+      break;
+    case 'u':
+      o.k = kind::uint;
+      break;
+    case 'X':
+      o.upper = true;
+      o.k = kind::hex;
+      break;
+    case 'x':
+      o.k = kind::hex;
+      break;
+    case 'p':
+      o.k = kind::hex;
+      o.sz = size::ptr;
+      o.upper = true;
+      break;
+    case 's':
+      o.k = kind::str;
+      break;
+    case 'c':
+      o.k = kind::chr;
+      break;
+    case 'f': case 'F': case 'e': case 'E':
+    case 'g': case 'G': case 'a': case 'A':
+      o.k = kind::flt;
+      break;
+    default:
+      format_error("unsupported or incomplete conversion in format");
+      return n;
+    }
+    if ((o.k == kind::flt) ? ((o.sz != size::int_) && (o.sz != size::longdouble)) :
+                             (o.sz == size::longdouble)) {
+      format_error("length modifier does not apply to this conversion");
+    }
+    if (((o.k == kind::str) || (o.k == kind::chr)) && (o.sz != size::int_)) {
+      format_error("length modifier does not apply to this conversion");
+    }
+    if (ops)
+      ops[n] = o;
+    ++n;
+    ++i;
+  }
+  return n;
+}
+
+template <class Src>
+constexpr auto compile()
+{
+  constexpr std::size_t n = parse(Src::str(), nullptr);
+  program<n> p{};
+
+  p.nops = parse(Src::str(), p.ops);
+  for (std::size_t i = 0; i < p.nops; ++i) {
+    if (p.ops[i].k != kind::lit)
+      p.arg[i] = p.nargs++;
+  }
+  return p;
+}
+
+template <class Src>
+inline constexpr auto program_v = compile<Src>();
+
+template <class Src, std::size_t I>
+inline constexpr op op_v = program_v<Src>.ops[I];
+
+//----------------------------------------------------------------------
+// Argument checks
+
+template <class T>
+inline constexpr bool is_int_v =
+  std::is_integral_v<T>
+#if MS_HAVE_INT128
+  || std::is_same_v<T, ms_i128> || std::is_same_v<T, ms_u128>
+#endif
+  ;
+
+// integer argument, a bool is neither a number nor a character
+template <class T>
+inline constexpr bool is_int_arg_v = is_int_v<T> && !std::is_same_v<T, bool>;
+
+template <size Sz, bool Sign>
+struct int_of;
+template <bool S> struct int_of<size::int_, S>     { using type = std::conditional_t<S, int, unsigned int>; };
+template <bool S> struct int_of<size::char_, S>    { using type = std::conditional_t<S, signed char, unsigned char>; };
+template <bool S> struct int_of<size::short_, S>   { using type = std::conditional_t<S, short, unsigned short>; };
+template <bool S> struct int_of<size::long_, S>    { using type = std::conditional_t<S, long, unsigned long>; };
+template <bool S> struct int_of<size::longlong, S> { using type = std::conditional_t<S, long long, unsigned long long>; };
+template <bool S> struct int_of<size::size_t_, S>  { using type = std::conditional_t<S, std::ptrdiff_t, std::size_t>; };
+template <bool S> struct int_of<size::intmax, S>   { using type = std::conditional_t<S, std::intmax_t, std::uintmax_t>; };
+template <bool S> struct int_of<size::ptrdiff, S>  { using type = std::conditional_t<S, std::ptrdiff_t, std::size_t>; };
+template <bool S> struct int_of<size::ptr, S>      { using type = std::uintptr_t; };
+#if MS_HAVE_INT128
+template <bool S> struct int_of<size::int128, S>   { using type = std::conditional_t<S, ms_i128, ms_u128>; };
+#endif
+
+// argument type T fits conversion I
+template <class Src, std::size_t I, class T>
+constexpr bool accepts()
+{
+  constexpr op o = op_v<Src, I>;
+
+  if constexpr (o.k == kind::str) {
+    return std::is_same_v<T, const char *> || std::is_same_v<T, char *>;
+  } else if constexpr (o.k == kind::chr) {
+    return std::is_integral_v<T> && is_int_arg_v<T>;
+  } else if constexpr (o.k == kind::flt) {
+    return std::is_floating_point_v<T> &&
+           ((o.sz == size::longdouble) || !std::is_same_v<T, long double>);
+  } else if constexpr (o.sz == size::ptr) {
+    return std::is_pointer_v<T> || std::is_null_pointer_v<T>;
+  } else if constexpr (o.sz == size::int128) {
+    return MS_HAVE_INT128 && is_int_arg_v<T>;
+  } else if constexpr ((o.sz == size::char_) || (o.sz == size::short_)) {
+    // anything up to int, as printf() gets it promoted, narrowed when written
+    return std::is_integral_v<T> && is_int_arg_v<T> && (sizeof(T) <= sizeof(int));
+  } else {
+    // no wider than the conversion, nothing is cut off
+    return std::is_integral_v<T> && is_int_arg_v<T> &&
+           (sizeof(T) <= sizeof(typename int_of<o.sz, true>::type));
+  }
+}
+
+//----------------------------------------------------------------------
+// Writers, same output as the runtime formatter
+
+// text padded to width, as printsn()
+template <class Src, std::size_t I>
+inline int put_padded(ms_sink *out, const char *s, int len, int width)
+{
+  constexpr op o = op_v<Src, I>;
+  const char pad = o.zero ? '0' : ' ';
+  int fill_n = (width > len) ? (width - len) : 0;
+
+  if (__ms_print_full(out))
+    return len + fill_n;
+  if (!o.left && fill_n)
+    __ms_print_fill(out, pad, (std::size_t) fill_n);
+  __ms_print_span(out, s, (std::size_t) len);
+  if (o.left && fill_n)
+    __ms_print_fill(out, pad, (std::size_t) fill_n);
+  return len + fill_n;
+}
+
+template <class Src, std::size_t I, class T>
+inline int write_int(ms_sink *out, T v)
+{
+  constexpr op o = op_v<Src, I>;
+  using S = typename int_of<o.sz, true>::type;
+  using U = typename int_of<o.sz, false>::type;
+  char buf[MS_I128TOA_LEN];
+  char *digits = buf + 1;  // magnitude, buf[0] is for the sign
+  char *end;
+  bool neg = false;
+
+  // hh and h arguments are narrowed here, as printf() does
+  if constexpr (sizeof(U) <= 8) {
+    unsigned long long u;
+
+    if constexpr (o.sz == size::ptr) {
+      u = (std::uintptr_t) v;
+    } else if constexpr (o.k == kind::sint) {
+      long long sv = (long long)(S) v;
+
+      neg = sv < 0;
+      u = neg ? (0 - (unsigned long long) sv) : (unsigned long long) sv;
+    } else {
+      u = (U) v;
+    }
+    if (__ms_print_full(out)) {
+      // measure only, no digits, as printi()
+      int len = (int)((o.k == kind::hex) ? ms_u64len_hex(u) : ms_u64len(u));
+
+      if constexpr (o.prec >= 0)
+        len = (!u && !o.prec) ? 0 : (o.prec > len) ? o.prec : len;
+      len += neg;
+      return (o.width > len) ? o.width : len;
+    }
+    if constexpr (o.k == kind::hex)
+      end = ms_u64toa_hex(u, digits, o.upper);
+    else if constexpr (sizeof(U) <= 4)
+      end = ms_u32toa((std::uint32_t) u, digits);
+    else
+      end = ms_u64toa(u, digits);
+  }
+#if MS_HAVE_INT128
+  else if constexpr (o.k == kind::sint) {
+    ms_i128 sv = (ms_i128) v;
+
+    neg = sv < 0;
+    end = ms_u128toa(neg ? (0 - (ms_u128) sv) : (ms_u128) sv, digits);
+  } else {
+    end = (o.k == kind::hex) ? ms_u128toa_hex((ms_u128) v, digits, o.upper) :
+                               ms_u128toa((ms_u128) v, digits);
+  }
+#endif
+
+  int len = (int)(end - digits);
+
+  if constexpr (o.prec >= 0) {
+    // as printprec(): zeros up to prec digits after the sign, the '0'
+    // flag does not apply, zero with precision 0 has no digits
+    if ((o.prec == 0) && (len == 1) && (digits[0] == '0'))
+      len = 0;
+
+    const int zeros = (o.prec > len) ? (o.prec - len) : 0;
+    const int n = neg + zeros + len;
+    const int fill_n = (o.width > n) ? (o.width - n) : 0;
+
+    if (!o.left && fill_n)
+      __ms_print_fill(out, ' ', (std::size_t) fill_n);
+    if (neg)
+      __ms_print_span(out, "-", 1);
+    if (zeros)
+      __ms_print_fill(out, '0', (std::size_t) zeros);
+    __ms_print_span(out, digits, (std::size_t) len);
+    if (o.left && fill_n)
+      __ms_print_fill(out, ' ', (std::size_t) fill_n);
+    return n + fill_n;
+  } else {
+    // as printi(): with zero padding the sign goes before the zeros
+    if (neg && o.width && o.zero) {
+      __ms_print_span(out, "-", 1);
+      return 1 + put_padded<Src, I>(out, digits, len, o.width - 1);
+    }
+    if (neg) {
+      buf[0] = '-';
+      return put_padded<Src, I>(out, buf, len + 1, o.width);
+    }
+    return put_padded<Src, I>(out, digits, len, o.width);
+  }
+}
+
+template <class Src, std::size_t I, class T>
+inline int write(ms_sink *out, const T &v)
+{
+  constexpr op o = op_v<Src, I>;
+
+  if constexpr (o.k == kind::str) {
+    return __ms_print_string(out, v, o.prec, o.width, o.left, o.zero);
+  } else if constexpr (o.k == kind::chr) {
+    const char c = (char) v;
+    return put_padded<Src, I>(out, &c, 1, o.width);
+  } else if constexpr (o.k == kind::flt) {
+    return __ms_print_double(out, (double) v, o.conv, o.prec, o.width, o.left, o.zero);
+  } else {
+    return write_int<Src, I>(out, v);
+  }
+}
+
+//----------------------------------------------------------------------
+// Argument K of a pack
+
+template <std::size_t K, class A, class... Rest>
+constexpr const auto &nth(const A &a, const Rest &... rest)
+{
+  if constexpr (K == 0)
+    return a;
+  else
+    return nth<K - 1>(rest...);
+}
+
+template <class Src, std::size_t I, class... Args>
+inline int step(ms_sink *out, const Args &... args)
+{
+  constexpr op o = op_v<Src, I>;
+
+  if constexpr (o.k == kind::lit) {
+    __ms_print_span(out, Src::str() + o.off, o.len);
+    return (int) o.len;
+  } else {
+    constexpr std::size_t K = program_v<Src>.arg[I];
+    using T = std::decay_t<decltype(nth<K>(args...))>;
+
+    static_assert(accepts<Src, I, T>(), "argument type does not match the conversion");
+    return write<Src, I>(out, nth<K>(args...));
+  }
+}
+
+template <class Src, std::size_t... I, class... Args>
+inline int run(ms_sink *out, std::index_sequence<I...>, const Args &... args)
+{
+  int pc = 0;
+
+  ((pc += step<Src, I>(out, args...)), ...);
+  out->finish(out);
+  return out->error ? -1 : pc;
+}
+
+} // namespace detail
+
+//----------------------------------------------------------------------
+/**
+ * Format to a sink
+ *
+ * @param out  Sink
+ * @param fmt  Format, MS_FMT("...")
+ * @param args Arguments
+ *
+ * @return Number of characters written, -1 if the sink failed
+ */
+template <class Src, class... Args>
+inline int print(ms_sink *out, Src, const Args &... args)
+{
+  constexpr auto &p = detail::program_v<Src>;
+
+  static_assert(p.nargs == sizeof...(Args), "number of arguments does not match the format");
+  return detail::run<Src>(out, std::make_index_sequence<p.nops>{}, args...);
+}
+
+// as sprintf()
+template <class Src, class... Args>
+inline int sprint(char *buf, Src fmt, const Args &... args)
+{
+  ms_sink sink;
+
+  ms_sink_mem(&sink, buf);
+  return print(&sink, fmt, args...);
+}
+
+// as snprintf()
+template <class Src, class... Args>
+inline int snprint(char *buf, std::size_t size, Src fmt, const Args &... args)
+{
+  ms_sink sink;
+
+  ms_sink_buf(&sink, buf, size);
+  return print(&sink, fmt, args...);
+}
+
+#if __cplusplus >= 202002L
+//----------------------------------------------------------------------
+// C++20, format as template argument: ms::print<"...">(sink, args...)
+
+template <std::size_t N>
+struct fixed_string {
+  char s[N];
+
+  constexpr fixed_string(const char (&a)[N])
+  {
+    for (std::size_t i = 0; i < N; ++i)
+      s[i] = a[i];
+  }
+};
+
+template <fixed_string S>
+struct fixed_src {
+  static constexpr const char *str() { return S.s; }
+};
+
+template <fixed_string S, class... Args>
+inline int print(ms_sink *out, const Args &... args)
+{
+  return print(out, fixed_src<S>{}, args...);
+}
+
+template <fixed_string S, class... Args>
+inline int sprint(char *buf, const Args &... args)
+{
+  return sprint(buf, fixed_src<S>{}, args...);
+}
+
+template <fixed_string S, class... Args>
+inline int snprint(char *buf, std::size_t size, const Args &... args)
+{
+  return snprint(buf, size, fixed_src<S>{}, args...);
+}
+#endif
+
+} // namespace ms
+
+#endif /* _PRINTF_HPP_ */
@@ -5,336 +5,583 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <limits.h>
-#include <ctype.h>
 #include <string.h>
 
 #include <scanf.h>
+#include <int128.h>
+#include <ascii.h>
+
+// string.h here is the library's and clashes with stdlib.h, so the two
+// allocation functions are declared directly, as C11 7.1.4 allows
+extern void *malloc(size_t size);
+extern void free(void *ptr);
 
 //----------------------------------------------------------------------
 
-#define TRIM(s)     while((*(s)) &&    isspace((unsigned char)*(s)))  (s)++;
-#define SKIP_ARG(s) while((*(s)) && (! isspace((unsigned char)*(s)))) (s)++;
+#define TRIM(s)     while(__ascii_isspace(*(s)))                (s)++;
+#define SKIP_ARG(s) while((*(s)) && (! __ascii_isspace(*(s)))) (s)++;
+
+//----------------------------------------------------------------------
+// Steps of a format, as parsed from the format string
+
+#define SCAN_OP_END   (0) // stop
+#define SCAN_OP_SPACE (1) // skip white space
+#define SCAN_OP_MATCH (2) // literal text must match
+#define SCAN_OP_SKIP  (3) // '*', skip input up to white space
+#define SCAN_OP_CONV  (4) // conversion
+
+struct scan_op {
+  int op;
+  int colon;          // string ends at ':' or ';'
+  int width;          // field width, -1 if not given
+  int qual;           // qualifier, -1 if not given
+  char conv;          // conversion character
+  const char *lit;    // SCAN_OP_MATCH text
+  size_t len;
+};
 
 //----------------------------------------------------------------------
 /**
- * Unformat buffer into list of arguments
+ * Parse one step of format
  *
- * @param buf   input buffer
- * @param fmt   format of buffer
- * @param args  arguments
+ * @param f   Format
+ * @param op  Out parameter, parsed step
  *
- * @return Number arguments read
+ * @return Format after the step
  */
-int vsscanf(const char * buf, const char * fmt, va_list args)
+static const char * scanstep(const char *f, struct scan_op *op)
 {
-  const char *s = buf;
-  const char *f = fmt;
+  const char *start;
+
+  op->op = SCAN_OP_END;
+  if (!(*f)) {
+    return f;
+  }
+
+  // Check whitespace in format
+  // Whitespace in format maps to space in input
+  if (__ascii_isspace(*f)) {
+    TRIM(f);
+    op->op = SCAN_OP_SPACE;
+    return f;
+  }
+
+  // Any char in format must match input
+  if ((*f) != '%') {
+    for (start = f; (*f) && ((*f) != '%') && !__ascii_isspace(*f); f++) {
+    }
+    op->op  = SCAN_OP_MATCH;
+    op->lit = start;
+    op->len = (size_t)(f - start);
+    return f;
+  }
+
+  // skip '%'
+  f++;
+
+  // An optional starting asterisk indicates that the data
+  // is to be retrieved from stdin but ignored,
+  // i.e. it is not stored in the corresponding argument.
+  if ((*f) == '*') {
+    // skip argument until whitespace found, or end of string
+    SKIP_ARG(f);
+    op->op = SCAN_OP_SKIP;
+    return f;
+  }
+  else if ((*f) == ':') {
+    // Check for colon
+    op->colon = 1;
+    // Skip colon
+    f++;
+  }
+  else {
+    // No colon nor asterisk
+    op->colon = 0;
+  }
+
+  // Check field width
+  if (__ascii_isdigit(*f)) {
+    // Parse field width
+    op->width = atoi(&f);
+  }
+  else {
+    // no field width limiter
+    op->width = -1;
+  }
+  // get qualifier
+  op->qual = (*f);
+
+  // get conversion qualifier
+  if ((op->qual == 'h') ||
+      (op->qual == 'l') ||
+      (op->qual == 'L') ||
+      (op->qual == 'Z') ||
+      (op->qual == 'z')) {
+
+    // step over qualifier
+    f++;
+    // if same qualifier again
+    if (op->qual == (*f)) {
+      if (op->qual == 'h') {
+        op->qual = 'H';
+        f++;
+      }
+      else if (op->qual == 'l') {
+        op->qual = 'L';
+        f++;
+      }
+    }
+  }
+#if MS_HAVE_INT128
+  else if ((op->qual == 'I') && (f[1] == '1') && (f[2] == '2') && (f[3] == '8')) {
+    // 128-bit, stored as 'Q'
+    op->qual = 'Q';
+    f += 4;
+  }
+#endif
+  else {
+    op->qual = -1;
+  }
+
+  // check for end of string
+  if (!(*f)) {
+    return f;
+  }
+
+  op->conv = *f++;
+  switch (op->conv) {
+  case 'c':
+  case 's':
+  case 'n':
+  case 'i':
+  case 'd':
+  case 'u':
+  case 'o':
+  case 'x':
+  case 'X':
+    op->op = SCAN_OP_CONV;
+    break;
+
+  case '%':
+    // looking for '%' in str
+    op->op  = SCAN_OP_MATCH;
+    op->lit = f - 1;
+    op->len = 1;
+    break;
+
+  default:
+    // invalid format; stop here
+    break;
+  }
+  return f;
+}
 
-  int colon;
-  int width;
-  int qual;
+//----------------------------------------------------------------------
+/**
+ * Run one step on the input
+ *
+ * @param op    Step
+ * @param sp    Input position, also out parameter
+ * @param buf   Start of input
+ * @param args  Arguments, a conversion takes its one
+ *
+ * @return 1 if an argument was stored, 0 if not, -1 to stop
+ */
+static int scanop(const struct scan_op *op, const char **sp, const char *buf, va_list *args)
+{
+  const char *s = *sp;
+  int width = op->width;
   int base;
   int sign;
 
   char * next = NULL;
   char digit;
 
-  int num_args_read = 0;
+  switch (op->op) {
+  case SCAN_OP_SPACE:
+    // Skip leading whitespace
+    TRIM(s);
+    *sp = s;
+    return 0;
 
-  // while more in buffer to parse
-  while ((*f) && (*s)) {
-    
-    // Check whitespace in format
-    // Whitespace in format maps to space in input
-    if (isspace((unsigned char) *f)) {
-      // Skip leading whitespace
-      TRIM(f);
-      TRIM(s);
+  case SCAN_OP_MATCH:
+    if (strncmp(s, op->lit, op->len)) {
+      // no match
+      return -1;
     }
+    *sp = s + op->len;
+    return 0;
 
-    // Any char in format must match input
-    if ((*f) && ((*f) != '%')) {
-      if (*f++ == *s++) {
-        // matched
-        continue;
+  case SCAN_OP_SKIP:
+    SKIP_ARG(s);
+    *sp = s;
+    return 0;
+
+  case SCAN_OP_CONV:
+    break;
+
+  default:
+    return -1;
+  }
+
+  // Set initial base and sign
+  base = 10;
+  sign = 0;
+
+  // Handle qualifier
+  switch (op->conv) {
+  case 'c':
+  {
+    // Char qualifier
+    char *sc = (char *) va_arg(*args, char *);
+    if (width == -1)
+      width = 1;
+    do {
+      *sc++ = *s++;
+      width--;
+    } while ((*s) && (width > 0));
+
+    *sp = s;
+    return 1;
+  }
+
+  case 's':
+  {
+    // String qualifier
+    char *ss = (char *) va_arg(*args, char *);
+    if (width == -1)
+      width = INT_MAX;
+    // skip leading white space in buffer
+    TRIM(s);
+    // now copy until next white space or :; if specified
+    while ((*s) && (width > 0)) {
+      if (op->colon) {
+        if ((*s == ':') || (*s == ';'))
+          break;
       }
-      // no match
-      break;
+      else {
+        if (__ascii_isspace(*s))
+          break;
+      }
+      // read string
+      if (ss) {
+        *ss++ = *s++;
+      }
+      else {
+        // null dest string, just skip
+        s++;
+      }
+      width--;
     }
+    if (ss) {
+      // null-terminate
+      *ss = '\0';
+    }
+    *sp = s;
+    return 1;
+  }
+
+  case 'n':
+  {
+    // return number of characters read so far
+    int *i = (int *) va_arg(*args, int *);
+    *i = s - buf;
+    return 0;
+  }
+
+  case 'i':
+    base = 0;
+    // fall-through
+  case 'd':
+    sign = 1;
+    // fall-through
+  case 'u':
+    break;
+
+  case 'o':
+    // octal
+    base = 8;
+    break;
+
+  default:
+    // hex
+    base = 16;
+    break;
+  }
+
+  // integer conversion
+  // skip leading white space in buffer
+  TRIM(s);
+
+  // read out digit
+  digit = *s;
+  if (sign && ((digit == '-') || (digit == '+'))) {
+    digit = *(s + 1);
+  }
 
-    // check end of format string
-    if (*f) {
-      // more chars, skip '%'
-      f++;
+  // check for invalid non numeric arguments
+  if ((digit == '\0') ||
+      (base == 16 && !__ascii_isxdigit(digit)) ||
+      (base == 10 && ! __ascii_isdigit(digit)) ||
+      (base == 8  && (!__ascii_isdigit(digit)  || (digit > '7'))) ||
+      (base == 0  && ! __ascii_isdigit(digit)))
+    return -1;
+
+  // check qualifier
+  switch (op->qual) {
+
+  case 'H':
+    // char type, that is 'hh' in format
+    if (sign) {
+      signed char *sH = (signed char *) va_arg(*args, signed char *);
+      *sH = (signed char) strtol(s, &next, base);
     }
     else {
-      // end of format string, exit
-      break;
+      unsigned char *sH = (unsigned char *) va_arg(*args, unsigned char *);
+      *sH = (unsigned char) strtoul(s, &next, base);
     }
+    break;
 
-    // An optional starting asterisk indicates that the data
-    // is to be retrieved from stdin but ignored,
-    // i.e. it is not stored in the corresponding argument.
-    if ((*f) == '*') {
-      // skip argument until whitespace found, or end of string
-      SKIP_ARG(f);
-      SKIP_ARG(s);
-      // continue parsing
-      continue;
-    }
-    else if ((*f) == ':') {
-      // Check for colon
-      colon = 1;
-      // Skip colon
-      f++;
+  case 'h':
+    // short type
+    if (sign) {
+      signed short *sh = (signed short *) va_arg(*args, signed short *);
+      *sh = (signed short) strtol(s, &next, base);
     }
     else {
-      // No colon nor asterisk
-      colon = 0;
+      unsigned short *sh = (unsigned short *) va_arg(*args, unsigned short *);
+      *sh = (unsigned short) strtoul(s, &next, base);
     }
+    break;
 
-    // Check field width
-    if (isdigit((unsigned char) *f)) {
-      // Parse field width
-      width = atoi(&f);
+  case 'l':
+    // long type
+    if (sign) {
+      signed long *l = (signed long *) va_arg(*args, signed long *);
+      *l = strtol(s, &next, base);
     }
     else {
-      // no field width limiter
-      width = -1;
+      unsigned long *l = (unsigned long*) va_arg(*args, unsigned long*);
+      *l = strtoul(s, &next, base);
     }
-    // get qualifier
-    qual = (*f);
-
-    // get conversion qualifier
-    if ((qual == 'h') ||
-        (qual == 'l') ||
-        (qual == 'L') ||
-        (qual == 'Z') ||
-        (qual == 'z')) {
-
-      // step over qualifier
-      f++;
-      // if same qualifier again
-      if (qual == (*f)) {
-        if (qual == 'h') {
-          qual = 'H';
-          f++;
-        }
-        else if (qual == 'l') {
-          qual = 'L';
-          f++;
-        }
-      }
+    break;
+
+  case 'L':
+    // long long type
+    if (sign) {
+      signed long long *l = (signed long long*) va_arg(*args, signed long long *);
+      *l = strtoll(s, &next, base);
     }
     else {
-      qual = -1;
+      unsigned long long *l = (unsigned long long*) va_arg(*args, unsigned long long*);
+      *l = strtoull(s, &next, base);
     }
-
-    // check for end of string
-    if (!(*f) || !(*s))
-      break;
-
-    // Set initial base and sign
-    base = 10;
-    sign = 0;
-
-    // Handle qualifier
-    switch (*f++) {
-    case 'c':
-    {
-      // Char qualifier
-      char *sc = (char *) va_arg(args, char *);
-      if (width == -1)
-        width = 1;
-      do {
-        *sc++ = *s++;
-        width--;
-      } while ((*s) && (width > 0));
-      
-      num_args_read++;
-      continue;
+    break;
+
+#if MS_HAVE_INT128
+  case 'Q':
+    // 128-bit type, that is 'I128' in format
+    if (sign) {
+      ms_i128 *q = (ms_i128 *) va_arg(*args, ms_i128 *);
+      *q = strtoi128(s, &next, base);
     }
+    else {
+      ms_u128 *q = (ms_u128 *) va_arg(*args, ms_u128 *);
+      *q = strtou128(s, &next, base);
+    }
+    break;
+#endif
+
+  case 'Z':
+  case 'z':
+  {
+    // read size
+    size_t *sz = (size_t*) va_arg(*args, size_t *);
+    *sz = (size_t) strtoul(s, &next, base);
+    break;
+  }
 
-    case 's':
-    {
-      // String qualifier
-      char *ss = (char *) va_arg(args, char *);
-      if (width == -1)
-        width = INT_MAX;
-      // skip leading white space in buffer
-      TRIM(s);
-      // now copy until next white space or :; if specified
-      while ((*s) && (width > 0)) {
-        if (colon) {
-          if ((*s == ':') || (*s == ';'))
-            break;
-        }
-        else {
-          if (isspace((unsigned char) *s))
-            break;
-        }
-        // read string
-        if (ss) {
-          *ss++ = *s++;
-        }
-        else {
-          // null dest string, just skip
-          s++;
-        }
-        width--;
-      }
-      if (ss) {
-        // null-terminate
-        *ss = '\0';
-      }
-      num_args_read++;
-      continue;
+  default:
+    // normal int
+    if (sign) {
+      signed int *i = (signed int *) va_arg(*args, signed int *);
+      *i = (signed int) strtol(s, &next, base);
     }
-      
-    case 'n':      
-    {
-      // return number of characters read so far
-      int *i = (int *) va_arg(args, int *);
-      *i = s - buf;
-      continue;
+    else {
+      unsigned int *i = (unsigned int*) va_arg(*args, unsigned int *);
+      *i = (unsigned int) strtoul(s, &next, base);
     }
+    break;
+  }
 
-    case 'i':
-      base = 0;
-      // fall-through
-    case 'd':
-      sign = 1;
-      // fall-through
-    case 'u':
-      break;
-
-    case 'o':
-      // octal
-      base = 8;
-      break;
+  // Continue parse at next
+  *sp = next;
+  return 1;
+}
 
-    case 'x':
-    case 'X':
-      // hex
-      base = 16;
-      break;
+//----------------------------------------------------------------------
+/**
+ * Unformat buffer into list of arguments
+ *
+ * @param buf   input buffer
+ * @param fmt   format of buffer
+ * @param args  arguments
+ *
+ * @return Number arguments read
+ */
+int vsscanf(const char * buf, const char * fmt, va_list args)
+{
+  const char *s = buf;
+  const char *f = fmt;
+  struct scan_op op;
+  va_list ap;
 
-    case '%':
-      // looking for '%' in str
-      if (*s++ == '%')
-        continue;
-    default:
-      // invalid format; stop here
-      return num_args_read;
-    }
+  int num_args_read = 0;
 
-    // integer conversion
-    // skip leading white space in buffer
-    TRIM(s);
+  va_copy(ap, args);
+  // while more in buffer to parse
+  while (*s) {
+    int r;
 
-    // read out digit
-    digit = *s;
-    if (sign && ((digit == '-') || (digit == '+'))) {
-      digit = *(s + 1);
+    f = scanstep(f, &op);
+    r = scanop(&op, &s, buf, &ap);
+    if (r < 0) {
+      break;
     }
+    num_args_read += r;
+  }
+  va_end(ap);
 
-    // check for invalid non numeric arguments
-    if ((digit == '\0') ||
-        (base == 16 && !isxdigit((unsigned char) digit)) ||
-        (base == 10 && ! isdigit((unsigned char) digit)) ||
-        (base == 8  && (!isdigit((unsigned char) digit)  || (digit > '7'))) ||
-        (base == 0  && ! isdigit((unsigned char) digit)))
-      break;
+  // return numer of arguments read
+  return num_args_read;
+}
 
-    // check qualifier
-    switch (qual) {
+//----------------------------------------------------------------------
+// Precompiled format: the steps parsed once, literal text copied after
+// the step list.
 
-    case 'H':
-      // char type, that is 'hh' in format
-      if (sign) {
-        signed char *sH = (signed char *) va_arg(args, signed char *);
-        *sH = (signed char) strtol(s, &next, base);
-      }
-      else {
-        unsigned char *sH = (unsigned char *) va_arg(args, unsigned char *);
-        *sH = (unsigned char) strtoul(s, &next, base);
-      }
-      break;
+struct ms_scan {
+  size_t nops;
+  struct scan_op *ops;
+};
 
-    case 'h':
-      // short type
-      if (sign) {
-        signed short *sh = (signed short *) va_arg(args, signed short *);
-        *sh = (signed short) strtol(s, &next, base);
-      }
-      else {
-        unsigned short *sh = (unsigned short *) va_arg(args, unsigned short *);
-        *sh = (unsigned short) strtoul(s, &next, base);
-      }
+/**
+ * Parse format into steps, or only count them if ops is NULL
+ *
+ * @param fmt    Format
+ * @param ops    Output steps, may be NULL
+ * @param text   Output literal text, may be NULL
+ * @param ntext  Out parameter, length of literal text
+ *
+ * @return Number of steps
+ */
+static size_t __scan_parse(const char *fmt, struct scan_op *ops, char *text, size_t *ntext)
+{
+  struct scan_op op;
+  size_t nops = 0;
+  size_t off = 0;
+  int prev_match = 0;
+
+  for (;;) {
+    fmt = scanstep(fmt, &op);
+    if (op.op == SCAN_OP_END) {
+      // nothing after a stop is ever run
       break;
-
-    case 'l':
-      // long type
-      if (sign) {
-        signed long *l = (signed long *) va_arg(args, signed long *);
-        *l = strtol(s, &next, base);
+    }
+    if (op.op == SCAN_OP_MATCH) {
+      if (text) {
+        memcpy(text + off, op.lit, op.len);
+        op.lit = text + off;
       }
-      else {
-        unsigned long *l = (unsigned long*) va_arg(args, unsigned long*);
-        *l = strtoul(s, &next, base);
+      off += op.len;
+      // literal runs split by "%%" are joined
+      if (prev_match) {
+        if (ops) {
+          ops[nops - 1].len += op.len;
+        }
+        continue;
       }
-      break;
+    }
+    if (ops) {
+      ops[nops] = op;
+    }
+    nops++;
+    prev_match = (op.op == SCAN_OP_MATCH);
+  }
+  *ntext = off;
+  return nops;
+}
 
-    case 'L':
-      // long long type
-      if (sign) {
-        signed long long *l = (signed long long*) va_arg(args, signed long long *);
-        *l = strtoll(s, &next, base);
-      }
-      else {
-        unsigned long long *l = (unsigned long long*) va_arg(args, unsigned long long*);
-        *l = strtoull(s, &next, base);
-      }
-      break;
+//----------------------------------------------------------------------
+/**
+ * Compile format for repeated use with ms_scan_exec()
+ *
+ * @param fmt  Format, need not outlive the result
+ *
+ * @return Compiled format, NULL if out of memory
+ */
+ms_scan * ms_scan_compile(const char *fmt)
+{
+  size_t ntext;
+  size_t nops = __scan_parse(fmt, NULL, NULL, &ntext);
+  ms_scan *scan = (ms_scan *) malloc(sizeof(ms_scan) + (nops * sizeof(struct scan_op)) + ntext);
 
-    case 'Z':
-    case 'z':
-    {
-      // read size
-      size_t *sz = (size_t*) va_arg(args, size_t *);
-      *sz = (size_t) strtoul(s, &next, base);
-      break;
-    }
+  if (!scan) {
+    return NULL;
+  }
+  scan->ops  = (struct scan_op *)(scan + 1);
+  scan->nops = __scan_parse(fmt, scan->ops, (char *)(scan->ops + nops), &ntext);
+  return scan;
+}
 
-    default:
-      // normal int
-      if (sign) {
-        signed int *i = (signed int *) va_arg(args, signed int *);
-        *i = (signed int) strtol(s, &next, base);
-      }
-      else {
-        unsigned int *i = (unsigned int*) va_arg(args, unsigned int *);
-        *i = (unsigned int) strtoul(s, &next, base);
-      }
-      break;
-    }
+//----------------------------------------------------------------------
+void ms_scan_destroy(ms_scan *scan)
+{
+  free(scan);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Unformat buffer into list of arguments with a compiled format
+ *
+ * @param scan  Compiled format
+ * @param buf   input buffer
+ * @param args  arguments
+ *
+ * @return Number arguments read
+ */
+int ms_scan_exec(const ms_scan *scan, const char *buf, va_list args)
+{
+  const struct scan_op *op = scan->ops;
+  const struct scan_op *end = op + scan->nops;
+  const char *s = buf;
+  va_list ap;
 
-    num_args_read++;
+  int num_args_read = 0;
 
-    // check next, will this ever be true?? Shouldnt it be de-ref pointer?
-    if (next == NULL) {
-      // exit, no next arg
+  va_copy(ap, args);
+  for (; (op != end) && (*s); op++) {
+    int r = scanop(op, &s, buf, &ap);
+    if (r < 0) {
       break;
     }
-
-    // Continue parse at next
-    s = next;
+    num_args_read += r;
   }
-
-  // return numer of arguments read
+  va_end(ap);
   return num_args_read;
 }
 
+//----------------------------------------------------------------------
+int ms_scan_read(const ms_scan *scan, const char *buf, ...)
+{
+  va_list args;
+  int args_read;
+  va_start(args, buf);
+  args_read = ms_scan_exec(scan, buf, args);
+  va_end(args);
+  return args_read;
+}
+
 //----------------------------------------------------------------------
 /**
  * Unformat a buffer into a list of arguments
@@ -6,4 +6,16 @@
 int vsscanf(const char * buf, const char * fmt, va_list args);
 int sscanf(const char * buf, const char * fmt, ...);
 
+/**
+ * Precompiled scan format. Compile once with ms_scan_compile(), then
+ * unformat any number of buffers without parsing the format again. A
+ * compiled format is read-only and can be shared between threads.
+ */
+typedef struct ms_scan ms_scan;
+
+ms_scan * ms_scan_compile(const char *fmt);
+void ms_scan_destroy(ms_scan *scan);
+int ms_scan_exec(const ms_scan *scan, const char *buf, va_list args);
+int ms_scan_read(const ms_scan *scan, const char *buf, ...);
+
 #endif /*_SCANF_H_*/
@@ -0,0 +1,302 @@
+/**
+ * SSE2, SSSE3 and AVX2 string kernels for x86, selected at run-time.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <dispatch.h>
+#include <ascii.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+//----------------------------------------------------------------------
+// SSE2 and SSSE3, 16 bytes per vector
+
+#define VEC_T           __m128i
+#define VEC_BYTES       (16)
+#define VEC_ALL         (0xFFFFu)
+#define VEC_LOAD(p)     _mm_load_si128((const __m128i *)(p))
+#define VEC_LOADU(p)    _mm_loadu_si128((const __m128i *)(p))
+#define VEC_STORE(p,v)  _mm_store_si128((__m128i *)(p), (v))
+#define VEC_STOREU(p,v) _mm_storeu_si128((__m128i *)(p), (v))
+#define VEC_SET1(c)     _mm_set1_epi8(c)
+#define VEC_ZERO()      _mm_setzero_si128()
+#define VEC_CMPEQ(a,b)  _mm_cmpeq_epi8((a), (b))
+#define VEC_OR(a,b)     _mm_or_si128((a), (b))
+#define VEC_AND(a,b)    _mm_and_si128((a), (b))
+#define VEC_XOR(a,b)    _mm_xor_si128((a), (b))
+#define VEC_ADD8(a,b)   _mm_add_epi8((a), (b))
+#define VEC_CMPGT(a,b)  _mm_cmpgt_epi8((a), (b))
+#define VEC_MASK(v)     ((uint32_t) _mm_movemask_epi8(v))
+#define VEC_SRLI16(v,n) _mm_srli_epi16((v), (n))
+#define VEC_SHUFFLE(t,i) _mm_shuffle_epi8((t), (i))
+#define VEC_BCAST16(p)  _mm_loadu_si128((const __m128i *)(p))
+#define VEC_SUB8(a,b)   _mm_sub_epi8((a), (b))
+#define VEC_SUBS_U8(a,b) _mm_subs_epu8((a), (b))
+#define VEC_SET1_16(x)  _mm_set1_epi16(x)
+#define VEC_SET1_32(x)  _mm_set1_epi32(x)
+#define VEC_MADDUBS(a,b) _mm_maddubs_epi16((a), (b))
+#define VEC_MADD16(a,b) _mm_madd_epi16((a), (b))
+#define VEC_MULHI_U16(a,b) _mm_mulhi_epu16((a), (b))
+#define VEC_MULLO16(a,b) _mm_mullo_epi16((a), (b))
+#define VEC_UNPACKLO8(a,b) _mm_unpacklo_epi8((a), (b))
+#define VEC_UNPACKHI8(a,b) _mm_unpackhi_epi8((a), (b))
+#define VEC_SPLIT_LANES(v) (v)
+#define VEC_PACKUS16(a,b) _mm_packus_epi16((a), (b))
+#define VEC_LOAD_B64(p) _mm_loadu_si128((const __m128i *)(p))
+#define VEC_PACK_B64(v) (v)
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#define KERNEL(name)    __ms_##name##_sse2
+#include <simd_x86_tmpl.h>
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("ssse3")
+#define KERNEL(name)    __ms_##name##_ssse3
+#include <simd_x86_shuf_tmpl.h>
+#include <simd_x86_codec_tmpl.h>
+#undef KERNEL
+#pragma GCC pop_options
+
+#undef VEC_T
+#undef VEC_BYTES
+#undef VEC_ALL
+#undef VEC_LOAD
+#undef VEC_LOADU
+#undef VEC_STORE
+#undef VEC_STOREU
+#undef VEC_SET1
+#undef VEC_ZERO
+#undef VEC_CMPEQ
+#undef VEC_OR
+#undef VEC_AND
+#undef VEC_XOR
+#undef VEC_ADD8
+#undef VEC_CMPGT
+#undef VEC_MASK
+#undef VEC_SRLI16
+#undef VEC_SHUFFLE
+#undef VEC_BCAST16
+#undef VEC_SUB8
+#undef VEC_SUBS_U8
+#undef VEC_SET1_16
+#undef VEC_SET1_32
+#undef VEC_MADDUBS
+#undef VEC_MADD16
+#undef VEC_MULHI_U16
+#undef VEC_MULLO16
+#undef VEC_UNPACKLO8
+#undef VEC_UNPACKHI8
+#undef VEC_SPLIT_LANES
+#undef VEC_PACKUS16
+#undef VEC_LOAD_B64
+#undef VEC_PACK_B64
+
+//----------------------------------------------------------------------
+// AVX2, 32 bytes per vector
+
+#define VEC_T           __m256i
+#define VEC_BYTES       (32)
+#define VEC_ALL         (0xFFFFFFFFu)
+#define VEC_LOAD(p)     _mm256_load_si256((const __m256i *)(p))
+#define VEC_LOADU(p)    _mm256_loadu_si256((const __m256i *)(p))
+#define VEC_STORE(p,v)  _mm256_store_si256((__m256i *)(p), (v))
+#define VEC_STOREU(p,v) _mm256_storeu_si256((__m256i *)(p), (v))
+#define VEC_SET1(c)     _mm256_set1_epi8(c)
+#define VEC_ZERO()      _mm256_setzero_si256()
+#define VEC_CMPEQ(a,b)  _mm256_cmpeq_epi8((a), (b))
+#define VEC_OR(a,b)     _mm256_or_si256((a), (b))
+#define VEC_AND(a,b)    _mm256_and_si256((a), (b))
+#define VEC_XOR(a,b)    _mm256_xor_si256((a), (b))
+#define VEC_ADD8(a,b)   _mm256_add_epi8((a), (b))
+#define VEC_CMPGT(a,b)  _mm256_cmpgt_epi8((a), (b))
+#define VEC_MASK(v)     ((uint32_t) _mm256_movemask_epi8(v))
+#define VEC_SRLI16(v,n) _mm256_srli_epi16((v), (n))
+#define VEC_SHUFFLE(t,i) _mm256_shuffle_epi8((t), (i))
+#define VEC_BCAST16(p)  _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(p)))
+#define VEC_SUB8(a,b)   _mm256_sub_epi8((a), (b))
+#define VEC_SUBS_U8(a,b) _mm256_subs_epu8((a), (b))
+#define VEC_SET1_16(x)  _mm256_set1_epi16(x)
+#define VEC_SET1_32(x)  _mm256_set1_epi32(x)
+#define VEC_MADDUBS(a,b) _mm256_maddubs_epi16((a), (b))
+#define VEC_MADD16(a,b) _mm256_madd_epi16((a), (b))
+#define VEC_MULHI_U16(a,b) _mm256_mulhi_epu16((a), (b))
+#define VEC_MULLO16(a,b) _mm256_mullo_epi16((a), (b))
+#define VEC_UNPACKLO8(a,b) _mm256_unpacklo_epi8((a), (b))
+#define VEC_UNPACKHI8(a,b) _mm256_unpackhi_epi8((a), (b))
+#define VEC_SPLIT_LANES(v) _mm256_permute4x64_epi64((v), 0xD8)
+#define VEC_PACKUS16(a,b) _mm256_permute4x64_epi64(_mm256_packus_epi16((a), (b)), 0xD8)
+#define VEC_LOAD_B64(p) _mm256_inserti128_si256(_mm256_castsi128_si256(                 \
+                          _mm_loadu_si128((const __m128i *)(p))),                        \
+                          _mm_loadu_si128((const __m128i *)((const char *)(p) + 12)), 1)
+#define VEC_PACK_B64(v) _mm256_permutevar8x32_epi32((v), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7))
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define KERNEL(name)    __ms_##name##_avx2
+#include <simd_x86_tmpl.h>
+#include <simd_x86_shuf_tmpl.h>
+#include <simd_x86_codec_tmpl.h>
+#undef KERNEL
+#pragma GCC pop_options
+
+#undef VEC_T
+#undef VEC_BYTES
+#undef VEC_ALL
+#undef VEC_LOAD
+#undef VEC_LOADU
+#undef VEC_STORE
+#undef VEC_STOREU
+#undef VEC_SET1
+#undef VEC_ZERO
+#undef VEC_CMPEQ
+#undef VEC_OR
+#undef VEC_AND
+#undef VEC_XOR
+#undef VEC_ADD8
+#undef VEC_CMPGT
+#undef VEC_MASK
+#undef VEC_SRLI16
+#undef VEC_SHUFFLE
+#undef VEC_BCAST16
+#undef VEC_SUB8
+#undef VEC_SUBS_U8
+#undef VEC_SET1_16
+#undef VEC_SET1_32
+#undef VEC_MADDUBS
+#undef VEC_MADD16
+#undef VEC_MULHI_U16
+#undef VEC_MULLO16
+#undef VEC_UNPACKLO8
+#undef VEC_UNPACKHI8
+#undef VEC_SPLIT_LANES
+#undef VEC_PACKUS16
+#undef VEC_LOAD_B64
+#undef VEC_PACK_B64
+
+//----------------------------------------------------------------------
+/**
+ * Install the kernels of one tier, as selected on a CPU whose widest
+ * instruction set is that tier. Lets tests run every tier the CPU has.
+ *
+ * @param ops   Dispatch table to update, entries without a kernel in
+ *              the tier are kept
+ * @param tier  MS_TIER_*
+ *
+ * @return 1 if installed, 0 if the CPU lacks the tier
+ */
+int __ms_dispatch_x86_tier(struct ms_string_ops *ops, int tier)
+{
+  __builtin_cpu_init();
+
+  switch (tier) {
+  case MS_TIER_AVX2:
+    if (!__builtin_cpu_supports("avx2")) {
+      return 0;
+    }
+    ops->strlen  = __ms_strlen_avx2;
+    ops->strnlen = __ms_strnlen_avx2;
+    ops->memchr  = __ms_memchr_avx2;
+    ops->memrchr = __ms_memrchr_avx2;
+    ops->strchr  = __ms_strchr_avx2;
+    ops->strchrnul = __ms_strchrnul_avx2;
+    ops->strrchr = __ms_strrchr_avx2;
+    ops->strcmp  = __ms_strcmp_avx2;
+    ops->strncmp = __ms_strncmp_avx2;
+    ops->memmem_short = __ms_memmem_short_avx2;
+    ops->memcpy  = __ms_memcpy_avx2;
+    ops->memmove = __ms_memmove_avx2;
+    ops->memset  = __ms_memset_avx2;
+    ops->memcmp  = __ms_memcmp_avx2;
+    ops->strncasecmp = __ms_strncasecmp_avx2;
+    ops->memcasecmp  = __ms_memcasecmp_avx2;
+    ops->memcasemem  = __ms_memcasemem_avx2;
+    ops->span_set = __ms_span_set_avx2;
+    ops->span_set_n = __ms_span_set_n_avx2;
+    ops->set_bitmap = __ms_set_bitmap_avx2;
+    ops->hex_encode = __ms_hex_encode_avx2;
+    ops->hex_decode = __ms_hex_decode_avx2;
+    ops->base64_encode = __ms_base64_encode_avx2;
+    ops->base64_decode = __ms_base64_decode_avx2;
+    return 1;
+  case MS_TIER_SSSE3:
+    if (!__builtin_cpu_supports("ssse3")) {
+      return 0;
+    }
+    ops->span_set = __ms_span_set_ssse3;
+    ops->span_set_n = __ms_span_set_n_ssse3;
+    ops->set_bitmap = __ms_set_bitmap_ssse3;
+    ops->hex_encode = __ms_hex_encode_ssse3;
+    ops->hex_decode = __ms_hex_decode_ssse3;
+    ops->base64_encode = __ms_base64_encode_ssse3;
+    ops->base64_decode = __ms_base64_decode_ssse3;
+    // and the SSE2 kernels, every SSSE3 CPU has SSE2
+    /* fall through */
+  case MS_TIER_SSE2:
+    if (!__builtin_cpu_supports("sse2")) {
+      return 0;
+    }
+    ops->strlen  = __ms_strlen_sse2;
+    ops->strnlen = __ms_strnlen_sse2;
+    ops->memchr  = __ms_memchr_sse2;
+    ops->memrchr = __ms_memrchr_sse2;
+    ops->strchr  = __ms_strchr_sse2;
+    ops->strchrnul = __ms_strchrnul_sse2;
+    ops->strrchr = __ms_strrchr_sse2;
+    ops->strcmp  = __ms_strcmp_sse2;
+    ops->strncmp = __ms_strncmp_sse2;
+    ops->memmem_short = __ms_memmem_short_sse2;
+    ops->memcpy  = __ms_memcpy_sse2;
+    ops->memmove = __ms_memmove_sse2;
+    ops->memset  = __ms_memset_sse2;
+    ops->memcmp  = __ms_memcmp_sse2;
+    ops->strncasecmp = __ms_strncasecmp_sse2;
+    ops->memcasecmp  = __ms_memcasecmp_sse2;
+    ops->memcasemem  = __ms_memcasemem_sse2;
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------
+/**
+ * Replace portable kernels with the widest ones the CPU supports
+ *
+ * @param ops Dispatch table to update
+ */
+void __ms_dispatch_x86(struct ms_string_ops *ops)
+{
+  int tier;
+
+  for (tier = MS_TIER_AVX2; tier >= MS_TIER_SSE2; tier--) {
+    if (__ms_dispatch_x86_tier(ops, tier)) {
+      return;
+    }
+  }
+}
+
+#else
+
+//----------------------------------------------------------------------
+void __ms_dispatch_x86(struct ms_string_ops *ops)
+{
+  // not x86, keep portable kernels
+  (void) ops;
+}
+
+//----------------------------------------------------------------------
+int __ms_dispatch_x86_tier(struct ms_string_ops *ops, int tier)
+{
+  (void) ops;
+  (void) tier;
+  return 0;
+}
+
+#endif
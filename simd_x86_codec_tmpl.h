@@ -0,0 +1,172 @@
+/**
+ * Vector hex and base64 kernels, instantiated once per vector width by
+ * simd_x86.c. No include guard, this file is included several times on
+ * purpose.
+ *
+ * The includer defines everything simd_x86_shuf_tmpl.h needs, and:
+ *   VEC_SUB8(a,b)          byte-wise subtract
+ *   VEC_SUBS_U8(a,b)       byte-wise unsigned saturating subtract
+ *   VEC_SET1_16(x)         broadcast 16-bit word
+ *   VEC_SET1_32(x)         broadcast 32-bit word
+ *   VEC_MADDUBS(a,b)       unsigned by signed bytes, adjacent pairs added
+ *   VEC_MADD16(a,b)        16-bit products, adjacent pairs added
+ *   VEC_MULHI_U16(a,b)     high half of unsigned 16-bit products
+ *   VEC_MULLO16(a,b)       low half of 16-bit products
+ *   VEC_UNPACKLO8(a,b)     interleave bytes of the low half of each lane
+ *   VEC_UNPACKHI8(a,b)     interleave bytes of the high half of each lane
+ *   VEC_SPLIT_LANES(v)     order 64-bit words so the unpacks of each lane
+ *                          give the first and second half of v
+ *   VEC_PACKUS16(a,b)      saturate words to bytes, a then b in order
+ *   VEC_LOAD_B64(p)        load 12 bytes into the start of every lane
+ *   VEC_PACK_B64(v)        move the first 12 bytes of every lane together
+ *
+ * Base64 follows "Faster Base64 Encoding and Decoding using AVX2
+ * Instructions" (Mula, Lemire 2018).
+ */
+
+//----------------------------------------------------------------------
+static size_t KERNEL(hex_encode)(char *dst, const unsigned char *src, size_t n, int upper)
+{
+  const VEC_T tbl = VEC_BCAST16(upper ? "0123456789ABCDEF" : "0123456789abcdef");
+  const VEC_T low = VEC_SET1(0x0F);
+  size_t i;
+
+  for (i = 0; i + VEC_BYTES <= n; i += VEC_BYTES) {
+    const VEC_T v  = VEC_SPLIT_LANES(VEC_LOADU(src + i));
+    const VEC_T hi = VEC_SHUFFLE(tbl, VEC_AND(VEC_SRLI16(v, 4), low));
+    const VEC_T lo = VEC_SHUFFLE(tbl, VEC_AND(v, low));
+
+    VEC_STOREU(dst + (2 * i), VEC_UNPACKLO8(hi, lo));
+    VEC_STOREU(dst + (2 * i) + VEC_BYTES, VEC_UNPACKHI8(hi, lo));
+  }
+  return (2 * i) + __ms_hex_encode_generic(dst + (2 * i), src + i, n - i, upper);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Get values of hex digits
+ *
+ * @param c      Characters
+ * @param valid  Out parameter, one bit per byte that is a hex digit
+ *
+ * @return Digit values, 0 for other bytes
+ */
+static inline VEC_T KERNEL(hex_values)(VEC_T c, uint32_t *valid)
+{
+  const VEC_T l   = VEC_OR(c, VEC_SET1(0x20));
+  const VEC_T dig = VEC_AND(VEC_CMPGT(c, VEC_SET1('0' - 1)), VEC_CMPGT(VEC_SET1('9' + 1), c));
+  const VEC_T alp = VEC_AND(VEC_CMPGT(l, VEC_SET1('a' - 1)), VEC_CMPGT(VEC_SET1('f' + 1), l));
+
+  *valid = VEC_MASK(VEC_OR(dig, alp));
+  return VEC_OR(VEC_AND(dig, VEC_SUB8(c, VEC_SET1('0'))),
+                VEC_AND(alp, VEC_SUB8(l, VEC_SET1('a' - 10))));
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(hex_decode)(unsigned char *dst, const char *src, size_t n, size_t *bad)
+{
+  size_t i;
+  size_t r;
+
+  for (i = 0; i + (2 * VEC_BYTES) <= n; i += 2 * VEC_BYTES) {
+    uint32_t va;
+    uint32_t vb;
+    VEC_T a = KERNEL(hex_values)(VEC_LOADU(src + i), &va);
+    VEC_T b = KERNEL(hex_values)(VEC_LOADU(src + i + VEC_BYTES), &vb);
+
+    if ((va & vb) != VEC_ALL) {
+      break;
+    }
+    // high digit times 16 plus low digit, one per word
+    a = VEC_MADDUBS(a, VEC_SET1_16(0x0110));
+    b = VEC_MADDUBS(b, VEC_SET1_16(0x0110));
+    VEC_STOREU(dst + (i / 2), VEC_PACKUS16(a, b));
+  }
+  r = __ms_hex_decode_generic(dst + (i / 2), src + i, n - i, bad);
+  *bad += i;
+  return (i / 2) + r;
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(base64_encode)(char *dst, const unsigned char *src, size_t n)
+{
+  // every 3 bytes as b1 b0 b2 b1, so each 6-bit field is in one word
+  static const char spread[16] = {
+    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+  };
+  // added to the field value, indexed by its range
+  static const char offset[16] = {
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+  };
+  const VEC_T sp  = VEC_BCAST16(spread);
+  const VEC_T off = VEC_BCAST16(offset);
+  size_t o = 0;
+  size_t i;
+
+  // the loads read 4 bytes past the block
+  for (i = 0; i + (VEC_BYTES / 4 * 3) + 4 <= n; i += VEC_BYTES / 4 * 3) {
+    const VEC_T in = VEC_SHUFFLE(VEC_LOAD_B64(src + i), sp);
+    const VEC_T t0 = VEC_MULHI_U16(VEC_AND(in, VEC_SET1_32(0x0FC0FC00)), VEC_SET1_32(0x04000040));
+    const VEC_T t1 = VEC_MULLO16(VEC_AND(in, VEC_SET1_32(0x003F03F0)), VEC_SET1_32(0x01000010));
+    const VEC_T idx = VEC_OR(t0, t1);
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    VEC_T range = VEC_SUBS_U8(idx, VEC_SET1(51));
+
+    range = VEC_OR(range, VEC_AND(VEC_CMPGT(VEC_SET1(26), idx), VEC_SET1(13)));
+    VEC_STOREU(dst + o, VEC_ADD8(VEC_SHUFFLE(off, range), idx));
+    o += VEC_BYTES;
+  }
+  return o + __ms_base64_encode_generic(dst + o, src + i, n - i);
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(base64_decode)(unsigned char *dst, const char *src, size_t n, size_t *bad)
+{
+  // valid low nibbles per high nibble, as a bit per high nibble
+  static const unsigned char valid_lo[16] = {
+    0xA8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8,
+    0xF8, 0xF8, 0xF0, 0x54, 0x50, 0x50, 0x50, 0x54
+  };
+  static const unsigned char valid_hi[16] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  };
+  // added to the character to get its value, by high nibble; '/' is 3 less
+  static const char shift[16] = {
+    0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+  };
+  // big endian 24-bit groups out of each 32-bit word
+  static const char gather[16] = {
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+  };
+  const VEC_T vlo = VEC_BCAST16(valid_lo);
+  const VEC_T vhi = VEC_BCAST16(valid_hi);
+  const VEC_T sh  = VEC_BCAST16(shift);
+  const VEC_T ga  = VEC_BCAST16(gather);
+  size_t o = 0;
+  size_t i;
+  size_t r;
+
+  // the stores write past the block, into room the rest of the input
+  // would need anyway
+  for (i = 0; i + (2 * VEC_BYTES) <= n; i += VEC_BYTES) {
+    const VEC_T c  = VEC_LOADU(src + i);
+    const VEC_T hi = VEC_AND(VEC_SRLI16(c, 4), VEC_SET1(0x0F));
+    const VEC_T lo = VEC_AND(c, VEC_SET1(0x0F));
+    VEC_T v;
+
+    if (VEC_MASK(VEC_CMPEQ(VEC_AND(VEC_SHUFFLE(vlo, lo), VEC_SHUFFLE(vhi, hi)), VEC_ZERO()))) {
+      break;
+    }
+    v = VEC_ADD8(VEC_SHUFFLE(sh, hi), VEC_AND(VEC_CMPEQ(c, VEC_SET1('/')), VEC_SET1(-3)));
+    v = VEC_ADD8(c, v);
+    v = VEC_MADDUBS(v, VEC_SET1_32(0x01400140));
+    v = VEC_MADD16(v, VEC_SET1_32(0x00011000));
+    VEC_STOREU(dst + o, VEC_PACK_B64(VEC_SHUFFLE(v, ga)));
+    o += VEC_BYTES / 4 * 3;
+  }
+  r = __ms_base64_decode_generic(dst + o, src + i, n - i, bad);
+  *bad += i;
+  return o + r;
+}
@@ -0,0 +1,128 @@
+/**
+ * Vector kernels built on byte shuffles (pshufb table lookups),
+ * instantiated once per vector width by simd_x86.c.
+ * No include guard, this file is included several times on purpose.
+ *
+ * The includer defines everything simd_x86_tmpl.h needs, and:
+ *   VEC_XOR(a,b)        bit-wise xor
+ *   VEC_SRLI16(v,n)     shift 16-bit lanes right
+ *   VEC_SHUFFLE(t,i)    look up bytes of t (per 16-byte lane) at indices i,
+ *                       zero where the index has bit 7 set
+ *   VEC_BCAST16(p)      load 16 bytes into every 16-byte lane
+ */
+
+//----------------------------------------------------------------------
+/**
+ * Test bytes for set membership with nibble lookup tables
+ *
+ * @param v    Bytes to test
+ * @param lo   Set table for bytes 0x00-0x7F, see ms_charset
+ * @param hi   Set table for bytes 0x80-0xFF, see ms_charset
+ * @param bit  Table of 1 << (i & 7)
+ *
+ * @return One bit per byte that is a member
+ */
+static inline uint32_t KERNEL(set_mask)(VEC_T v, VEC_T lo, VEC_T hi, VEC_T bit)
+{
+  // low nibble plus bit 7, so each table only hits its own half
+  const VEC_T idx  = VEC_AND(v, VEC_SET1((char) 0x8F));
+  const VEC_T row  = VEC_OR(VEC_SHUFFLE(lo, idx),
+                            VEC_SHUFFLE(hi, VEC_XOR(idx, VEC_SET1((char) 0x80))));
+  const VEC_T high = VEC_AND(VEC_SRLI16(v, 4), VEC_SET1(0x0F));
+  const VEC_T want = VEC_SHUFFLE(bit, high);
+
+  return VEC_MASK(VEC_CMPEQ(VEC_AND(row, want), want));
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(span_set)(const char *s, const struct ms_charset *set, int accept)
+{
+  static const unsigned char bits[16] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+  };
+  const VEC_T lo   = VEC_BCAST16(set->nib_lo);
+  const VEC_T hi   = VEC_BCAST16(set->nib_hi);
+  const VEC_T bit  = VEC_BCAST16(bits);
+  const VEC_T z    = VEC_ZERO();
+  const size_t off = (uintptr_t) s & (VEC_BYTES - 1);
+  const char *p    = s - off;
+  uint32_t m;
+  VEC_T v;
+
+  // aligned loads never cross a page, mask off bytes before s
+  v = VEC_LOAD(p);
+  for (;;) {
+    // stop at non-members when accepting (the terminator is never a
+    // member), at members or the terminator when rejecting
+    if (accept) {
+      m = ~KERNEL(set_mask)(v, lo, hi, bit) & VEC_ALL;
+    }
+    else {
+      m = KERNEL(set_mask)(v, lo, hi, bit) | VEC_MASK(VEC_CMPEQ(v, z));
+    }
+    if (p < s) {
+      m &= VEC_ALL << off;
+    }
+    if (m) {
+      return (size_t)(p + __builtin_ctz(m) - s);
+    }
+    p += VEC_BYTES;
+    v = VEC_LOAD(p);
+  }
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(span_set_n)(const char *s, size_t n, const struct ms_charset *set, int accept)
+{
+  static const unsigned char bits[16] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+  };
+  const VEC_T lo  = VEC_BCAST16(set->nib_lo);
+  const VEC_T hi  = VEC_BCAST16(set->nib_hi);
+  const VEC_T bit = VEC_BCAST16(bits);
+  size_t i;
+
+  accept = (accept != 0);
+  for (i = 0; i + VEC_BYTES <= n; i += VEC_BYTES) {
+    uint32_t m = KERNEL(set_mask)(VEC_LOADU(s + i), lo, hi, bit);
+
+    if (accept) {
+      m = ~m & VEC_ALL;
+    }
+    if (m) {
+      return i + __builtin_ctz(m);
+    }
+  }
+  for (; (i < n) && ((int) MS_CHARSET_HAS(set, s[i]) == accept); i++);
+  return i;
+}
+
+//----------------------------------------------------------------------
+static void KERNEL(set_bitmap)(const char *s, size_t n, const struct ms_charset *set, uint64_t *bits)
+{
+  static const unsigned char bit_tbl[16] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+  };
+  const VEC_T lo  = VEC_BCAST16(set->nib_lo);
+  const VEC_T hi  = VEC_BCAST16(set->nib_hi);
+  const VEC_T bit = VEC_BCAST16(bit_tbl);
+  size_t i;
+
+  // vectors never straddle a word, 64 is a multiple of the width
+  for (i = 0; i + VEC_BYTES <= n; i += VEC_BYTES) {
+    uint64_t m = KERNEL(set_mask)(VEC_LOADU(s + i), lo, hi, bit);
+
+    if ((i & 63) == 0) {
+      bits[i >> 6] = m;
+    }
+    else {
+      bits[i >> 6] |= m << (i & 63);
+    }
+  }
+  if ((i < n) && ((i & 63) == 0)) {
+    bits[i >> 6] = 0;
+  }
+  for (; i < n; i++) {
+    bits[i >> 6] |= (uint64_t) MS_CHARSET_HAS(set, s[i]) << (i & 63);
+  }
+}
@@ -0,0 +1,470 @@
+/**
+ * Vector string kernels, instantiated once per vector width by simd_x86.c.
+ * No include guard, this file is included several times on purpose.
+ *
+ * The includer defines:
+ *   VEC_T           vector type
+ *   VEC_BYTES       bytes per vector
+ *   VEC_ALL         match mask with all VEC_BYTES bits set
+ *   VEC_LOAD(p)     aligned load
+ *   VEC_LOADU(p)    unaligned load
+ *   VEC_STORE(p,v)  aligned store
+ *   VEC_STOREU(p,v) unaligned store
+ *   VEC_SET1(c)     broadcast byte
+ *   VEC_ZERO()      all-zero vector
+ *   VEC_CMPEQ(a,b)  byte-wise compare
+ *   VEC_OR(a,b)     bit-wise or
+ *   VEC_AND(a,b)    bit-wise and
+ *   VEC_ADD8(a,b)   byte-wise add
+ *   VEC_CMPGT(a,b)  byte-wise signed greater than
+ *   VEC_MASK(v)     one bit per byte, as uint32_t
+ *   KERNEL(name)    name of the kernel for this width
+ */
+
+//----------------------------------------------------------------------
+/**
+ * Scan memory for a byte and/or a terminating zero
+ *
+ * @param s         Start of memory
+ * @param c         Byte to search for
+ * @param n         Max number of bytes to scan, SIZE_MAX if unbounded
+ * @param want_c    Stop at byte c
+ * @param want_nul  Stop at zero byte
+ *
+ * @return Pointer to first matching byte, NULL if none within n bytes
+ */
+static inline const char * KERNEL(scan)(const char *s, int c, size_t n, int want_c, int want_nul)
+{
+  const VEC_T cc  = VEC_SET1((char) c);
+  const VEC_T z   = VEC_ZERO();
+  const size_t off = (uintptr_t) s & (VEC_BYTES - 1);
+  const char *p   = s - off;
+  size_t lim      = (n > SIZE_MAX - off) ? SIZE_MAX : (n + off);
+  size_t pos      = 0;
+  uint32_t m;
+  VEC_T v;
+
+  if (n == 0) {
+    return NULL;
+  }
+
+  // aligned loads never cross a page, mask off bytes before s
+  v = VEC_LOAD(p);
+  if (want_c && want_nul) {
+    m = VEC_MASK(VEC_OR(VEC_CMPEQ(v, cc), VEC_CMPEQ(v, z)));
+  }
+  else {
+    m = VEC_MASK(VEC_CMPEQ(v, want_c ? cc : z));
+  }
+  m &= VEC_ALL << off;
+
+  for (;;) {
+    if (m) {
+      pos += __builtin_ctz(m);
+      return (pos < lim) ? (p + pos) : NULL;
+    }
+    pos += VEC_BYTES;
+    if (pos >= lim) {
+      return NULL;
+    }
+    v = VEC_LOAD(p + pos);
+    if (want_c && want_nul) {
+      m = VEC_MASK(VEC_OR(VEC_CMPEQ(v, cc), VEC_CMPEQ(v, z)));
+    }
+    else {
+      m = VEC_MASK(VEC_CMPEQ(v, want_c ? cc : z));
+    }
+  }
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(strlen)(const char *s)
+{
+  return (size_t)(KERNEL(scan)(s, 0, SIZE_MAX, 0, 1) - s);
+}
+
+//----------------------------------------------------------------------
+static size_t KERNEL(strnlen)(const char *s, size_t max)
+{
+  const char *end = KERNEL(scan)(s, 0, max, 0, 1);
+  return end ? (size_t)(end - s) : max;
+}
+
+//----------------------------------------------------------------------
+static void * KERNEL(memchr)(const void *src, int c, size_t len)
+{
+  return (void *) KERNEL(scan)((const char *) src, c, len, 1, 0);
+}
+
+//----------------------------------------------------------------------
+static void * KERNEL(memrchr)(const void *src, int c, size_t len)
+{
+  const unsigned char *s = (const unsigned char *) src;
+  const VEC_T cc = VEC_SET1((char) c);
+
+  for (; len >= VEC_BYTES; len -= VEC_BYTES) {
+    uint32_t m = VEC_MASK(VEC_CMPEQ(VEC_LOADU(s + len - VEC_BYTES), cc));
+    if (m) {
+      return (void *)(s + len - VEC_BYTES + (31 - __builtin_clz(m)));
+    }
+  }
+  return __ms_memrchr_generic(s, c, len);
+}
+
+//----------------------------------------------------------------------
+static char * KERNEL(strchr)(const char *s, int c)
+{
+  const char *p = KERNEL(scan)(s, c, SIZE_MAX, 1, 1);
+  return (*p == (char) c) ? (char *) p : NULL;
+}
+
+static char * KERNEL(strchrnul)(const char *s, int c)
+{
+  return (char *) KERNEL(scan)(s, c, SIZE_MAX, 1, 1);
+}
+
+//----------------------------------------------------------------------
+static char * KERNEL(strrchr)(const char *s, int c)
+{
+  const VEC_T cc    = VEC_SET1((char) c);
+  const VEC_T z     = VEC_ZERO();
+  const size_t off  = (uintptr_t) s & (VEC_BYTES - 1);
+  const char *p     = s - off;
+  const char *save  = NULL;
+  uint32_t save_m   = 0;
+  uint32_t mc;
+  uint32_t mz;
+  VEC_T v;
+
+  v  = VEC_LOAD(p);
+  mc = VEC_MASK(VEC_CMPEQ(v, cc)) & (VEC_ALL << off);
+  mz = VEC_MASK(VEC_CMPEQ(v, z))  & (VEC_ALL << off);
+
+  while (!mz) {
+    // remember the last vector holding c, resolve position at the end
+    if (mc) {
+      save   = p;
+      save_m = mc;
+    }
+    p += VEC_BYTES;
+    v  = VEC_LOAD(p);
+    mc = VEC_MASK(VEC_CMPEQ(v, cc));
+    mz = VEC_MASK(VEC_CMPEQ(v, z));
+  }
+
+  // keep matches up to and including the terminator
+  mc &= mz ^ (mz - 1);
+  if (mc) {
+    save   = p;
+    save_m = mc;
+  }
+  return save ? (char *)(save + 31 - __builtin_clz(save_m)) : NULL;
+}
+
+//----------------------------------------------------------------------
+// A vector of both strings can be loaded when neither crosses a page
+#define KERNEL_PAGE_OK(p) (((uintptr_t)(p) & 4095) <= (4096 - VEC_BYTES))
+
+static int KERNEL(strncmp)(const char *s1, const char *s2, size_t n)
+{
+  const VEC_T z = VEC_ZERO();
+  size_t i = 0;
+
+  while (i < n) {
+    if (KERNEL_PAGE_OK(s1 + i) && KERNEL_PAGE_OK(s2 + i)) {
+      VEC_T a = VEC_LOADU(s1 + i);
+      VEC_T b = VEC_LOADU(s2 + i);
+      // first byte that differs or ends s1
+      uint32_t m = (~VEC_MASK(VEC_CMPEQ(a, b)) | VEC_MASK(VEC_CMPEQ(a, z))) & VEC_ALL;
+
+      if (m) {
+        i += __builtin_ctz(m);
+        if (i >= n) {
+          return 0;
+        }
+        return ((unsigned char) s1[i] - (unsigned char) s2[i]);
+      }
+      i += VEC_BYTES;
+    }
+    else {
+      // close to a page end, step bytewise up to the next vector
+      size_t k;
+
+      for (k = 0; (k < VEC_BYTES) && (i < n); k++, i++) {
+        if ((s1[i] != s2[i]) || !s1[i]) {
+          return ((unsigned char) s1[i] - (unsigned char) s2[i]);
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static int KERNEL(strcmp)(const char *s1, const char *s2)
+{
+  return KERNEL(strncmp)(s1, s2, SIZE_MAX);
+}
+
+#undef KERNEL_PAGE_OK
+
+//----------------------------------------------------------------------
+/**
+ * Search short needle, VEC_BYTES candidates at a time must match both
+ * the first and the last needle byte before the middle is compared
+ *
+ * @param hay     Haystack
+ * @param hlen    Haystack length, at least nlen
+ * @param needle  Needle
+ * @param nlen    Needle length, at least 2
+ *
+ * @return First match, NULL if not found
+ */
+static void * KERNEL(memmem_short)(const void *hay, size_t hlen, const void *needle, size_t nlen)
+{
+  const unsigned char *h = (const unsigned char *) hay;
+  const unsigned char *n = (const unsigned char *) needle;
+  const VEC_T first = VEC_SET1((char) n[0]);
+  const VEC_T last  = VEC_SET1((char) n[nlen - 1]);
+  const size_t end  = hlen - nlen + 1;
+  size_t i = 0;
+  size_t k;
+
+  for (; i + VEC_BYTES <= end; i += VEC_BYTES) {
+    uint32_t m = VEC_MASK(VEC_AND(VEC_CMPEQ(VEC_LOADU(h + i), first),
+                                  VEC_CMPEQ(VEC_LOADU(h + i + nlen - 1), last)));
+    while (m) {
+      const unsigned char *c = h + i + __builtin_ctz(m);
+
+      for (k = 1; (k < nlen - 1) && (c[k] == n[k]); k++);
+      if (k >= nlen - 1) {
+        return (void *) c;
+      }
+      m &= m - 1;
+    }
+  }
+
+  for (; i < end; i++) {
+    for (k = 0; (k < nlen) && (h[i + k] == n[k]); k++);
+    if (k == nlen) {
+      return (void *)(h + i);
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------
+static void * KERNEL(memcpy)(void * __restrict dst, const void * __restrict src, size_t len)
+{
+  unsigned char *d = (unsigned char *) dst;
+  const unsigned char *s = (const unsigned char *) src;
+  size_t i;
+  VEC_T head;
+  VEC_T tail;
+
+  if (len < VEC_BYTES) {
+    return __ms_memcpy_generic(dst, src, len);
+  }
+
+  // unaligned first and last vector, aligned stores in between
+  head = VEC_LOADU(s);
+  tail = VEC_LOADU(s + len - VEC_BYTES);
+  i = VEC_BYTES - ((uintptr_t) d & (VEC_BYTES - 1));
+  for (; i + 4 * VEC_BYTES <= len; i += 4 * VEC_BYTES) {
+    VEC_T v0 = VEC_LOADU(s + i);
+    VEC_T v1 = VEC_LOADU(s + i + VEC_BYTES);
+    VEC_T v2 = VEC_LOADU(s + i + 2 * VEC_BYTES);
+    VEC_T v3 = VEC_LOADU(s + i + 3 * VEC_BYTES);
+    VEC_STORE(d + i, v0);
+    VEC_STORE(d + i + VEC_BYTES, v1);
+    VEC_STORE(d + i + 2 * VEC_BYTES, v2);
+    VEC_STORE(d + i + 3 * VEC_BYTES, v3);
+  }
+  for (; i + VEC_BYTES <= len; i += VEC_BYTES) {
+    VEC_STORE(d + i, VEC_LOADU(s + i));
+  }
+  VEC_STOREU(d, head);
+  VEC_STOREU(d + len - VEC_BYTES, tail);
+  return dst;
+}
+
+//----------------------------------------------------------------------
+static void * KERNEL(memmove)(void *dst, const void *src, size_t len)
+{
+  unsigned char *d = (unsigned char *) dst;
+  const unsigned char *s = (const unsigned char *) src;
+  size_t i;
+  VEC_T head;
+  VEC_T tail;
+
+  if (len < VEC_BYTES) {
+    return __ms_memmove_generic(dst, src, len);
+  }
+
+  // the vectors stored last are loaded first, before they can be clobbered
+  head = VEC_LOADU(s);
+  tail = VEC_LOADU(s + len - VEC_BYTES);
+
+  if ((uintptr_t) d - (uintptr_t) s >= len) {
+    // forward, every vector is loaded before the store that may overlap it
+    for (i = 0; i + VEC_BYTES < len; i += VEC_BYTES) {
+      VEC_STOREU(d + i, VEC_LOADU(s + i));
+    }
+    VEC_STOREU(d + len - VEC_BYTES, tail);
+  }
+  else {
+    // destination starts inside source, backward
+    for (i = len; i > VEC_BYTES; i -= VEC_BYTES) {
+      VEC_STOREU(d + i - VEC_BYTES, VEC_LOADU(s + i - VEC_BYTES));
+    }
+    VEC_STOREU(d, head);
+  }
+  return dst;
+}
+
+//----------------------------------------------------------------------
+static void * KERNEL(memset)(void *dst, int c, size_t len)
+{
+  unsigned char *d = (unsigned char *) dst;
+  const VEC_T cc = VEC_SET1((char) c);
+  size_t i;
+
+  if (len < VEC_BYTES) {
+    return __ms_memset_generic(dst, c, len);
+  }
+
+  VEC_STOREU(d, cc);
+  i = VEC_BYTES - ((uintptr_t) d & (VEC_BYTES - 1));
+  for (; i + 2 * VEC_BYTES <= len; i += 2 * VEC_BYTES) {
+    VEC_STORE(d + i, cc);
+    VEC_STORE(d + i + VEC_BYTES, cc);
+  }
+  for (; i + VEC_BYTES <= len; i += VEC_BYTES) {
+    VEC_STORE(d + i, cc);
+  }
+  VEC_STOREU(d + len - VEC_BYTES, cc);
+  return dst;
+}
+
+//----------------------------------------------------------------------
+static int KERNEL(memcmp)(const void *s1, const void *s2, size_t len)
+{
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
+  size_t i;
+
+  for (i = 0; i + VEC_BYTES <= len; i += VEC_BYTES) {
+    uint32_t m = ~VEC_MASK(VEC_CMPEQ(VEC_LOADU(a + i), VEC_LOADU(b + i))) & VEC_ALL;
+
+    if (m) {
+      i += __builtin_ctz(m);
+      return (a[i] - b[i]);
+    }
+  }
+  return __ms_memcmp_generic(a + i, b + i, len - i);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Fold ASCII upper case letters to lower case, other bytes unchanged
+ *
+ * @param v  Bytes to fold
+ *
+ * @return Folded bytes
+ */
+static inline VEC_T KERNEL(fold)(VEC_T v)
+{
+  // shift 'A'..'Z' to the bottom of the signed range, one compare finds them
+  const VEC_T t     = VEC_ADD8(v, VEC_SET1((char)(0x80 - 'A')));
+  const VEC_T upper = VEC_CMPGT(VEC_SET1((char)(0x80 - 'A' + 'Z' + 1)), t);
+
+  return VEC_OR(v, VEC_AND(upper, VEC_SET1(0x20)));
+}
+
+//----------------------------------------------------------------------
+#define KERNEL_PAGE_OK(p) (((uintptr_t)(p) & 4095) <= (4096 - VEC_BYTES))
+
+static int KERNEL(strncasecmp)(const char *s1, const char *s2, size_t n)
+{
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
+  const VEC_T z = VEC_ZERO();
+  size_t i = 0;
+
+  while (i < n) {
+    if (KERNEL_PAGE_OK(a + i) && KERNEL_PAGE_OK(b + i)) {
+      VEC_T va = VEC_LOADU(a + i);
+      VEC_T vb = VEC_LOADU(b + i);
+      uint32_t m = (~VEC_MASK(VEC_CMPEQ(KERNEL(fold)(va), KERNEL(fold)(vb))) |
+                    VEC_MASK(VEC_CMPEQ(va, z))) & VEC_ALL;
+
+      if (m) {
+        i += __builtin_ctz(m);
+        if (i >= n) {
+          return 0;
+        }
+        return __ascii_tolower(a[i]) - __ascii_tolower(b[i]);
+      }
+      i += VEC_BYTES;
+    }
+    else {
+      // close to a page end, step bytewise up to the next vector
+      size_t k;
+
+      for (k = 0; (k < VEC_BYTES) && (i < n); k++, i++) {
+        int d = __ascii_tolower(a[i]) - __ascii_tolower(b[i]);
+        if (d || !a[i]) {
+          return d;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+#undef KERNEL_PAGE_OK
+
+//----------------------------------------------------------------------
+static int KERNEL(memcasecmp)(const void *s1, const void *s2, size_t len)
+{
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
+  size_t i;
+
+  for (i = 0; i + VEC_BYTES <= len; i += VEC_BYTES) {
+    uint32_t m = ~VEC_MASK(VEC_CMPEQ(KERNEL(fold)(VEC_LOADU(a + i)),
+                                     KERNEL(fold)(VEC_LOADU(b + i)))) & VEC_ALL;
+    if (m) {
+      i += __builtin_ctz(m);
+      return __ascii_tolower(a[i]) - __ascii_tolower(b[i]);
+    }
+  }
+  return __ms_memcasecmp_generic(a + i, b + i, len - i);
+}
+
+//----------------------------------------------------------------------
+static void * KERNEL(memcasemem)(const void *hay, size_t hlen, const void *needle, size_t nlen)
+{
+  const unsigned char *h = (const unsigned char *) hay;
+  const unsigned char *n = (const unsigned char *) needle;
+  const VEC_T first = VEC_SET1((char) __ascii_tolower(n[0]));
+  const VEC_T last  = VEC_SET1((char) __ascii_tolower(n[nlen - 1]));
+  const size_t end  = hlen - nlen + 1;
+  size_t i;
+
+  for (i = 0; i + VEC_BYTES <= end; i += VEC_BYTES) {
+    uint32_t m = VEC_MASK(VEC_AND(VEC_CMPEQ(KERNEL(fold)(VEC_LOADU(h + i)), first),
+                                  VEC_CMPEQ(KERNEL(fold)(VEC_LOADU(h + i + nlen - 1)), last)));
+    while (m) {
+      const unsigned char *c = h + i + __builtin_ctz(m);
+
+      if (!KERNEL(memcasecmp)(c, n, nlen)) {
+        return (void *) c;
+      }
+      m &= m - 1;
+    }
+  }
+  if (i < end) {
+    return __ms_memcasemem_generic(h + i, hlen - i, n, nlen);
+  }
+  return NULL;
+}
@@ -3,37 +3,105 @@
  */
 
 #include <stdio.h>
-#include <ctype.h>
+#include <stdint.h>
 #include <math.h>
 #include <float.h>
 #include <limits.h>
 #include <assert.h>
 
 #include <string.h>
+#include <dispatch.h>
+#include <fpconv.h>
+#include <swar.h>
+#include <ascii.h>
 
 //#define ASSERT(cond)
 #define ASSERT(cond) assert(cond)
 
 //----------------------------------------------------------------------
-int strcmp(const char *s1, const char *s2)
+// Word-at-a-time scanning, shared by strlen, strnlen, memchr and strchr.
+// Words are loaded aligned, so a load never crosses a page boundary and
+// touching the few bytes around the string is safe; matches in those
+// bytes are masked out before they are reported.
+
+/**
+ * Scan memory for a byte and/or a terminating zero
+ *
+ * @param s         Start of memory
+ * @param c         Byte to search for
+ * @param n         Max number of bytes to scan, SIZE_MAX if unbounded
+ * @param want_c    Stop at byte c
+ * @param want_nul  Stop at zero byte
+ *
+ * @return Pointer to first matching byte, NULL if none within n bytes
+ */
+static inline const char * __swar_scan(const char *s, int c, size_t n, int want_c, int want_nul)
 {
-  ASSERT(s1);
-  ASSERT(s2);
+#if SWAR_ENABLED
+  const unsigned char *p;
+  uint64_t cc;
+  uint64_t m;
+  size_t off;
+  size_t lim;
+  size_t pos;
+
+  if (n == 0) {
+    return NULL;
+  }
+
+  cc  = SWAR_ONES * (unsigned char) c;
+  off = (uintptr_t) s & (SWAR_BYTES - 1);
+  p   = (const unsigned char *) s - off;
+  lim = (n > SIZE_MAX - off) ? SIZE_MAX : (n + off);
+
+  m = __swar_match(*(const swar_t *) p, cc, want_c, want_nul);
+  m = __swar_clear_head(m, off);
+
+  for (pos = 0;;) {
+    if (m) {
+      pos += __swar_first(m);
+      return (pos < lim) ? (const char *)(p + pos) : NULL;
+    }
+    pos += SWAR_BYTES;
+    if (pos >= lim) {
+      return NULL;
+    }
+    m = __swar_match(*(const swar_t *)(p + pos), cc, want_c, want_nul);
+  }
+#else
+  const unsigned char *p = (const unsigned char *) s;
+
+  for (; n; n--, p++) {
+    if ((want_c && (*p == (unsigned char) c)) || (want_nul && (*p == 0))) {
+      return (const char *) p;
+    }
+  }
+  return NULL;
+#endif
+}
 
+//----------------------------------------------------------------------
+int __ms_strcmp_generic(const char *s1, const char *s2)
+{
   while ((*s1 == *s2) && *s1) {
     s1++;
     s2++;
   }
 
-  return (*s1 - *s2);
+  return (*(unsigned char *) s1 - *(unsigned char *) s2);
 }
 
-//----------------------------------------------------------------------
-int strncmp(const char *s1, const char *s2, size_t n)
+int strcmp(const char *s1, const char *s2)
 {
   ASSERT(s1);
   ASSERT(s2);
 
+  return __ms_string_ops.strcmp(s1, s2);
+}
+
+//----------------------------------------------------------------------
+int __ms_strncmp_generic(const char *s1, const char *s2, size_t n)
+{
   if (n == 0) {
     return 0;
   }
@@ -43,83 +111,524 @@ int strncmp(const char *s1, const char *s2, size_t n)
     s2++;
   }
 
-  return (*s1 - *s2);
+  return (*(unsigned char *) s1 - *(unsigned char *) s2);
+}
+
+int strncmp(const char *s1, const char *s2, size_t n)
+{
+  ASSERT(s1);
+  ASSERT(s2);
+
+  return __ms_string_ops.strncmp(s1, s2, n);
 }
 
 //----------------------------------------------------------------------
-size_t strlen(const char *s)
+size_t __ms_strlen_generic(const char *s)
 {
-  size_t len = 0;
+  return (size_t)(__swar_scan(s, 0, SIZE_MAX, 0, 1) - s);
+}
 
+size_t strlen(const char *s)
+{
   ASSERT(s);
 
-  while (*s++ && ++len);
-
-  return len;
+  return __ms_string_ops.strlen(s);
 }
 
 //----------------------------------------------------------------------
+void * __ms_memchr_generic(const void *src, int c, size_t len)
+{
+  return (void *) __swar_scan((const char *) src, c, len, 1, 0);
+}
+
 void * memchr(const void *src, int c, size_t len)
 {
-  char *s = (char*)src;
+  ASSERT(src);
 
-  ASSERT(s);
+  return __ms_string_ops.memchr(src, c, len);
+}
+
+//----------------------------------------------------------------------
+void * __ms_memrchr_generic(const void *src, int c, size_t len)
+{
+  const unsigned char *s = (const unsigned char *) src;
+
+#if SWAR_ENABLED
+  const uint64_t cc = SWAR_ONES * (unsigned char) c;
 
+  for (; len >= SWAR_BYTES; len -= SWAR_BYTES) {
+    uint64_t m = __swar_zero(((const swar_u_t *)(s + len - SWAR_BYTES))->v ^ cc);
+    if (m) {
+      return (void *)(s + len - SWAR_BYTES + __swar_last(m));
+    }
+  }
+#endif
   while (len--) {
-    if (*s == c) {
-      return (void *) s;
+    if (s[len] == (unsigned char) c) {
+      return (void *)(s + len);
     }
-    src++;
   }
   return NULL;
 }
 
+/**
+ * Find last occurrence of byte in memory
+ *
+ * @param src  Memory to search
+ * @param c    Byte to find
+ * @param len  Number of bytes to search
+ *
+ * @return Last occurrence, NULL if not found
+ */
+void * memrchr(const void *src, int c, size_t len)
+{
+  ASSERT(src || !len);
+
+  return __ms_string_ops.memrchr(src, c, len);
+}
+
 //----------------------------------------------------------------------
-size_t strnlen(const char *s, size_t max)
+size_t __ms_strnlen_generic(const char *s, size_t max)
 {
-  const char *end = (const char *) memchr(s, 0, max);
+  const char *end = __swar_scan(s, 0, max, 0, 1);
   return end ? (size_t)(end - s) : max;
 }
 
+size_t strnlen(const char *s, size_t max)
+{
+  ASSERT(s);
+
+  return __ms_string_ops.strnlen(s, max);
+}
+
 //----------------------------------------------------------------------
-char * strstr(const char *in, const char *s)
+// Forward copy, shared by memcpy and memmove. Not restrict: memmove runs
+// it on overlapping buffers with d before s, which is safe as every word
+// is read before the store that may overlap it.
+static inline void __copy_fwd(unsigned char *d, const unsigned char *s, size_t len)
 {
-  char c;
-  size_t len;
+#if SWAR_ENABLED
+  if (len >= 4 * SWAR_BYTES) {
+    // align destination, source may stay unaligned
+    while ((uintptr_t) d & (SWAR_BYTES - 1)) {
+      *d++ = *s++;
+      len--;
+    }
+    for (; len >= 4 * SWAR_BYTES; len -= 4 * SWAR_BYTES) {
+      uint64_t w0 = ((const swar_u_t *) s)[0].v;
+      uint64_t w1 = ((const swar_u_t *) s)[1].v;
+      uint64_t w2 = ((const swar_u_t *) s)[2].v;
+      uint64_t w3 = ((const swar_u_t *) s)[3].v;
+      ((swar_t *) d)[0] = w0;
+      ((swar_t *) d)[1] = w1;
+      ((swar_t *) d)[2] = w2;
+      ((swar_t *) d)[3] = w3;
+      d += 4 * SWAR_BYTES;
+      s += 4 * SWAR_BYTES;
+    }
+    for (; len >= SWAR_BYTES; len -= SWAR_BYTES) {
+      *(swar_t *) d = ((const swar_u_t *) s)->v;
+      d += SWAR_BYTES;
+      s += SWAR_BYTES;
+    }
+  }
+#endif
+  while (len--) {
+    *d++ = *s++;
+  }
+}
+
+void * __ms_memcpy_generic(void * __restrict dst, const void * __restrict src, size_t len)
+{
+  __copy_fwd((unsigned char *) dst, (const unsigned char *) src, len);
+  return dst;
+}
+
+void * memcpy(void * __restrict dst, const void * __restrict src, size_t len)
+{
+  ASSERT(dst || !len);
+  ASSERT(src || !len);
+
+  return __ms_string_ops.memcpy(dst, src, len);
+}
+
+//----------------------------------------------------------------------
+void * __ms_memmove_generic(void *dst, const void *src, size_t len)
+{
+  unsigned char *d = (unsigned char *) dst;
+  const unsigned char *s = (const unsigned char *) src;
+
+  // forward copy is safe unless destination starts inside source
+  if ((uintptr_t) d - (uintptr_t) s >= len) {
+    __copy_fwd(d, s, len);
+    return dst;
+  }
+
+  d += len;
+  s += len;
+#if SWAR_ENABLED
+  for (; len >= SWAR_BYTES; len -= SWAR_BYTES) {
+    d -= SWAR_BYTES;
+    s -= SWAR_BYTES;
+    ((swar_u_t *) d)->v = ((const swar_u_t *) s)->v;
+  }
+#endif
+  while (len--) {
+    *--d = *--s;
+  }
+  return dst;
+}
+
+void * memmove(void *dst, const void *src, size_t len)
+{
+  ASSERT(dst || !len);
+  ASSERT(src || !len);
+
+  return __ms_string_ops.memmove(dst, src, len);
+}
+
+//----------------------------------------------------------------------
+void * __ms_memset_generic(void *dst, int c, size_t len)
+{
+  unsigned char *d = (unsigned char *) dst;
+
+#if SWAR_ENABLED
+  if (len >= 2 * SWAR_BYTES) {
+    const uint64_t cc = SWAR_ONES * (unsigned char) c;
+
+    while ((uintptr_t) d & (SWAR_BYTES - 1)) {
+      *d++ = (unsigned char) c;
+      len--;
+    }
+    for (; len >= SWAR_BYTES; len -= SWAR_BYTES) {
+      *(swar_t *) d = cc;
+      d += SWAR_BYTES;
+    }
+  }
+#endif
+  while (len--) {
+    *d++ = (unsigned char) c;
+  }
+  return dst;
+}
+
+void * memset(void *dst, int c, size_t len)
+{
+  ASSERT(dst || !len);
+
+  return __ms_string_ops.memset(dst, c, len);
+}
+
+//----------------------------------------------------------------------
+int __ms_memcmp_generic(const void *s1, const void *s2, size_t len)
+{
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
+
+#if SWAR_ENABLED
+  // skip equal words, the differing one is resolved bytewise
+  for (; len >= SWAR_BYTES; len -= SWAR_BYTES) {
+    if (((const swar_u_t *) a)->v != ((const swar_u_t *) b)->v) {
+      break;
+    }
+    a += SWAR_BYTES;
+    b += SWAR_BYTES;
+  }
+#endif
+  for (; len; len--, a++, b++) {
+    if (*a != *b) {
+      return (*a - *b);
+    }
+  }
+  return 0;
+}
+
+int memcmp(const void *s1, const void *s2, size_t len)
+{
+  ASSERT(s1 || !len);
+  ASSERT(s2 || !len);
+
+  return __ms_string_ops.memcmp(s1, s2, len);
+}
+
+//----------------------------------------------------------------------
+// Needles up to this length are searched with the first/last byte
+// prefilter, longer ones with the Two-Way algorithm.
+#define MEMMEM_SHORT_NEEDLE (32)
+
+/**
+ * Check if two memory areas hold the same bytes
+ *
+ * @param a    First area
+ * @param b    Second area
+ * @param len  Number of bytes to compare
+ *
+ * @return 1 if equal, 0 otherwise
+ */
+static inline int __mem_equal(const unsigned char *a, const unsigned char *b, size_t len)
+{
+  while (len--) {
+    if (*a++ != *b++) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Search short needle, candidates must match both first and last byte
+ *
+ * @param hay     Haystack
+ * @param hlen    Haystack length, at least nlen
+ * @param needle  Needle
+ * @param nlen    Needle length, at least 2
+ *
+ * @return First match, NULL if not found
+ */
+void * __ms_memmem_short_generic(const void *hay, size_t hlen, const void *needle, size_t nlen)
+{
+  const unsigned char *h    = (const unsigned char *) hay;
+  const unsigned char *n    = (const unsigned char *) needle;
+  const unsigned char *last = h + hlen - nlen;
+
+  while (h <= last) {
+    h = (const unsigned char *) memchr(h, n[0], (size_t)(last - h) + 1);
+    if (!h) {
+      return NULL;
+    }
+    if ((h[nlen - 1] == n[nlen - 1]) && __mem_equal(h + 1, n + 1, nlen - 2)) {
+      return (void *) h;
+    }
+    h++;
+  }
+  return NULL;
+}
+
+#define BITOP(a,b,op) \
+  ((a)[(size_t)(b) / (8 * sizeof *(a))] op ((size_t)1 << ((size_t)(b) % (8 * sizeof *(a)))))
+
+/**
+ * Compute maximal suffix of needle (critical factorization helper)
+ *
+ * @param n       Needle
+ * @param nlen    Needle length
+ * @param period  Out parameter, period of the maximal suffix
+ * @param rev     Use reversed byte order
+ *
+ * @return Position before the maximal suffix, (size_t)-1 for whole needle
+ */
+static size_t __maximal_suffix(const unsigned char *n, size_t nlen, size_t *period, int rev)
+{
+  size_t ip = (size_t) -1;
+  size_t jp = 0;
+  size_t k  = 1;
+  size_t p  = 1;
+
+  while (jp + k < nlen) {
+    unsigned char a = n[ip + k];
+    unsigned char b = n[jp + k];
+
+    if (a == b) {
+      if (k == p) {
+        jp += p;
+        k = 1;
+      }
+      else {
+        k++;
+      }
+    }
+    else if (rev ? (a < b) : (a > b)) {
+      jp += k;
+      k = 1;
+      p = jp - ip;
+    }
+    else {
+      ip = jp++;
+      k = p = 1;
+    }
+  }
+  *period = p;
+  return ip;
+}
+
+/**
+ * Two-Way string matching (Crochemore-Perrin), linear time, constant space
+ *
+ * A bad-character shift on the last needle byte is tried before the
+ * two halves are compared, which makes long non-matching runs sublinear.
+ *
+ * @param h     Haystack
+ * @param hlen  Haystack length
+ * @param n     Needle
+ * @param nlen  Needle length, at least 2
+ *
+ * @return First match, NULL if not found
+ */
+static void * __twoway_memmem(const unsigned char *h, size_t hlen, const unsigned char *n, size_t nlen)
+{
+  const unsigned char *z = h + hlen;
+  size_t byteset[32 / sizeof(size_t)] = { 0 };
+  size_t shift[256];
+  size_t i;
+  size_t k;
+  size_t ms;
+  size_t ms_rev;
+  size_t p;
+  size_t p_rev;
+  size_t mem;
+  size_t mem0;
+
+  for (i = 0; i < nlen; i++) {
+    BITOP(byteset, n[i], |=);
+    shift[n[i]] = i + 1;
+  }
+
+  // critical factorization, the later of the two maximal suffixes
+  ms     = __maximal_suffix(n, nlen, &p, 0);
+  ms_rev = __maximal_suffix(n, nlen, &p_rev, 1);
+  if (ms_rev + 1 > ms + 1) {
+    ms = ms_rev;
+    p  = p_rev;
+  }
+
+  // periodic needle remembers how much of its prefix is known to match
+  if (!__mem_equal(n, n + p, ms + 1)) {
+    mem0 = 0;
+    p = ((ms > nlen - ms - 1) ? ms : (nlen - ms - 1)) + 1;
+  }
+  else {
+    mem0 = nlen - p;
+  }
+  mem = 0;
+
+  for (;;) {
+    if ((size_t)(z - h) < nlen) {
+      return NULL;
+    }
+
+    // last byte first, shift on mismatch
+    if (BITOP(byteset, h[nlen - 1], &)) {
+      k = nlen - shift[h[nlen - 1]];
+      if (k) {
+        if (k < mem) {
+          k = mem;
+        }
+        h += k;
+        mem = 0;
+        continue;
+      }
+    }
+    else {
+      h += nlen;
+      mem = 0;
+      continue;
+    }
+
+    // right half
+    for (k = ((ms + 1 > mem) ? (ms + 1) : mem); (k < nlen) && (n[k] == h[k]); k++);
+    if (k < nlen) {
+      h += k - ms;
+      mem = 0;
+      continue;
+    }
+
+    // left half
+    for (k = ms + 1; (k > mem) && (n[k - 1] == h[k - 1]); k--);
+    if (k <= mem) {
+      return (void *) h;
+    }
+    h += p;
+    mem = mem0;
+  }
+}
 
+#undef BITOP
+
+//----------------------------------------------------------------------
+/**
+ * Find needle in haystack, both of known length
+ *
+ * @param hay     Haystack
+ * @param hlen    Haystack length
+ * @param needle  Needle
+ * @param nlen    Needle length
+ *
+ * @return First match, hay if needle is empty, NULL if not found
+ */
+void * memmem(const void *hay, size_t hlen, const void *needle, size_t nlen)
+{
+  ASSERT(hay || !hlen);
+  ASSERT(needle || !nlen);
+
+  if (nlen == 0) {
+    return (void *) hay;
+  }
+  if (nlen > hlen) {
+    return NULL;
+  }
+  if (nlen == 1) {
+    return memchr(hay, *(const unsigned char *) needle, hlen);
+  }
+  if (nlen <= MEMMEM_SHORT_NEEDLE) {
+    return __ms_string_ops.memmem_short(hay, hlen, needle, nlen);
+  }
+  return __twoway_memmem((const unsigned char *) hay, hlen,
+                         (const unsigned char *) needle, nlen);
+}
+
+//----------------------------------------------------------------------
+char * strstr(const char *in, const char *s)
+{
+  ASSERT(in);
   ASSERT(s);
 
-  c = *s++;
-  if (!c) {
+  if (!*s) {
     return (char *) in; // Trivial empty string case
   }
 
-  len = strlen(s);
-  do {
-    char sc;
-
-    do {
-      sc = *in++;
-      if (!sc)
-        return (char *) 0;
-    } while (sc != c);
-  } while (strncmp(in, s, len) != 0);
+  // skip to first candidate before measuring the haystack
+  in = strchr(in, *s);
+  if (!in) {
+    return NULL;
+  }
 
-  return (char *) (in - 1);
+  return (char *) memmem(in, strlen(in), s, strlen(s));
 }
 
 //----------------------------------------------------------------------
+char * __ms_strchr_generic(const char *s, int c)
+{
+  // stops at c or at the terminator, which is also a match when c is 0
+  const char *p = __swar_scan(s, c, SIZE_MAX, 1, 1);
+  return (*p == (char) c) ? (char *) p : NULL;
+}
+
 char * strchr(char const *s, int c)
 {
   ASSERT(s);
 
-  do {
-    if ((unsigned) *s == (unsigned) c)
-      return (char *)s;
+  return __ms_string_ops.strchr(s, c);
+}
 
-  } while ((*(++s)) != 0);
+//----------------------------------------------------------------------
+char * __ms_strchrnul_generic(const char *s, int c)
+{
+  return (char *) __swar_scan(s, c, SIZE_MAX, 1, 1);
+}
 
-  return NULL;
+/**
+ * Find character in string, or its terminator
+ *
+ * @param s  String
+ * @param c  Character
+ *
+ * @return First c in s, pointer to the terminator if there is none
+ */
+char * strchrnul(const char *s, int c)
+{
+  ASSERT(s);
+
+  return __ms_string_ops.strchrnul(s, c);
 }
 
 //----------------------------------------------------------------------
@@ -137,14 +646,12 @@ char * strnchr(const char * s, size_t len, int c)
 }
 
 //----------------------------------------------------------------------
-char * strrchr(const char *s, int c)
+char * __ms_strrchr_generic(const char *s, int c)
 {
   char * save;
 
-  ASSERT(s);
-
   for (save = NULL;; ++s) {
-    if (*s == c) {
+    if (*s == (char) c) {
       save = (char*)s;
     }
     if (!*s)
@@ -154,69 +661,168 @@ char * strrchr(const char *s, int c)
   return NULL;
 }
 
+char * strrchr(const char *s, int c)
+{
+  ASSERT(s);
+
+  return __ms_string_ops.strrchr(s, c);
+}
+
 //----------------------------------------------------------------------
 char * strcat(char *dest, const char *src)
 {
-  char *ret = dest;
-
   ASSERT(dest);
   ASSERT(src);
 
-  while (*dest)
-    dest++;
-
-  while ((*dest++ = *src++));
-
-  return ret;
+  stpcpy(dest + strlen(dest), src);
+  return dest;
 }
 
 //----------------------------------------------------------------------
 char * strncat(char *dest, const char *src, size_t len)
 {
-  size_t i;
-  char *ret = dest;
+  char *end;
 
   ASSERT(dest);
   ASSERT(src);
 
-  while (*dest) {
-    dest++;
-  }
+  end = dest + strlen(dest);
+  len = strnlen(src, len);
+  memcpy(end, src, len);
+  end[len] = '\0';
 
-  for (i = 0; (i < len) && *src; i++) {
-      *dest++ = *src++;
-  }
+  return dest;
+}
 
-  *dest = '\0';
+//----------------------------------------------------------------------
+char * strcpy(char * __restrict to, const char * __restrict from)
+{
+  ASSERT(from);
+  ASSERT(to);
 
-  return ret;
+  stpcpy(to, from);
+  return to;
 }
 
 //----------------------------------------------------------------------
-char * strcpy(char * __restrict to, const char * __restrict from)
+/**
+ * Copy string, return end of copy to allow chaining without rescans
+ *
+ * @param to    Destination
+ * @param from  Source string
+ *
+ * @return Pointer to the terminator written in to
+ */
+char * stpcpy(char * __restrict to, const char * __restrict from)
 {
-  char *save = to;
+  size_t len;
 
   ASSERT(from);
   ASSERT(to);
-  
-  while ((*to = *from) != 0) {
-    to++;
-    from++;
+
+  len = strlen(from);
+  memcpy(to, from, len + 1);
+  return to + len;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Copy at most len characters, zero pad up to len
+ *
+ * @param to    Destination, at least len bytes
+ * @param from  Source string
+ * @param len   Number of bytes to write
+ *
+ * @return Pointer to first padding zero in to, or to + len if none
+ */
+char * stpncpy(char * __restrict to, const char * __restrict from, size_t len)
+{
+  size_t n;
+
+  ASSERT(from);
+  ASSERT(to || !len);
+
+  n = strnlen(from, len);
+  memcpy(to, from, n);
+  memset(to + n, 0, len - n);
+  return to + n;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Copy string into bounded buffer, always zero terminate if size > 0
+ *
+ * @param to    Destination
+ * @param from  Source string
+ * @param size  Size of destination buffer
+ *
+ * @return Length of from, truncated if >= size
+ */
+size_t strlcpy(char * __restrict to, const char * __restrict from, size_t size)
+{
+  size_t len;
+
+  ASSERT(from);
+  ASSERT(to || !size);
+
+  len = strlen(from);
+  if (size) {
+    size_t n = (len < size) ? len : (size - 1);
+    memcpy(to, from, n);
+    to[n] = '\0';
+  }
+  return len;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Append string to bounded buffer, always zero terminate if room
+ *
+ * @param to    Destination holding a string
+ * @param from  Source string
+ * @param size  Size of destination buffer
+ *
+ * @return Length of the string tried to create, truncated if >= size
+ */
+size_t strlcat(char * __restrict to, const char * __restrict from, size_t size)
+{
+  size_t dlen;
+
+  ASSERT(from);
+  ASSERT(to || !size);
+
+  dlen = strnlen(to, size);
+  if (dlen == size) {
+    return size + strlen(from);
   }
-  return save;
+  return dlen + strlcpy(to + dlen, from, size - dlen);
 }
 
 //----------------------------------------------------------------------
+/**
+ * Check if n characters are left before the end of a bounded string
+ *
+ * @param cp   Current position
+ * @param end  End of string, NULL if zero terminated
+ * @param n    Number of characters needed
+ *
+ * @return Non-zero if the characters may be read
+ */
+static inline int __avail(const char *cp, const char *end, size_t n)
+{
+  return !end || ((size_t)(end - cp) >= n);
+}
+
 /**
  * Parse prefix for base
  *
  * @param cp   String to parse
+ * @param end  End of string, NULL if zero terminated
  * @param base Numeric base, also out parameter
  *
  * @return Parsed string without prefix
  */
-static const char * __parse_base_prefix(const char *cp, unsigned int *base)
+static const char * __parse_base_prefix(const char *cp, const char *end, unsigned int *base)
 {
   ASSERT(base);
   ASSERT(cp);
@@ -224,11 +830,12 @@ static const char * __parse_base_prefix(const char *cp, unsigned int *base)
   // if no base set
   if (*base == 0) {
     // check octal
-    if (*cp == '0') {
+    if (__avail(cp, end, 1) && (*cp == '0')) {
       // skip leading zero prefix for octal/hex
       cp++;
       // check prefix and first digit hex
-      if ((tolower((unsigned char) *cp) == 'x') && isxdigit((unsigned char) cp[1])) {
+      if (__avail(cp, end, 2) &&
+          (__ascii_tolower(*cp) == 'x') && __ascii_isxdigit(cp[1])) {
         // skip hex prefix
         cp++;
         // hex
@@ -244,65 +851,213 @@ static const char * __parse_base_prefix(const char *cp, unsigned int *base)
       *base = 10;
     }
   }
-  else if (*base == 16) {
-    // check for leading hex prefix
-    if (cp[0] == '0' && tolower((unsigned char) cp[1]) == 'x') {
-      // skip hex prefix
-      cp += 2;
-    }
+  else if (*base == 16) {
+    // check for leading hex prefix
+    if (__avail(cp, end, 2) && cp[0] == '0' && __ascii_tolower(cp[1]) == 'x') {
+      // skip hex prefix
+      cp += 2;
+    }
+  }
+  return cp;
+}
+
+/**
+ * Get value of a digit character
+ *
+ * @param c  Character
+ *
+ * @return Value 0 to 15, larger than any supported base if not a digit
+ */
+static inline unsigned int __digit_value(char c)
+{
+  return __ascii_xvalue(c);
+}
+
+/**
+ * Convert digits after the base prefix
+ *
+ * @param cp        Start of digits
+ * @param end       End of string, NULL if zero terminated
+ * @param base      Number base
+ * @param val       Out parameter, converted value modulo 2^64
+ * @param overflow  Out parameter, set if the value did not fit
+ *
+ * @return End of digits
+ */
+static const char * __parse_digits(const char *cp, const char *end, unsigned int base,
+                                   unsigned long long *val, int *overflow)
+{
+  unsigned long long ret = 0;
+  int ovf = 0;
+
+#if SWAR_ENABLED
+  if ((base == 10) || (base == 16) || (base == 8)) {
+    unsigned int shift = (base == 16) ? 4 : 3;
+
+    // whole words, the scalar loop below only finishes at a page end
+    // or, for bounded strings, the last few characters
+    while (end ? __avail(cp, end, SWAR_BYTES) : __swar_load_ok(cp)) {
+      uint64_t d;
+      unsigned int k = __swar_digits(__swar_load_le(cp), base, &d);
+
+      if (base == 10) {
+        ovf |= __builtin_mul_overflow(ret, __swar_scale10[k], &ret);
+        ovf |= __builtin_add_overflow(ret, d, &ret);
+      }
+      else if (k) {
+        ovf |= (ret >> (64 - (k * shift))) != 0;
+        ret = (ret << (k * shift)) | d;
+      }
+      cp += k;
+      if (k < SWAR_BYTES) {
+        *val = ret;
+        *overflow = ovf;
+        return cp;
+      }
+    }
+  }
+#endif
+
+  while (__avail(cp, end, 1)) {
+    unsigned int d = __digit_value(*cp);
+
+    // check if valid
+    if (d >= base) {
+      break;
+    }
+    if (ret > (ULLONG_MAX - d) / base) {
+      ovf = 1;
+    }
+    ret = (ret * base) + d;
+    cp++;
+  }
+
+  *val = ret;
+  *overflow = ovf;
+  return cp;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert string to unsigned long long type
+ *
+ * @param cp    Start of string
+ * @param endp  Pointer set to the end of parsed string
+ * @param base  Number base to use
+ *
+ * @return Converted unsigned long long
+ */
+unsigned long long strtoull(const char *cp, char **endp, unsigned int base)
+{
+  unsigned long long ret;
+  int overflow;
+
+  cp = __parse_base_prefix(cp, NULL, &base);
+  cp = __parse_digits(cp, NULL, base, &ret, &overflow);
+
+  // set end pointer
+  if (endp) {
+    *endp = (char *) cp;
+  }
+
+  return ret;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert length-bounded string to unsigned long long type, never
+ * reading at or past end. Out of range values saturate to ULLONG_MAX.
+ *
+ * @param s     Start of string
+ * @param end   End of string, NULL if zero terminated
+ * @param base  Number base to use, 0 for prefix detection
+ * @param res   Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Converted unsigned long long
+ */
+unsigned long long strntoull(const char *s, const char *end, unsigned int base, ms_parse_result *res)
+{
+  unsigned long long ret;
+  const char *cp;
+  int overflow;
+
+  ASSERT(s);
+  ASSERT(!end || (end >= s));
+
+  cp = __parse_base_prefix(s, end, &base);
+  cp = __parse_digits(cp, end, base, &ret, &overflow);
+  if (overflow) {
+    ret = ULLONG_MAX;
+  }
+
+  if (res) {
+    res->len      = (size_t)(cp - s);
+    res->overflow = overflow;
   }
-  return cp;
+  return ret;
 }
 
 //----------------------------------------------------------------------
 /**
- * Convert string to unsigned long long type
+ * Convert length-bounded string with optional sign to long long type,
+ * never reading at or past end. Out of range values saturate to
+ * LLONG_MIN or LLONG_MAX.
  *
- * @param cp    Start of string
- * @param endp  Pointer set to the end of parsed string
- * @param base  Number base to use
+ * @param s     Start of string
+ * @param end   End of string, NULL if zero terminated
+ * @param base  Number base to use, 0 for prefix detection
+ * @param res   Out parameter, consumed length and overflow, may be NULL
  *
- * @return Converted unsigned long long
+ * @return Converted long long
  */
-unsigned long long strtoull(const char *cp, char **endp, unsigned int base)
+long long strntoll(const char *s, const char *end, unsigned int base, ms_parse_result *res)
 {
-  unsigned long long ret = 0;
-  char c;
+  unsigned long long mag;
+  ms_parse_result r;
+  const char *cp = s;
+  int negative = 0;
+  long long ret;
 
-  cp = __parse_base_prefix(cp, &base);
+  ASSERT(s);
+  ASSERT(!end || (end >= s));
 
-  do {
-    unsigned int val;
+  if (__avail(cp, end, 1) && ((*cp == '-') || (*cp == '+'))) {
+    negative = (*cp == '-');
+    cp++;
+  }
 
-    c = *cp;
+  mag = strntoull(cp, end, base, &r);
+  if (r.len == 0) {
+    // a sign alone is no number
+    cp = s;
+  }
+  else {
+    cp += r.len;
+  }
 
-    // if hex/dec digit
-    if (isdigit((unsigned char) c)) {
-      val = c - '0';
-    }
-    else if (isxdigit((unsigned char) c)) {
-      val = tolower((unsigned char) c) - 'a' + 10;
+  if (negative) {
+    if (r.overflow || (mag > (unsigned long long) LLONG_MAX + 1)) {
+      r.overflow = 1;
+      ret = LLONG_MIN;
     }
     else {
-      val = -1;
+      ret = (long long)(0 - mag);
     }
-
-    // check if valid
-    if (val < base) {
-      ret = (ret * base) + val;
-      cp++;
+  }
+  else {
+    if (r.overflow || (mag > LLONG_MAX)) {
+      r.overflow = 1;
+      ret = LLONG_MAX;
     }
     else {
-      // invalid, exit
-      c = 0;
-    }         
-  } while ( c );
-  
-  // set end pointer
-  if (endp) {
-    *endp = (char *) cp;
+      ret = (long long) mag;
+    }
   }
 
+  if (res) {
+    res->len      = (size_t)(cp - s);
+    res->overflow = r.overflow;
+  }
   return ret;
 }
 
@@ -371,6 +1126,203 @@ long strtol(const char *cp, char **endp, unsigned int base)
   }
 }
 
+#if MS_HAVE_INT128
+//----------------------------------------------------------------------
+/**
+ * Convert digits after the base prefix to 128-bit value. Digits are
+ * gathered into 64-bit chunks, so the 128-bit multiply is done once per
+ * up to 19 decimal digits instead of once per digit.
+ *
+ * @param cp        Start of digits
+ * @param end       End of string, NULL if zero terminated
+ * @param base      Number base
+ * @param val       Out parameter, converted value modulo 2^128
+ * @param overflow  Out parameter, set if the value did not fit
+ *
+ * @return End of digits
+ */
+static const char * __parse_digits128(const char *cp, const char *end, unsigned int base,
+                                      ms_u128 *val, int *overflow)
+{
+  const uint64_t limit = UINT64_MAX / base;
+  ms_u128 ret = 0;
+  int ovf = 0;
+
+  for (;;) {
+    uint64_t chunk = 0;
+    uint64_t scale = 1;
+
+    // chunk < scale <= limit, so chunk * base + digit fits
+    while (__avail(cp, end, 1) && (scale <= limit)) {
+      unsigned int d = __digit_value(*cp);
+
+      if (d >= base) {
+        break;
+      }
+      chunk = (chunk * base) + d;
+      scale *= base;
+      cp++;
+    }
+    if (scale == 1) {
+      break;
+    }
+    ovf |= __builtin_mul_overflow(ret, scale, &ret);
+    ovf |= __builtin_add_overflow(ret, chunk, &ret);
+    if (scale <= limit) {
+      // chunk ended at a non-digit
+      break;
+    }
+  }
+
+  *val = ret;
+  *overflow = ovf;
+  return cp;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert length-bounded string to unsigned 128-bit value, never
+ * reading at or past end. Out of range values saturate to MS_U128_MAX.
+ *
+ * @param s     Start of string
+ * @param end   End of string, NULL if zero terminated
+ * @param base  Number base to use, 0 for prefix detection
+ * @param res   Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Converted value
+ */
+ms_u128 strntou128(const char *s, const char *end, unsigned int base, ms_parse_result *res)
+{
+  const char *cp;
+  ms_u128 ret;
+  int overflow;
+
+  ASSERT(s);
+  ASSERT(!end || (end >= s));
+
+  cp = __parse_base_prefix(s, end, &base);
+  cp = __parse_digits128(cp, end, base, &ret, &overflow);
+  if (overflow) {
+    ret = MS_U128_MAX;
+  }
+
+  if (res) {
+    res->len      = (size_t)(cp - s);
+    res->overflow = overflow;
+  }
+  return ret;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert length-bounded string with optional sign to signed 128-bit
+ * value, never reading at or past end. Out of range values saturate to
+ * MS_I128_MIN or MS_I128_MAX.
+ *
+ * @param s     Start of string
+ * @param end   End of string, NULL if zero terminated
+ * @param base  Number base to use, 0 for prefix detection
+ * @param res   Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Converted value
+ */
+ms_i128 strntoi128(const char *s, const char *end, unsigned int base, ms_parse_result *res)
+{
+  const char *cp = s;
+  int negative = 0;
+  ms_parse_result r;
+  ms_u128 mag;
+  ms_i128 ret;
+
+  ASSERT(s);
+  ASSERT(!end || (end >= s));
+
+  if (__avail(cp, end, 1) && ((*cp == '-') || (*cp == '+'))) {
+    negative = (*cp == '-');
+    cp++;
+  }
+
+  mag = strntou128(cp, end, base, &r);
+  if (r.len == 0) {
+    // a sign alone is no number
+    cp = s;
+  }
+  else {
+    cp += r.len;
+  }
+
+  if (negative) {
+    if (r.overflow || (mag > (ms_u128) MS_I128_MAX + 1)) {
+      r.overflow = 1;
+      ret = MS_I128_MIN;
+    }
+    else {
+      ret = (ms_i128)(0 - mag);
+    }
+  }
+  else {
+    if (r.overflow || (mag > (ms_u128) MS_I128_MAX)) {
+      r.overflow = 1;
+      ret = MS_I128_MAX;
+    }
+    else {
+      ret = (ms_i128) mag;
+    }
+  }
+
+  if (res) {
+    res->len      = (size_t)(cp - s);
+    res->overflow = r.overflow;
+  }
+  return ret;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert string to unsigned 128-bit value, saturating to MS_U128_MAX
+ *
+ * @param cp    Start of string
+ * @param endp  Pointer set to the end of parsed string
+ * @param base  Number base to use
+ *
+ * @return Converted value
+ */
+ms_u128 strtou128(const char *cp, char **endp, unsigned int base)
+{
+  ms_parse_result res;
+  ms_u128 ret = strntou128(cp, NULL, base, &res);
+
+  // set end pointer
+  if (endp) {
+    *endp = (char *) cp + res.len;
+  }
+  return ret;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert string to signed 128-bit value, saturating to MS_I128_MIN or
+ * MS_I128_MAX
+ *
+ * @param cp    Start of string
+ * @param endp  Pointer set to the end of parsed string
+ * @param base  Number base to use
+ *
+ * @return Converted value
+ */
+ms_i128 strtoi128(const char *cp, char **endp, unsigned int base)
+{
+  ms_parse_result res;
+  ms_i128 ret = strntoi128(cp, NULL, base, &res);
+
+  // set end pointer
+  if (endp) {
+    *endp = (char *) cp + res.len;
+  }
+  return ret;
+}
+#endif
+
 //----------------------------------------------------------------------
 /**
  * Convert string to integer and move pointer forward
@@ -388,7 +1340,7 @@ int atoi(const char **s)
   
   do {
     c = **s;
-    if ( isdigit((unsigned char) c) ) {
+    if ( __ascii_isdigit(c) ) {
       i = (i * 10) + (c - '0');
       (*s)++;
     }
@@ -401,33 +1353,156 @@ int atoi(const char **s)
 }
 
 //----------------------------------------------------------------------
-int strncasecmp(const char *s1, const char *s2, size_t n)
+// ASCII class flags of every byte value, locale independent, see ascii.h
+const uint8_t __ms_ascii_class[256] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+  0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+// value of every hex digit, 0xFF for all other bytes
+const uint8_t __ms_ascii_xvalue[256] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+//----------------------------------------------------------------------
+int __ms_strncasecmp_generic(const char *s1, const char *s2, size_t n)
 {
-  if (n == 0) {
-    return 0;
-  }
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
 
-  ASSERT(s1);
-  ASSERT(s2);
-  
-  while ((n-- != 0) &&
-         (tolower(*s1) == tolower(*s2))) {
-    if ((n == 0)      ||
-        (*s1 == '\0') ||
-        (*s2 == '\0')) {
-      break;
+  for (; n; n--, a++, b++) {
+    int d = __ascii_tolower(*a) - __ascii_tolower(*b);
+    if (d || !*a) {
+      return d;
     }
-    s1++;
-    s2++;
   }
+  return 0;
+}
+
+int strncasecmp(const char *s1, const char *s2, size_t n)
+{
+  ASSERT(s1 || !n);
+  ASSERT(s2 || !n);
 
-  return tolower(*(unsigned char *) s1) - tolower(*(unsigned char *) s2);
+  return __ms_string_ops.strncasecmp(s1, s2, n);
 }
 
 //----------------------------------------------------------------------
 int strcasecmp(const char *s1, const char *s2)
 {
-  return strncasecmp(s1, s2, INT_MAX);
+  return strncasecmp(s1, s2, SIZE_MAX);
+}
+
+//----------------------------------------------------------------------
+int __ms_memcasecmp_generic(const void *s1, const void *s2, size_t len)
+{
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
+
+  for (; len; len--, a++, b++) {
+    int d = __ascii_tolower(*a) - __ascii_tolower(*b);
+    if (d) {
+      return d;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Compare memory ignoring ASCII case
+ *
+ * @param s1   First area
+ * @param s2   Second area
+ * @param len  Number of bytes to compare, zero bytes are ordinary bytes
+ *
+ * @return <0, 0 or >0 as the first differing lower cased byte compares
+ */
+int memcasecmp(const void *s1, const void *s2, size_t len)
+{
+  ASSERT(s1 || !len);
+  ASSERT(s2 || !len);
+
+  return __ms_string_ops.memcasecmp(s1, s2, len);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Find needle in haystack ignoring ASCII case, both of known length
+ *
+ * Candidates must match the first and last needle byte before the
+ * rest is compared.
+ *
+ * @param hay     Haystack
+ * @param hlen    Haystack length, at least nlen
+ * @param needle  Needle
+ * @param nlen    Needle length, at least 1
+ *
+ * @return First match, NULL if not found
+ */
+void * __ms_memcasemem_generic(const void *hay, size_t hlen, const void *needle, size_t nlen)
+{
+  const unsigned char *h     = (const unsigned char *) hay;
+  const unsigned char *n     = (const unsigned char *) needle;
+  const unsigned char *last  = h + hlen - nlen;
+  const unsigned char first  = __ascii_tolower(n[0]);
+  const unsigned char final  = __ascii_tolower(n[nlen - 1]);
+
+  for (; h <= last; h++) {
+    if ((__ascii_tolower(h[0]) == first) &&
+        (__ascii_tolower(h[nlen - 1]) == final) &&
+        !__ms_memcasecmp_generic(h, n, nlen)) {
+      return (void *) h;
+    }
+  }
+  return NULL;
+}
+
+char * strcasestr(const char *in, const char *s)
+{
+  size_t hlen;
+  size_t nlen;
+
+  ASSERT(in);
+  ASSERT(s);
+
+  nlen = strlen(s);
+  if (nlen == 0) {
+    return (char *) in;
+  }
+  hlen = strlen(in);
+  if (nlen > hlen) {
+    return NULL;
+  }
+  return (char *) __ms_string_ops.memcasemem(in, hlen, s, nlen);
 }
 
 //----------------------------------------------------------------------
@@ -460,184 +1535,429 @@ char * strtok(char *s1, const char *delimit)
     last_token = NULL;
   }
 
-  return s1;
+  return s1;
+}
+
+//----------------------------------------------------------------------
+char *strtok_r(char *s, const char *delim, char **last)
+{
+  char *tok;
+
+  ASSERT(delim);
+  ASSERT(last);
+
+  if ((s == NULL) && ((s = *last) == NULL)) {
+    return NULL;
+  }
+
+  // Skip (span) leading delimiters.
+  s += strspn(s, delim);
+
+  // no non-delimiter characters
+  if (*s == '\0') {
+    *last = NULL;
+    return NULL;
+  }
+  tok = s;
+
+  // Scan token, split at the delimiter found if any.
+  s += strcspn(s, delim);
+  if (*s) {
+    *s++ = '\0';
+    *last = s;
+  }
+  else {
+    *last = NULL;
+  }
+  return tok;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Get character at a position of a bounded string
+ *
+ * @param p    Position
+ * @param end  End of string, NULL if zero terminated
+ *
+ * @return Character, zero at the end
+ */
+static inline char __peek(const char *p, const char *end)
+{
+  return __avail(p, end, 1) ? *p : '\0';
+}
+
+/**
+ * Match a word, ignoring case
+ *
+ * @param p     Position
+ * @param end   End of string, NULL if zero terminated
+ * @param word  Lower case word
+ *
+ * @return Length of word if it matches, 0 if not
+ */
+static size_t __match_word(const char *p, const char *end, const char *word)
+{
+  size_t i;
+
+  for (i = 0; word[i]; i++) {
+    if (__ascii_tolower(__peek(p + i, end)) != word[i]) {
+      return 0;
+    }
+  }
+  return i;
+}
+
+/**
+ * Scan digits of a decimal mantissa into a scanned number
+ *
+ * @param p     First digit
+ * @param end   End of string, NULL if zero terminated
+ * @param d     Scanned number, w and truncated are updated
+ * @param nsig  Digits in w, also out parameter
+ * @param q     Decimal exponent of w, also out parameter
+ * @param frac  Digits are after the decimal point
+ *
+ * @return End of digits
+ */
+static const char * __scan_mantissa(const char *p, const char *end, struct __ms_decimal *d,
+                                    unsigned int *nsig, int64_t *q, int frac)
+{
+  const char *start;
+  char c;
+
+  while (*nsig < 19) {
+#if SWAR_ENABLED
+    // eight digits at once while they all fit in w
+    if (end ? __avail(p, end, SWAR_BYTES) : __swar_load_ok(p)) {
+      uint64_t val;
+      unsigned int k = __swar_digits(__swar_load_le(p), 10, &val);
+
+      if (k == 0) {
+        return p;
+      }
+      if (*nsig + k <= 19) {
+        d->w   = (d->w * __swar_scale10[k]) + val;
+        *nsig += k;
+        *q    -= frac ? k : 0;
+        p     += k;
+        if (k < SWAR_BYTES) {
+          return p;
+        }
+        continue;
+      }
+    }
+#endif
+
+    c = __peek(p, end);
+    if (!__ascii_isdigit(c)) {
+      return p;
+    }
+    d->w = (d->w * 10) + (unsigned int)(c - '0');
+    (*nsig)++;
+    *q -= frac;
+    p++;
+  }
+
+  // w is full, the rest are dropped and only their count and whether
+  // any is nonzero matter
+  for (start = p; __ascii_isdigit(c = __peek(p, end)); p++) {
+    d->truncated |= (c != '0');
+  }
+  *q += frac ? 0 : (int64_t)(p - start);
+  return p;
 }
 
-//----------------------------------------------------------------------
-char *strtok_r(char *s, const char *delim, char **last)
+/**
+ * Scan a hexadecimal floating-point number after its 0x prefix
+ *
+ * @param p    First character after the prefix
+ * @param end  End of string, NULL if zero terminated
+ * @param d    Out parameter, scanned number
+ *
+ * @return End of the number, p if there are no digits
+ */
+static const char * __scan_hex(const char *p, const char *end, struct __ms_decimal *d)
 {
-  char *spanp;
-  int c, sc;
-  char *tok;
-  
-  if ((s == NULL) && ((s = *last) == NULL)) {
-    return NULL;
-  }
-  
-  // Skip (span) leading delimiters (s += strspn(s, delim), sort of).
-cont:
-  c = *s++;
-  for (spanp = (char *)delim; (sc = *spanp++) != 0; ) {
-    if (c == sc) {
-      goto cont;
+  const char *start = p;
+  unsigned int nsig = 0;
+  int64_t q = 0;
+  int frac = 0;
+  int any = 0;
+  char c;
+
+  d->kind = MS_DEC_HEX;
+  d->text = p;
+  for (;; p++) {
+    unsigned int v;
+
+    c = __peek(p, end);
+    if ((c == '.') && !frac) {
+      frac = 1;
+      continue;
+    }
+    v = __digit_value(c);
+    if (v >= 16) {
+      break;
+    }
+    any = 1;
+    if ((nsig == 0) && (v == 0)) {
+      // leading zero
+      q -= frac ? 4 : 0;
+    }
+    else if (nsig < 16) {
+      d->w = (d->w << 4) | v;
+      nsig++;
+      q -= frac ? 4 : 0;
+    }
+    else {
+      q += frac ? 0 : 4;
+      d->truncated |= (v != 0);
     }
   }
-
-  // no non-delimiter characters
-  if (c == 0) {
-    *last = NULL;
-    return NULL;
+  if (!any) {
+    return start;
   }
-  tok = (s - 1);
-
-  // Scan token (scan for delimiters: s += strcspn(s, delim), sort of).
-  // Note that delim must have one NULL.
-  for (;;) {
-    c = *s++;
-    spanp = (char *)delim;
-    do {
-      if ((sc = *spanp++) == c) {
-        if (c == 0) {
-          s = NULL;
-        }
-        else {
-          char *w = s - 1;
-          *w = '\0';
+  d->text_end = p;
+
+  // binary exponent, taken only with at least one digit
+  if (__ascii_tolower(__peek(p, end)) == 'p') {
+    const char *e = p + 1;
+    int64_t x = 0;
+    int negative = 0;
+
+    c = __peek(e, end);
+    if ((c == '-') || (c == '+')) {
+      negative = (c == '-');
+      e++;
+    }
+    if (__ascii_isdigit(__peek(e, end))) {
+      while (__ascii_isdigit(c = __peek(e, end))) {
+        if (x < 1000000) {
+          x = (x * 10) + (c - '0');
         }
-        *last = s;
-        return tok;
+        e++;
       }
+      d->exp10 = negative ? -x : x;
+      p = e;
     }
-    while (sc != 0);
   }
-  // NOT REACHABLE.
+
+  d->q = q + d->exp10;
+  return p;
 }
 
-//----------------------------------------------------------------------
-double strtod(const char *s, char **endptr)
+/**
+ * Scan a decimal floating-point number, infinity or NaN
+ *
+ * @param s    Start of string, leading white space is skipped
+ * @param end  End of string, NULL if zero terminated
+ * @param d    Out parameter, scanned number
+ *
+ * @return End of the number, s if there is none
+ */
+static const char * __scan_decimal(const char *s, const char *end, struct __ms_decimal *d)
 {
-  double number;
-  int exponent;
-  int negative;
-  char *p = (char *) s;
-  double p10;
-  int n;
-  int num_digits;
-  int num_decimals;
+  const char *p = s;
+  unsigned int nsig = 0;
+  int64_t q = 0;
+  size_t n;
+  char c;
+
+  ASSERT(s);
+
+  d->w         = 0;
+  d->q         = 0;
+  d->truncated = 0;
+  d->neg       = 0;
+  d->kind      = MS_DEC_FINITE;
+  d->exp10     = 0;
 
-  ASSERT(p);
-  
   // Skip leading whitespace
-  while (isspace(*p)) {
+  while (__ascii_isspace(__peek(p, end))) {
     p++;
   }
 
   // Handle optional sign
-  negative = 0;
-  switch (*p) {
-    case '-': negative = 1; // Fall through to increment position
-    case '+': p++;
-  }
-
-  number       = 0.;
-  exponent     = 0;
-  num_digits   = 0;
-  num_decimals = 0;
-
-  // Process string of digits
-  while (isdigit(*p)) {
-    number = number * 10. + (*p - '0');
+  c = __peek(p, end);
+  if ((c == '-') || (c == '+')) {
+    d->neg = (c == '-');
     p++;
-    num_digits++;
   }
 
-  // Process decimal part
-  if (*p == '.') {
-    p++;
+  // infinity, NaN with an optional (n-char-sequence)
+  c = (char) __ascii_tolower(__peek(p, end));
+  if ((c == 'i') && ((n = __match_word(p, end, "inf")) != 0)) {
+    d->kind = MS_DEC_INF;
+    n = __match_word(p, end, "infinity");
+    return p + (n ? n : 3);
+  }
+  if ((c == 'n') && ((n = __match_word(p, end, "nan")) != 0)) {
+    const char *e = p + n;
 
-    while (isdigit(*p)) {
-      number = number * 10. + (*p - '0');
-      p++;
-      num_digits++;
-      num_decimals++;
+    d->kind = MS_DEC_NAN;
+    if (__peek(e, end) == '(') {
+      for (e++; __ascii_isalnum(__peek(e, end)) || (__peek(e, end) == '_'); e++) {
+      }
+      if (__peek(e, end) == ')') {
+        return e + 1;
+      }
     }
-
-    exponent -= num_decimals;
+    return p + n;
   }
 
-  if (num_digits == 0) {
-    return 0.0;
-  }
+  // hexadecimal, a 0x without digits is the number 0
+  if ((__peek(p, end) == '0') && (__ascii_tolower(__peek(p + 1, end)) == 'x')) {
+    const char *e = __scan_hex(p + 2, end, d);
 
-  // Correct for sign
-  if (negative) {
-    number = -number;
+    if (e != p + 2) {
+      return e;
+    }
+    d->kind = MS_DEC_FINITE;
   }
 
-  // Process an exponent string
-  if ((*p == 'e') || (*p == 'E')) {
-    // Handle optional sign
-    negative = 0;
-    switch (*++p) {
-      case '-': negative = 1;   // Fall through to increment pos
-      case '+': p++;
-    }
+  // Process string of digits, leading zeros are not significant
+  d->text = p;
+  while (__peek(p, end) == '0') {
+    p++;
+  }
+  p = __scan_mantissa(p, end, d, &nsig, &q, 0);
 
-    // Process string of digits
-    n = 0;
-    while (isdigit(*p)) {
-      n = n * 10 + (*p - '0');
-      p++;
+  // Process decimal part
+  if (__peek(p, end) == '.') {
+    p++;
+    if (nsig == 0) {
+      while (__peek(p, end) == '0') {
+        p++;
+        q--;
+      }
     }
+    p = __scan_mantissa(p, end, d, &nsig, &q, 1);
+  }
 
-    if (negative) {
-      exponent -= n;
+  // no digit at all, a lone point is no number
+  if ((p == d->text) || ((p == d->text + 1) && (*d->text == '.'))) {
+    return s;
+  }
+  d->text_end = p;
+
+  // Process an exponent string, taken only with at least one digit
+  if (__ascii_tolower(__peek(p, end)) == 'e') {
+    const char *e = p + 1;
+    int64_t x = 0;
+    int negative = 0;
+
+    c = __peek(e, end);
+    if ((c == '-') || (c == '+')) {
+      negative = (c == '-');
+      e++;
     }
-    else {
-      exponent += n;
+    if (__ascii_isdigit(__peek(e, end))) {
+      while (__ascii_isdigit(c = __peek(e, end))) {
+        // far outside every format already, stop growing
+        if (x < 1000000) {
+          x = (x * 10) + (c - '0');
+        }
+        e++;
+      }
+      d->exp10 = negative ? -x : x;
+      p = e;
     }
   }
 
-  if ((exponent < DBL_MIN_EXP)  || (exponent > DBL_MAX_EXP)) {
-    return HUGE_VAL;
-  }
+  d->q = q + d->exp10;
+  return p;
+}
 
-  // Scale the result
-  p10 = 10.;
-  n = exponent;
-  if (n < 0) {
-    n = -n;
-  }
-  while (n) {
-    if (n & 1) {
-      if (exponent < 0) {
-        number /= p10;
-      }
-      else {
-        number *= p10;
-      }
-    }
-    n >>= 1;
-    p10 *= p10;
+//----------------------------------------------------------------------
+double strtod(const char *s, char **endptr)
+{
+  struct __ms_decimal d;
+  const char *p;
+  double number = 0.;
+  int range;
+
+  p = __scan_decimal(s, NULL, &d);
+  if (p != s) {
+    number = __ms_decimal_to_double(&d, &range);
   }
 
   if (endptr) {
-    *endptr = p;
+    *endptr = (char *) p;
+  }
+
+  return number;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert length-bounded string to double, never reading at or past end
+ *
+ * @param s     Start of string
+ * @param end   End of string, NULL if zero terminated
+ * @param res   Out parameter, consumed length and overflow, may be NULL
+ *
+ * @return Converted double, +-HUGE_VAL or +-0 when out of range
+ */
+double strntod(const char *s, const char *end, ms_parse_result *res)
+{
+  struct __ms_decimal d;
+  const char *p;
+  double number = 0.;
+  int range = 0;
+
+  ASSERT(s);
+  ASSERT(!end || (end >= s));
+
+  p = __scan_decimal(s, end, &d);
+  if (p != s) {
+    number = __ms_decimal_to_double(&d, &range);
   }
 
+  if (res) {
+    res->len      = (size_t)(p - s);
+    res->overflow = range;
+  }
   return number;
 }
 
 //----------------------------------------------------------------------
 float strtof(const char *s, char **endptr)
 {
-  return (float) strtod(s, endptr);
+  struct __ms_decimal d;
+  const char *p;
+  float number = 0.f;
+  int range;
+
+  p = __scan_decimal(s, NULL, &d);
+  if (p != s) {
+    number = __ms_decimal_to_float(&d, &range);
+  }
+
+  if (endptr) {
+    *endptr = (char *) p;
+  }
+
+  return number;
 }
 
 //----------------------------------------------------------------------
 long double strtold(const char *s, char **endptr)
 {
-  return strtod(s, endptr);
+  struct __ms_decimal d;
+  const char *p;
+  long double number = 0.L;
+  int range;
+
+  p = __scan_decimal(s, NULL, &d);
+  if (p != s) {
+    number = __ms_decimal_to_ldouble(&d, &range);
+  }
+
+  if (endptr) {
+    *endptr = (char *) p;
+  }
+
+  return number;
 }
 
 //----------------------------------------------------------------------
@@ -646,6 +1966,11 @@ double atof(const char *s)
   return strtod(s, NULL);
 }
 
+//----------------------------------------------------------------------
+// Character sets longer than this are compiled to an ms_charset by the
+// span functions, shorter ones are cheaper to compare against directly.
+#define CHARSET_MIN_CHARS (4)
+
 //----------------------------------------------------------------------
 /*
  * Span the string s2 (skip characters that are in s2).
@@ -657,7 +1982,13 @@ size_t strspn(const char *s1, register const char *s2)
 
   ASSERT(s1);
   ASSERT(s2);  
-  
+
+  if (strnlen(s2, CHARSET_MIN_CHARS + 1) > CHARSET_MIN_CHARS) {
+    ms_charset set;
+    ms_charset_init(&set, s2);
+    return strspn_set(s1, &set);
+  }
+
   // Skip any characters in s2, excluding the terminating \0.
 cont:
   c = *p++;
@@ -681,6 +2012,12 @@ size_t strcspn(const char *s1, register const char *s2)
   ASSERT(s1);
   ASSERT(s2);  
 
+  if (strnlen(s2, CHARSET_MIN_CHARS + 1) > CHARSET_MIN_CHARS) {
+    ms_charset set;
+    ms_charset_init(&set, s2);
+    return strcspn_set(s1, &set);
+  }
+
   // Stop when any character found from s2.
   // Note that s2 must be z-terminated.
   for (p = s1;;) {
@@ -706,7 +2043,13 @@ char *strpbrk(const char *s1, const char *s2)
   if (!*s1) {
     return (char *) NULL;
   }
-  
+
+  if (strnlen(s2, CHARSET_MIN_CHARS + 1) > CHARSET_MIN_CHARS) {
+    ms_charset set;
+    ms_charset_init(&set, s2);
+    return strpbrk_set(s1, &set);
+  }
+
   while (*s1) {
     for (c = s2; *c; c++) {
       if (*s1 == *c) {
@@ -725,3 +2068,254 @@ char *strpbrk(const char *s1, const char *s2)
   
   return (char *) s1;
 }
+
+//----------------------------------------------------------------------
+/**
+ * Build character set
+ *
+ * @param set    Set to initialize
+ * @param chars  Zero terminated string of member characters
+ */
+void ms_charset_init(ms_charset *set, const char *chars)
+{
+  size_t i;
+
+  ASSERT(set);
+  ASSERT(chars);
+
+  for (i = 0; i < sizeof(set->bits); i++) {
+    set->bits[i] = 0;
+  }
+  for (i = 0; i < sizeof(set->nib_lo); i++) {
+    set->nib_lo[i] = 0;
+    set->nib_hi[i] = 0;
+  }
+
+  for (; *chars; chars++) {
+    ms_charset_add(set, *chars);
+  }
+}
+
+//----------------------------------------------------------------------
+/**
+ * Add character to set, any byte value including zero
+ *
+ * @param set  Initialized set
+ * @param c    Character to add
+ */
+void ms_charset_add(ms_charset *set, int c)
+{
+  unsigned char u = (unsigned char) c;
+
+  ASSERT(set);
+
+  set->bits[u >> 3] |= (unsigned char)(1 << (u & 7));
+  // nibble tables, indexed by low nibble, one bit per high nibble
+  if (u < 0x80) {
+    set->nib_lo[u & 15] |= (unsigned char)(1 << (u >> 4));
+  }
+  else {
+    set->nib_hi[u & 15] |= (unsigned char)(1 << ((u >> 4) - 8));
+  }
+}
+
+//----------------------------------------------------------------------
+/**
+ * Span characters in or out of a set
+ *
+ * @param s       String to span
+ * @param set     Character set
+ * @param accept  1 to skip characters in set, 0 to skip characters not in set
+ *
+ * @return Number of characters spanned, never includes the terminator
+ */
+size_t __ms_span_set_generic(const char *s, const ms_charset *set, int accept)
+{
+  const unsigned char *p = (const unsigned char *) s;
+
+  if (accept) {
+    // the terminator is never a member
+    while (MS_CHARSET_HAS(set, *p)) {
+      p++;
+    }
+  }
+  else {
+    while (*p && !MS_CHARSET_HAS(set, *p)) {
+      p++;
+    }
+  }
+  return (size_t)((const char *) p - s);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Span characters in or out of a set, in a buffer of known length
+ *
+ * @param s       Buffer to span, zero bytes are ordinary characters
+ * @param n       Buffer length
+ * @param set     Character set
+ * @param accept  1 to skip characters in set, 0 to skip characters not in set
+ *
+ * @return Number of characters spanned, at most n
+ */
+size_t __ms_span_set_n_generic(const char *s, size_t n, const ms_charset *set, int accept)
+{
+  size_t i;
+
+  accept = (accept != 0);
+  for (i = 0; (i < n) && ((int) MS_CHARSET_HAS(set, s[i]) == accept); i++);
+  return i;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Mark set members in a buffer, one bit per byte
+ *
+ * @param s     Buffer, zero bytes are ordinary characters
+ * @param n     Buffer length
+ * @param set   Character set
+ * @param bits  Out parameter, (n + 63) / 64 words, bit i of word j is
+ *              set if byte 64 * j + i is a member, bits past n are zero
+ */
+void __ms_set_bitmap_generic(const char *s, size_t n, const ms_charset *set, uint64_t *bits)
+{
+  size_t i;
+
+  for (i = 0; i < n; i += 64) {
+    bits[i >> 6] = 0;
+  }
+  for (i = 0; i < n; i++) {
+    bits[i >> 6] |= (uint64_t) MS_CHARSET_HAS(set, s[i]) << (i & 63);
+  }
+}
+
+//----------------------------------------------------------------------
+size_t strspn_set(const char *s, const ms_charset *set)
+{
+  ASSERT(s);
+  ASSERT(set);
+
+  return __ms_string_ops.span_set(s, set, 1);
+}
+
+//----------------------------------------------------------------------
+size_t strcspn_set(const char *s, const ms_charset *set)
+{
+  ASSERT(s);
+  ASSERT(set);
+
+  return __ms_string_ops.span_set(s, set, 0);
+}
+
+//----------------------------------------------------------------------
+char *strpbrk_set(const char *s, const ms_charset *set)
+{
+  ASSERT(s);
+  ASSERT(set);
+
+  s += __ms_string_ops.span_set(s, set, 0);
+  return *s ? (char *) s : NULL;
+}
+
+//----------------------------------------------------------------------
+char *strtok_r_set(char *s, const ms_charset *set, char **last)
+{
+  char *tok;
+
+  ASSERT(set);
+  ASSERT(last);
+
+  if ((s == NULL) && ((s = *last) == NULL)) {
+    return NULL;
+  }
+
+  s += strspn_set(s, set);
+  if (*s == '\0') {
+    *last = NULL;
+    return NULL;
+  }
+  tok = s;
+
+  s += strcspn_set(s, set);
+  if (*s) {
+    *s++ = '\0';
+    *last = s;
+  }
+  else {
+    *last = NULL;
+  }
+  return tok;
+}
+
+//----------------------------------------------------------------------
+char *strtok_set(char *s, const ms_charset *set)
+{
+  static char *last_token = NULL; /* UNSAFE SHARED STATE! */
+
+  return strtok_r_set(s, set, &last_token);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Start tokenizing a buffer, the buffer is never written to
+ *
+ * @param tok    Tokenizer state, owned by caller
+ * @param buf    Buffer to tokenize, need not be zero terminated
+ * @param len    Buffer length
+ * @param delim  Delimiter set, must outlive the tokenizer
+ * @param flags  MS_TOK_KEEP_EMPTY to return empty fields between
+ *               adjacent delimiters (CSV/TSV), 0 to skip delimiter runs
+ */
+void ms_tokenizer_init(ms_tokenizer *tok, const char *buf, size_t len,
+                       const ms_charset *delim, int flags)
+{
+  ASSERT(tok);
+  ASSERT(buf || !len);
+  ASSERT(delim);
+
+  tok->pos   = buf;
+  tok->end   = buf + len;
+  tok->delim = delim;
+  tok->flags = flags;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Get next token
+ *
+ * @param tok  Tokenizer state
+ * @param out  Out parameter, view of the token inside the buffer
+ *
+ * @return 1 if a token was returned, 0 at end of buffer
+ */
+int ms_tokenizer_next(ms_tokenizer *tok, ms_token *out)
+{
+  const char *p;
+  size_t len;
+
+  ASSERT(tok);
+  ASSERT(out);
+
+  p = tok->pos;
+  if (p == NULL) {
+    return 0;
+  }
+
+  if (!(tok->flags & MS_TOK_KEEP_EMPTY)) {
+    // skip delimiter run, nothing but delimiters left ends it
+    p += __ms_string_ops.span_set_n(p, (size_t)(tok->end - p), tok->delim, 1);
+    if (p == tok->end) {
+      tok->pos = NULL;
+      return 0;
+    }
+  }
+
+  len = __ms_string_ops.span_set_n(p, (size_t)(tok->end - p), tok->delim, 0);
+  out->ptr = p;
+  out->len = len;
+
+  // step over the delimiter, when keeping empty fields one always follows
+  p += len;
+  tok->pos = (p < tok->end) ? (p + 1) : NULL;
+  return 1;
+}
@@ -2,8 +2,16 @@
 #define _STRING_H_
 
 #include <stdio.h>
+#include <charset.h>
+#include <int128.h>
 
 void * memchr(const void *src, int c, size_t len);
+void * memrchr(const void *src, int c, size_t len);
+void * memmem(const void *hay, size_t hlen, const void *needle, size_t nlen);
+void * memcpy(void * __restrict dst, const void * __restrict src, size_t len);
+void * memmove(void *dst, const void *src, size_t len);
+void * memset(void *dst, int c, size_t len);
+int memcmp(const void *s1, const void *s2, size_t len);
 
 int strcmp(const char *s1, const char *s2);
 int strncmp(const char *s1, const char *s2, size_t n);
@@ -11,11 +19,16 @@ size_t strlen(const char *s);
 size_t strnlen(const char *s, size_t max);
 char * strstr(const char *in, const char *s);
 char * strchr(char const *s, int c);
+char * strchrnul(const char *s, int c);
 char * strnchr(const char * s, size_t len, int c);
 char * strrchr(const char *s, int c);
 char * strcat(char *dest, const char *src);
 char * strncat(char *dest, const char *src, size_t len);
 char * strcpy(char * __restrict to, const char * __restrict from);
+char * stpcpy(char * __restrict to, const char * __restrict from);
+char * stpncpy(char * __restrict to, const char * __restrict from, size_t len);
+size_t strlcpy(char * __restrict to, const char * __restrict from, size_t size);
+size_t strlcat(char * __restrict to, const char * __restrict from, size_t size);
 
 unsigned long long strtoull(const char *cp, char **endp, unsigned int base);
 long long strtoll(const char *cp, char **endp, unsigned int base);
@@ -26,15 +39,69 @@ float strtof(const char *s, char **endptr);
 double strtod(const char *s, char **endptr);
 char * strtok(char *s1, const char *delimit);
 
+/**
+ * Result of a length-bounded numeric conversion.
+ *
+ * The strnto*() functions never read at or past end. A NULL end means
+ * the string is zero terminated, as for the strto*() functions.
+ */
+typedef struct ms_parse_result {
+  size_t len;              // characters consumed, 0 if no number was found
+  int overflow;            // value out of range, the result is saturated
+} ms_parse_result;
+
+unsigned long long strntoull(const char *s, const char *end, unsigned int base, ms_parse_result *res);
+long long strntoll(const char *s, const char *end, unsigned int base, ms_parse_result *res);
+double strntod(const char *s, const char *end, ms_parse_result *res);
+
+#if MS_HAVE_INT128
+ms_u128 strtou128(const char *cp, char **endp, unsigned int base);
+ms_i128 strtoi128(const char *cp, char **endp, unsigned int base);
+ms_u128 strntou128(const char *s, const char *end, unsigned int base, ms_parse_result *res);
+ms_i128 strntoi128(const char *s, const char *end, unsigned int base, ms_parse_result *res);
+#endif
+
 int atoi(const char **s);
 double atof(const char *s);
 
 int strncasecmp(const char *s1, const char *s2, size_t n);
 int strcasecmp(const char *s1, const char *s2);
+int memcasecmp(const void *s1, const void *s2, size_t len);
+char * strcasestr(const char *in, const char *s);
 
 size_t strspn(const char *s1, register const char *s2);
 size_t strcspn(const char *s1, register const char *s2);
 char *strpbrk(const char *s1, const char *s2);
 char *strtok_r(char *s, const char *delim, char **last);
 
+size_t strspn_set(const char *s, const ms_charset *set);
+size_t strcspn_set(const char *s, const ms_charset *set);
+char *strpbrk_set(const char *s, const ms_charset *set);
+char *strtok_set(char *s, const ms_charset *set);
+char *strtok_r_set(char *s, const ms_charset *set, char **last);
+
+/**
+ * View of a token inside the tokenized buffer, not zero terminated
+ */
+typedef struct ms_token {
+  const char *ptr;
+  size_t len;
+} ms_token;
+
+/**
+ * Tokenizer state, owned by the caller so tokenizing is reentrant
+ */
+typedef struct ms_tokenizer {
+  const char *pos;         // next byte to scan, NULL when done
+  const char *end;         // end of buffer
+  const ms_charset *delim; // delimiter set
+  int flags;               // MS_TOK_* flags
+} ms_tokenizer;
+
+#define MS_TOK_KEEP_EMPTY (1)
+
+void ms_tokenizer_init(ms_tokenizer *tok, const char *buf, size_t len,
+                       const ms_charset *delim, int flags);
+int ms_tokenizer_next(ms_tokenizer *tok, ms_token *out);
+
 #endif /* _STRING_H_ */
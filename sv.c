@@ -0,0 +1,254 @@
+/**
+ * String views, string.h style functions on length carrying slices.
+ */
+
+#include <stddef.h>
+#include <assert.h>
+
+#include <string.h>
+#include <sv.h>
+#include <dispatch.h>
+
+//#define ASSERT(cond)
+#define ASSERT(cond) assert(cond)
+
+//----------------------------------------------------------------------
+/**
+ * Make view of characters
+ *
+ * @param p  First character
+ * @param n  Number of characters
+ *
+ * @return View
+ */
+ms_sv ms_sv_make(const char *p, size_t n)
+{
+  ms_sv s;
+
+  ASSERT(p || !n);
+
+  s.p = p;
+  s.n = n;
+  return s;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Make view of zero terminated string, the only call measuring a string
+ *
+ * @param s  String
+ *
+ * @return View, without the terminator
+ */
+ms_sv ms_sv_cstr(const char *s)
+{
+  ASSERT(s);
+
+  return ms_sv_make(s, strlen(s));
+}
+
+//----------------------------------------------------------------------
+/**
+ * Make view of part of view, clamped to the view
+ *
+ * @param s    View
+ * @param pos  Start position
+ * @param len  Max length, MS_SV_NPOS for rest of view
+ *
+ * @return Sub view
+ */
+ms_sv ms_sv_sub(ms_sv s, size_t pos, size_t len)
+{
+  if (pos > s.n) {
+    pos = s.n;
+  }
+  if (len > s.n - pos) {
+    len = s.n - pos;
+  }
+  return ms_sv_make(s.p + pos, len);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Compare views, a view sorts before any longer view it is a prefix of
+ *
+ * @param a  First view
+ * @param b  Second view
+ *
+ * @return <0, 0 or >0
+ */
+int ms_sv_cmp(ms_sv a, ms_sv b)
+{
+  int d = memcmp(a.p, b.p, (a.n < b.n) ? a.n : b.n);
+
+  if (d) {
+    return d;
+  }
+  return (a.n > b.n) - (a.n < b.n);
+}
+
+//----------------------------------------------------------------------
+int ms_sv_casecmp(ms_sv a, ms_sv b)
+{
+  int d = memcasecmp(a.p, b.p, (a.n < b.n) ? a.n : b.n);
+
+  if (d) {
+    return d;
+  }
+  return (a.n > b.n) - (a.n < b.n);
+}
+
+//----------------------------------------------------------------------
+int ms_sv_eq(ms_sv a, ms_sv b)
+{
+  return (a.n == b.n) && !memcmp(a.p, b.p, a.n);
+}
+
+//----------------------------------------------------------------------
+int ms_sv_starts_with(ms_sv s, ms_sv prefix)
+{
+  return (prefix.n <= s.n) && !memcmp(s.p, prefix.p, prefix.n);
+}
+
+//----------------------------------------------------------------------
+int ms_sv_ends_with(ms_sv s, ms_sv suffix)
+{
+  return (suffix.n <= s.n) && !memcmp(s.p + s.n - suffix.n, suffix.p, suffix.n);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Find first occurrence of character
+ *
+ * @param s  View
+ * @param c  Character
+ *
+ * @return Position, MS_SV_NPOS if not found
+ */
+size_t ms_sv_chr(ms_sv s, int c)
+{
+  const char *r = (const char *) memchr(s.p, c, s.n);
+  return r ? (size_t)(r - s.p) : MS_SV_NPOS;
+}
+
+//----------------------------------------------------------------------
+size_t ms_sv_rchr(ms_sv s, int c)
+{
+  const char *r = (const char *) memrchr(s.p, c, s.n);
+  return r ? (size_t)(r - s.p) : MS_SV_NPOS;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Find first occurrence of view
+ *
+ * @param s       View to search
+ * @param needle  View to find
+ *
+ * @return Position, 0 for empty needle, MS_SV_NPOS if not found
+ */
+size_t ms_sv_find(ms_sv s, ms_sv needle)
+{
+  const char *r = (const char *) memmem(s.p, s.n, needle.p, needle.n);
+  return r ? (size_t)(r - s.p) : MS_SV_NPOS;
+}
+
+//----------------------------------------------------------------------
+size_t ms_sv_casefind(ms_sv s, ms_sv needle)
+{
+  const char *r;
+
+  if (needle.n == 0) {
+    return 0;
+  }
+  if (needle.n > s.n) {
+    return MS_SV_NPOS;
+  }
+  r = (const char *) __ms_string_ops.memcasemem(s.p, s.n, needle.p, needle.n);
+  return r ? (size_t)(r - s.p) : MS_SV_NPOS;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Span characters in set
+ *
+ * @param s    View
+ * @param set  Character set
+ *
+ * @return Length of leading part consisting of characters in set
+ */
+size_t ms_sv_spn(ms_sv s, const ms_charset *set)
+{
+  ASSERT(set);
+
+  return __ms_string_ops.span_set_n(s.p, s.n, set, 1);
+}
+
+//----------------------------------------------------------------------
+size_t ms_sv_cspn(ms_sv s, const ms_charset *set)
+{
+  ASSERT(set);
+
+  return __ms_string_ops.span_set_n(s.p, s.n, set, 0);
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert view to unsigned long long, like strntoull(). Out of range
+ * values saturate to ULLONG_MAX.
+ *
+ * @param s     View, conversion stops at its end
+ * @param val   Out parameter, converted value
+ * @param base  Number base, 0 to detect from 0/0x prefix
+ *
+ * @return Number of characters consumed, 0 if no digits
+ */
+size_t ms_sv_to_ull(ms_sv s, unsigned long long *val, unsigned int base)
+{
+  ms_parse_result res;
+
+  ASSERT(val);
+
+  *val = strntoull(s.p, s.p + s.n, base, &res);
+  return res.len;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert view with optional sign to long long, like strntoll(). Out
+ * of range values saturate to LLONG_MIN or LLONG_MAX.
+ *
+ * @param s     View, conversion stops at its end
+ * @param val   Out parameter, converted value
+ * @param base  Number base, 0 to detect from 0/0x prefix
+ *
+ * @return Number of characters consumed, 0 if no digits
+ */
+size_t ms_sv_to_ll(ms_sv s, long long *val, unsigned int base)
+{
+  ms_parse_result res;
+
+  ASSERT(val);
+
+  *val = strntoll(s.p, s.p + s.n, base, &res);
+  return res.len;
+}
+
+//----------------------------------------------------------------------
+/**
+ * Convert view to double, like strtod() but bounded
+ *
+ * @param s    View, conversion stops at its end
+ * @param val  Out parameter, converted value
+ *
+ * @return Number of characters consumed, 0 if no number
+ */
+size_t ms_sv_to_d(ms_sv s, double *val)
+{
+  ms_parse_result res;
+
+  ASSERT(val);
+
+  *val = strntod(s.p, s.p + s.n, &res);
+  return res.len;
+}
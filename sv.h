@@ -0,0 +1,44 @@
+#ifndef _SV_H_
+#define _SV_H_
+
+#include <stddef.h>
+
+#include <charset.h>
+
+/**
+ * String view, a length carrying slice of characters.
+ * Not zero terminated, the functions below never scan for a terminator.
+ */
+typedef struct ms_sv {
+  const char *p;
+  size_t n;
+} ms_sv;
+
+// Not found position
+#define MS_SV_NPOS ((size_t) -1)
+
+// View of a string literal
+#define MS_SV_LIT(s) ((ms_sv) { (s), sizeof(s) - 1 })
+
+ms_sv ms_sv_make(const char *p, size_t n);
+ms_sv ms_sv_cstr(const char *s);
+ms_sv ms_sv_sub(ms_sv s, size_t pos, size_t len);
+
+int ms_sv_cmp(ms_sv a, ms_sv b);
+int ms_sv_casecmp(ms_sv a, ms_sv b);
+int ms_sv_eq(ms_sv a, ms_sv b);
+int ms_sv_starts_with(ms_sv s, ms_sv prefix);
+int ms_sv_ends_with(ms_sv s, ms_sv suffix);
+
+size_t ms_sv_chr(ms_sv s, int c);
+size_t ms_sv_rchr(ms_sv s, int c);
+size_t ms_sv_find(ms_sv s, ms_sv needle);
+size_t ms_sv_casefind(ms_sv s, ms_sv needle);
+size_t ms_sv_spn(ms_sv s, const ms_charset *set);
+size_t ms_sv_cspn(ms_sv s, const ms_charset *set);
+
+size_t ms_sv_to_ull(ms_sv s, unsigned long long *val, unsigned int base);
+size_t ms_sv_to_ll(ms_sv s, long long *val, unsigned int base);
+size_t ms_sv_to_d(ms_sv s, double *val);
+
+#endif /* _SV_H_ */
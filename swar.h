@@ -0,0 +1,214 @@
+#ifndef _SWAR_H_
+#define _SWAR_H_
+
+/**
+ * Internal word-at-a-time (SWAR) helpers: eight bytes are handled in one
+ * 64-bit register with plain integer arithmetic.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+#define SWAR_ENABLED (1)
+typedef uint64_t __attribute__((__may_alias__)) swar_t;
+// unaligned word access, the compiler picks a safe load for the target
+typedef struct { uint64_t v; } __attribute__((__packed__, __may_alias__)) swar_u_t;
+#else
+#define SWAR_ENABLED (0)
+#endif
+
+#define SWAR_BYTES (sizeof(uint64_t))
+#define SWAR_ONES  (0x0101010101010101ULL)
+#define SWAR_LOW7  (0x7F7F7F7F7F7F7F7FULL)
+
+#if SWAR_ENABLED
+/**
+ * Mark zero bytes of a word
+ *
+ * @param x Word to test
+ *
+ * @return 0x80 in every byte that is zero in x, 0x00 in all others
+ */
+static inline uint64_t __swar_zero(uint64_t x)
+{
+  return ~(((x & SWAR_LOW7) + SWAR_LOW7) | x | SWAR_LOW7);
+}
+
+/**
+ * Mark bytes of a word that are searched for
+ *
+ * @param x         Word to test
+ * @param cc        Searched byte repeated in every byte lane
+ * @param want_c    Mark bytes equal to the searched byte
+ * @param want_nul  Mark zero bytes
+ *
+ * @return 0x80 in every matching byte, 0x00 in all others
+ */
+static inline uint64_t __swar_match(uint64_t x, uint64_t cc, int want_c, int want_nul)
+{
+  uint64_t m = 0;
+
+  if (want_c) {
+    m |= __swar_zero(x ^ cc);
+  }
+  if (want_nul) {
+    m |= __swar_zero(x);
+  }
+  return m;
+}
+
+/**
+ * Clear matches in the bytes preceding an unaligned start
+ *
+ * @param m    Match mask of the first aligned word
+ * @param off  Number of leading bytes to ignore
+ *
+ * @return Match mask without the leading bytes
+ */
+static inline uint64_t __swar_clear_head(uint64_t m, size_t off)
+{
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  return m & (~0ULL << (off * 8));
+#else
+  return m & (~0ULL >> (off * 8));
+#endif
+}
+
+/**
+ * Get index of first (lowest addressed) match in a word
+ *
+ * @param m  Non-zero match mask
+ *
+ * @return Byte index of first match
+ */
+static inline size_t __swar_first(uint64_t m)
+{
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  return __builtin_ctzll(m) >> 3;
+#else
+  return __builtin_clzll(m) >> 3;
+#endif
+}
+
+/**
+ * Get index of last (highest addressed) match in a word
+ *
+ * @param m  Non-zero match mask
+ *
+ * @return Byte index of last match
+ */
+static inline size_t __swar_last(uint64_t m)
+{
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  return (63 - __builtin_clzll(m)) >> 3;
+#else
+  return (63 - __builtin_ctzll(m)) >> 3;
+#endif
+}
+#endif /* SWAR_ENABLED */
+
+//----------------------------------------------------------------------
+// Eight digits at a time, used by the number conversions. A word is
+// loaded with the first character in the lowest byte, every byte is
+// checked and reduced to its digit value at once, and the digits are
+// combined pairwise in three multiplications. Loads stay within the page
+// of the first byte, so reading past the end of the number is safe.
+
+#if SWAR_ENABLED
+#define SWAR_PAGE_SIZE (4096)
+#define SWAR_HIGH      (0x8080808080808080ULL)
+
+// 10^k, scales a value by the k digits converted after it
+static const uint64_t __swar_scale10[SWAR_BYTES + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+};
+
+/**
+ * Check if a word can be read at a position without crossing a page
+ */
+static inline int __swar_load_ok(const char *p)
+{
+  return ((uintptr_t) p & (SWAR_PAGE_SIZE - 1)) <= (SWAR_PAGE_SIZE - SWAR_BYTES);
+}
+
+/**
+ * Load a word, the byte at p in the lowest 8 bits
+ */
+static inline uint64_t __swar_load_le(const char *p)
+{
+  uint64_t x = ((const swar_u_t *) p)->v;
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  return x;
+#else
+  return __builtin_bswap64(x);
+#endif
+}
+
+/**
+ * Mark bytes not below a limit, bytes must be below 0x80
+ *
+ * @return 0x80 in every byte >= lo, 0x00 in all others
+ */
+static inline uint64_t __swar_ge(uint64_t x, unsigned char lo)
+{
+  return ((x | SWAR_HIGH) - (SWAR_ONES * lo)) & SWAR_HIGH;
+}
+
+/**
+ * Convert the leading digits of a word
+ *
+ * @param x     Word, first character in the lowest byte
+ * @param base  Number base, 8, 10 or 16
+ * @param val   Out parameter, value of the leading digits
+ *
+ * @return Number of leading digits, 0 to 8
+ */
+static inline unsigned int __swar_digits(uint64_t x, unsigned int base, uint64_t *val)
+{
+  uint64_t bad;
+  uint64_t d;
+  unsigned int k;
+
+  if (base == 10) {
+    // '0'..'9' are the bytes with high nibble 3 that stay so when adding 6;
+    // a carry out of a non-digit only spoils the bytes after it
+    bad = ((x & 0xF0F0F0F0F0F0F0F0ULL) |
+           (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ^ 0x3333333333333333ULL;
+    d   = x & 0x0F0F0F0F0F0F0F0FULL;
+  }
+  else if (base == 8) {
+    bad = (x & 0xF8F8F8F8F8F8F8F8ULL) ^ 0x3030303030303030ULL;
+    d   = x & 0x0707070707070707ULL;
+  }
+  else {
+    uint64_t x7    = x & ~SWAR_HIGH;
+    uint64_t lower = x7 | (SWAR_ONES * 0x20);
+    uint64_t num   = __swar_ge(x7, '0') & ~__swar_ge(x7, '9' + 1);
+    uint64_t alpha = __swar_ge(lower, 'a') & ~__swar_ge(lower, 'f' + 1);
+
+    bad = ~((num | alpha) & ~x) & SWAR_HIGH;
+    d   = (x & 0x0F0F0F0F0F0F0F0FULL) + ((alpha >> 7) * 9);
+  }
+
+  k = bad ? (unsigned int)(__builtin_ctzll(bad) >> 3) : (unsigned int) SWAR_BYTES;
+  if (k == 0) {
+    *val = 0;
+    return 0;
+  }
+  // move the digits to the top, the missing leading digits become zero
+  if (k < SWAR_BYTES) {
+    d <<= (SWAR_BYTES - k) * 8;
+  }
+
+  // combine pairs of digits, then pairs of those, then the two halves
+  d = ((d * (1 + ((uint64_t) base << 8))) >> 8) & 0x00FF00FF00FF00FFULL;
+  d = ((d * (1 + ((uint64_t)(base * base) << 16))) >> 16) & 0x0000FFFF0000FFFFULL;
+  d = (d * (1 + ((uint64_t)(base * base * base * base) << 32))) >> 32;
+
+  *val = d;
+  return k;
+}
+#endif /* SWAR_ENABLED */
+
+#endif /* _SWAR_H_ */
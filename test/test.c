@@ -0,0 +1,1821 @@
+/**
+ * Differential tests of the number conversions against the host libc:
+ * strtod(), strtof() and strtold() on generated texts, the printf
+ * conversions, ms_dtoa() round trips and shortest output, and the
+ * 128-bit itoa functions against a plain reference. The dispatched
+ * string kernels of every tier the CPU has are checked against their
+ * portable versions, memmem() and strstr() against a naive search, the
+ * Aho-Corasick matcher against a brute-force match set, the hex and
+ * base64 codecs against a model of their contract, compiled print and
+ * scan formats against the interpreting snprintf() and sscanf(), and
+ * the memory, file, fd and callback sinks over several calls against
+ * snprintf().
+ *
+ * The library is linked statically, so its functions replace the libc
+ * ones for the whole program. The libc versions are looked up with
+ * dlsym(RTLD_NEXT, name), which skips the program and finds libc.
+ *
+ * Usage: ms_test [--quick] [--count <per test>] [--seed <n>] [--filter <name>]
+ *
+ * Results and the first failures of every test go to stderr, the exit
+ * status is 1 if any check failed.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <string.h>
+#include <printf.h>
+#include <scanf.h>
+#include <itoa.h>
+#include <dtoa.h>
+#include <charset.h>
+#include <codec.h>
+#include <dispatch.h>
+#include <ahocorasick.h>
+
+// Failures printed per test, the rest are only counted
+#define TEST_SHOW_FAILS (5)
+
+#define TEST_BUF_LEN (2048)
+
+//----------------------------------------------------------------------
+// Host libc versions
+
+static struct {
+  double (*strtod)(const char *, char **);
+  float (*strtof)(const char *, char **);
+  long double (*strtold)(const char *, char **);
+  int (*snprintf)(char *, size_t, const char *, ...);
+} libc;
+
+//----------------------------------------------------------------------
+// Inputs
+
+static uint64_t test_rand_state = 1;
+
+// xorshift64*, every bit is usable
+static uint64_t test_rand(void)
+{
+  test_rand_state ^= test_rand_state >> 12;
+  test_rand_state ^= test_rand_state << 25;
+  test_rand_state ^= test_rand_state >> 27;
+  return test_rand_state * 0x2545F4914F6CDD1Dull;
+}
+
+static unsigned int test_rand_n(unsigned int n)
+{
+  return (unsigned int)(test_rand() % n);
+}
+
+static double test_bits_double(uint64_t u)
+{
+  double v;
+
+  __builtin_memcpy(&v, &u, sizeof(v));
+  return v;
+}
+
+static uint64_t test_double_bits(double v)
+{
+  uint64_t u;
+
+  __builtin_memcpy(&u, &v, sizeof(u));
+  return u;
+}
+
+/**
+ * Random double, all bit patterns or values with few digits
+ */
+static double test_rand_double(int finite)
+{
+  double v;
+
+  switch (test_rand_n(4)) {
+  case 0:
+    // small integers and short decimal fractions
+    v = (double)(int64_t)(test_rand() % 2000001) - 1000000.0;
+    return test_rand_n(2) ? (v / 1000.0) : v;
+  case 1:
+    // near the ends of the range, subnormals included
+    v = test_bits_double(test_rand() & 0x801FFFFFFFFFFFFFull);
+    break;
+  default:
+    v = test_bits_double(test_rand());
+    break;
+  }
+  if (finite && ((test_double_bits(v) & 0x7FF0000000000000ull) == 0x7FF0000000000000ull)) {
+    v = 0.0;
+  }
+  return v;
+}
+
+static const char * const test_texts[] = {
+  "0", "-0", "+0", "0.0", ".0", "0.", ".", "-", "+", "", "e5", "1e", "1e+", "1e-x",
+  "  \t\n+1.5", "1.5x", "00000000000000000000001", "0.000000000000000000000001",
+  "inf", "-inf", "INF", "infinity", "-Infinity", "infin", "nan", "-nan", "NaN",
+  "nan()", "nan(123)", "nan(abc_1)", "nan(", "nan(x y)",
+  "0x", "0x.", "0xp1", "0x1p", "0x1.8p1", "0X1P-1074", "0x1p-1075", "0x1.fffffffffffff8p1023",
+  "0x.8", "0x1.000000000000080000000000001p0", "-0x0p0",
+  "1e308", "1.7976931348623157e308", "1.7976931348623158e308", "1.8e308", "1e309",
+  "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324",
+  "2.2250738585072011e-308", "2.2250738585072014e-308", "1e-400", "123456789012345678901234567890",
+  "9007199254740993", "9007199254740992.5", "9007199254740993.0000000000000000001",
+  "3.4028235e38", "3.4028236e38", "1.17549435e-38", "1.4e-45", "7e-46",
+  "1e-4950", "1.18973149535723176502e4932", "1.2e4932", "1e99999999999", "1e-99999999999",
+};
+
+/**
+ * Random text for strtod(), what libc prints, random digit strings,
+ * near double and float halfway points and hexadecimal
+ */
+static void test_rand_text(char *buf)
+{
+  char *p = buf;
+  unsigned int i;
+  unsigned int n;
+
+  switch (test_rand_n(9)) {
+  case 0:
+    __builtin_strcpy(buf, test_texts[test_rand_n(sizeof(test_texts) / sizeof(test_texts[0]))]);
+    return;
+  case 1:
+  case 2:
+    libc.snprintf(buf, TEST_BUF_LEN, test_rand_n(2) ? "%.*e" : "%.*g", (int) test_rand_n(26),
+                  test_rand_double(1));
+    return;
+  case 3: {
+    // close to the midpoint between two neighbouring doubles
+    double v = __builtin_fabs(test_rand_double(1));
+    double next = test_bits_double(test_double_bits(v) + 1);
+    long double mid = (long double) v + ((long double) next - v) / 2;
+
+    libc.snprintf(buf, TEST_BUF_LEN, "%.*Le", 16 + (int) test_rand_n(40), mid);
+    return;
+  }
+  case 4: {
+    // the same for floats
+    uint32_t b = (uint32_t) test_rand() & 0x7F7FFFFFu;
+    float f;
+    float next;
+
+    __builtin_memcpy(&f, &b, sizeof(f));
+    b++;
+    __builtin_memcpy(&next, &b, sizeof(next));
+    libc.snprintf(buf, TEST_BUF_LEN, "%.*e", 8 + (int) test_rand_n(30),
+                  (double) f + ((double) next - f) / 2);
+    return;
+  }
+  case 5:
+    libc.snprintf(buf, TEST_BUF_LEN, test_rand_n(2) ? "%a" : "%.*a", (int) test_rand_n(14),
+                  test_rand_double(1));
+    return;
+  default:
+    break;
+  }
+
+  // digits, point and exponent at random
+  if (test_rand_n(4) == 0) {
+    *p++ = test_rand_n(2) ? '-' : '+';
+  }
+  n = 1 + test_rand_n(test_rand_n(4) ? 20 : 800);
+  for (i = 0; i < n; i++) {
+    *p++ = (char)('0' + test_rand_n(10));
+    if (test_rand_n(n) == 0) {
+      *p++ = '.';
+      n = i + 1 + test_rand_n(40);
+    }
+  }
+  if (test_rand_n(2)) {
+    p += libc.snprintf(p, 16, "e%d", (int) test_rand_n(800) - 400);
+  }
+  *p = 0;
+}
+
+//----------------------------------------------------------------------
+// Checks
+
+struct test_opts {
+  unsigned long count;      // checks per test
+  const char *filter;       // run only the test of this name
+};
+
+struct test_case {
+  const char *name;
+  // one check, 0 if passed, else the failure written to msg
+  int (*check)(char *msg);
+  // run once before the checks, 0 to skip the test, may be NULL
+  int (*setup)(void);
+};
+
+static int test_streq(const char *a, const char *b)
+{
+  while (*a && (*a == *b)) {
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+static int test_strtod(char *msg)
+{
+  char text[TEST_BUF_LEN];
+  char *e_ms;
+  char *e_lc;
+  double ms;
+  double lc;
+
+  test_rand_text(text);
+  ms = strtod(text, &e_ms);
+  lc = libc.strtod(text, &e_lc);
+  if ((e_ms == e_lc) && ((ms != ms) ? (lc != lc) && (__builtin_signbit(ms) == __builtin_signbit(lc))
+                                    : (test_double_bits(ms) == test_double_bits(lc)))) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "\"%.200s\": %a +%td, libc %a +%td", text, ms, e_ms - text,
+                lc, e_lc - text);
+  return 1;
+}
+
+static int test_strtof(char *msg)
+{
+  char text[TEST_BUF_LEN];
+  char *e_ms;
+  char *e_lc;
+  float ms;
+  float lc;
+  uint32_t b_ms;
+  uint32_t b_lc;
+
+  test_rand_text(text);
+  ms = strtof(text, &e_ms);
+  lc = libc.strtof(text, &e_lc);
+  __builtin_memcpy(&b_ms, &ms, sizeof(ms));
+  __builtin_memcpy(&b_lc, &lc, sizeof(lc));
+  if ((e_ms == e_lc) && ((ms != ms) ? (lc != lc) && (__builtin_signbit(ms) == __builtin_signbit(lc))
+                                    : (b_ms == b_lc))) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "\"%.200s\": %a +%td, libc %a +%td", text, (double) ms,
+                e_ms - text, (double) lc, e_lc - text);
+  return 1;
+}
+
+static int test_strtold(char *msg)
+{
+  char text[TEST_BUF_LEN];
+  char *e_ms;
+  char *e_lc;
+  long double ms;
+  long double lc;
+
+  test_rand_text(text);
+  ms = strtold(text, &e_ms);
+  lc = libc.strtold(text, &e_lc);
+  if ((e_ms == e_lc) && (__builtin_signbit(ms) == __builtin_signbit(lc)) &&
+      ((ms != ms) ? (lc != lc) : (ms == lc))) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "\"%.200s\": %La +%td, libc %La +%td", text, ms, e_ms - text,
+                lc, e_lc - text);
+  return 1;
+}
+
+/**
+ * %f, %e, %g and %a with random flags, width and precision
+ */
+static int test_printf_float(char *msg)
+{
+  static const char convs[] = "feEgGaAF";
+  char fmt[32];
+  char out_ms[TEST_BUF_LEN];
+  char out_lc[TEST_BUF_LEN];
+  char *p = fmt;
+  double v = test_rand_double(0);
+  int r_ms;
+  int r_lc;
+
+  *p++ = '%';
+  switch (test_rand_n(4)) {
+  case 0: *p++ = '-'; break;
+  case 1: *p++ = '0'; break;
+  default: break;
+  }
+  if (test_rand_n(2)) {
+    p += libc.snprintf(p, 8, "%u", test_rand_n(40));
+  }
+  if (test_rand_n(4)) {
+    p += libc.snprintf(p, 8, ".%u", test_rand_n(test_rand_n(8) ? 20 : 400));
+  }
+  *p++ = convs[test_rand_n(sizeof(convs) - 1)];
+  *p = 0;
+
+  r_ms = snprintf(out_ms, sizeof(out_ms), fmt, v);
+  r_lc = libc.snprintf(out_lc, sizeof(out_lc), fmt, v);
+  if ((r_ms == r_lc) && test_streq(out_ms, out_lc)) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "%s of %a: \"%.200s\" %d, libc \"%.200s\" %d", fmt, v,
+                out_ms, r_ms, out_lc, r_lc);
+  return 1;
+}
+
+/**
+ * Integer and %s conversions with random flags, width and precision.
+ * '0' is not combined with '-' or %s, where pprint pads with zeros
+ * and libc with spaces.
+ */
+static int test_printf_int(char *msg)
+{
+  static const char * const convs[] = { "d", "i", "u", "x", "X", "lld", "llu", "llx", "hd", "hhu", "s" };
+  static const char * const strs[] = { "", "a", "abcdef", "0123456789abcdefghijklmnopqrstuvwxyz" };
+  char fmt[32];
+  char out_ms[TEST_BUF_LEN];
+  char out_lc[TEST_BUF_LEN];
+  char *p = fmt;
+  unsigned int c = test_rand_n(sizeof(convs) / sizeof(convs[0]));
+  unsigned int s = test_rand_n(sizeof(strs) / sizeof(strs[0]));
+  unsigned long long v = test_rand() >> test_rand_n(64);
+  int r_ms;
+  int r_lc;
+
+  v = test_rand_n(2) ? v : (0 - v);
+  *p++ = '%';
+  switch (test_rand_n(3)) {
+  case 0: *p++ = '-'; break;
+  case 1: *p++ = (convs[c][0] == 's') ? '-' : '0'; break;
+  default: break;
+  }
+  if (test_rand_n(2)) {
+    p += libc.snprintf(p, 8, "%u", test_rand_n(30));
+  }
+  if (test_rand_n(4)) {
+    p += libc.snprintf(p, 8, ".%u", test_rand_n(test_rand_n(8) ? 12 : 100));
+  }
+  p += libc.snprintf(p, 8, "%s", convs[c]);
+  *p = 0;
+
+  if (convs[c][0] == 's') {
+    r_ms = snprintf(out_ms, sizeof(out_ms), fmt, strs[s]);
+    r_lc = libc.snprintf(out_lc, sizeof(out_lc), fmt, strs[s]);
+  }
+  else if (convs[c][0] == 'l') {
+    r_ms = snprintf(out_ms, sizeof(out_ms), fmt, v);
+    r_lc = libc.snprintf(out_lc, sizeof(out_lc), fmt, v);
+  }
+  else {
+    r_ms = snprintf(out_ms, sizeof(out_ms), fmt, (int) v);
+    r_lc = libc.snprintf(out_lc, sizeof(out_lc), fmt, (int) v);
+  }
+  if ((r_ms == r_lc) && test_streq(out_ms, out_lc)) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "%s of %llx: \"%s\" %d, libc \"%s\" %d", fmt, v,
+                out_ms, r_ms, out_lc, r_lc);
+  return 1;
+}
+
+/**
+ * ms_dtoa() reads back as the same double, with the fewest digits that
+ * do so
+ */
+static int test_dtoa(char *msg)
+{
+  char out[MS_DTOA_LEN];
+  char lc[64];
+  double v = test_rand_double(1);
+  const char *p = out;
+  const char *first = NULL;
+  const char *last = NULL;
+  int digits = 0;
+  int shortest;
+
+  ms_dtoa(v, out);
+  if (test_double_bits(libc.strtod(out, NULL)) != test_double_bits(v)) {
+    libc.snprintf(msg, TEST_BUF_LEN, "%a: \"%s\" does not read back", v, out);
+    return 1;
+  }
+
+  // significant digits written
+  for (; *p && (*p != 'e'); p++) {
+    if ((*p >= '1') && (*p <= '9')) {
+      first = first ? first : p;
+      last = p;
+    }
+  }
+  for (p = first; p && (p <= last); p++) {
+    digits += (*p != '.');
+  }
+
+  for (shortest = 1; shortest < 17; shortest++) {
+    libc.snprintf(lc, sizeof(lc), "%.*e", shortest - 1, v);
+    if (test_double_bits(libc.strtod(lc, NULL)) == test_double_bits(v)) {
+      break;
+    }
+  }
+  if ((v == 0.0) || (digits == shortest)) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "%a: \"%s\" has %d digits, shortest is %d", v, out, digits,
+                shortest);
+  return 1;
+}
+
+#if MS_HAVE_INT128
+/**
+ * Reference conversion, one digit per division
+ */
+static void test_u128_ref(ms_u128 v, unsigned int base, int upper, char *buf)
+{
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char tmp[MS_U128TOA_LEN];
+  int n = 0;
+
+  do {
+    tmp[n++] = digits[v % base];
+    v /= base;
+  } while (v);
+  while (n) {
+    *buf++ = tmp[--n];
+  }
+  *buf = 0;
+}
+
+static ms_u128 test_rand_u128(void)
+{
+  ms_u128 v = ((ms_u128) test_rand() << 64) | test_rand();
+  unsigned int bits = test_rand_n(129);
+
+  // all magnitudes, and the extremes
+  v = (bits == 128) ? v : (bits == 0) ? 0 : (v & ((((ms_u128) 1) << bits) - 1));
+  return test_rand_n(32) ? v : (ms_u128) 0 - test_rand_n(2);
+}
+
+static int test_itoa128(char *msg)
+{
+  char out[MS_I128TOA_LEN];
+  char ref[MS_I128TOA_LEN];
+  ms_u128 u = test_rand_u128();
+  ms_i128 i = (ms_i128) u;
+  int upper = test_rand_n(2);
+  char *end;
+
+  end = ms_u128toa(u, out);
+  test_u128_ref(u, 10, 0, ref);
+  if (!test_streq(out, ref) || (*end != 0) || (end[-1] == 0)) {
+    goto fail;
+  }
+
+  end = ms_u128toa_hex(u, out, upper);
+  test_u128_ref(u, 16, upper, ref);
+  if (!test_streq(out, ref) || (*end != 0) || (end[-1] == 0)) {
+    goto fail;
+  }
+
+  end = ms_i128toa(i, out);
+  ref[0] = '-';
+  test_u128_ref((i < 0) ? (0 - u) : u, 10, 0, ref + (i < 0));
+  if (!test_streq(out, ref) || (*end != 0) || (end[-1] == 0)) {
+    goto fail;
+  }
+  return 0;
+
+fail:
+  libc.snprintf(msg, TEST_BUF_LEN, "%016llx%016llx: \"%s\", reference \"%s\"",
+                (unsigned long long)(u >> 64), (unsigned long long) u, out, ref);
+  return 1;
+}
+#endif
+
+//----------------------------------------------------------------------
+// Dispatched kernels of one tier against their portable versions
+
+// Test areas, each followed by an inaccessible page so a kernel reading
+// or writing past the end of its buffer faults
+#define TEST_PAGE       (4096)
+#define TEST_AREA_LEN   (3 * TEST_PAGE)
+#define TEST_AREAS      (3)
+
+#define TEST_SIGN(x)    (((x) > 0) - ((x) < 0))
+
+static unsigned char *test_areas[TEST_AREAS];
+static unsigned char test_save[TEST_AREA_LEN];
+static struct ms_string_ops test_ops;
+
+enum {
+  TEST_K_STRLEN, TEST_K_STRNLEN, TEST_K_MEMCHR, TEST_K_MEMRCHR, TEST_K_STRCHR,
+  TEST_K_STRCHRNUL, TEST_K_STRRCHR, TEST_K_STRCMP, TEST_K_STRNCMP, TEST_K_MEMMEM_SHORT,
+  TEST_K_SPAN_SET, TEST_K_SPAN_SET_N, TEST_K_SET_BITMAP, TEST_K_MEMCPY, TEST_K_MEMMOVE,
+  TEST_K_MEMSET, TEST_K_MEMCMP, TEST_K_STRNCASECMP, TEST_K_MEMCASECMP, TEST_K_MEMCASEMEM,
+  TEST_K_HEX_ENCODE, TEST_K_HEX_DECODE, TEST_K_BASE64_ENCODE, TEST_K_BASE64_DECODE,
+  TEST_KERNELS
+};
+
+static const char * const test_kernel_names[TEST_KERNELS] = {
+  "strlen", "strnlen", "memchr", "memrchr", "strchr",
+  "strchrnul", "strrchr", "strcmp", "strncmp", "memmem_short",
+  "span_set", "span_set_n", "set_bitmap", "memcpy", "memmove",
+  "memset", "memcmp", "strncasecmp", "memcasecmp", "memcasemem",
+  "hex_encode", "hex_decode", "base64_encode", "base64_decode",
+};
+
+/**
+ * Install the kernels of one tier over the portable ones
+ *
+ * @return 0 if the CPU lacks the tier
+ */
+static int test_tier_setup(int tier)
+{
+  int i;
+
+  for (i = 0; i < TEST_AREAS; i++) {
+    if (!test_areas[i]) {
+      unsigned char *m = (unsigned char *) mmap(NULL, TEST_AREA_LEN + TEST_PAGE,
+                                                PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      if ((m == MAP_FAILED) || mprotect(m + TEST_AREA_LEN, TEST_PAGE, PROT_NONE)) {
+        return 0;
+      }
+      test_areas[i] = m;
+    }
+  }
+  test_ops = __ms_string_ops_generic;
+  return __ms_dispatch_x86_tier(&test_ops, tier);
+}
+
+static int test_setup_sse2(void)
+{
+  return test_tier_setup(MS_TIER_SSE2);
+}
+
+static int test_setup_ssse3(void)
+{
+  return test_tier_setup(MS_TIER_SSSE3);
+}
+
+static int test_setup_avx2(void)
+{
+  return test_tier_setup(MS_TIER_AVX2);
+}
+
+/**
+ * Random length, mostly within a few vectors
+ */
+static size_t test_rand_len(void)
+{
+  return test_rand_n(4) ? test_rand_n(100) : test_rand_n(1200);
+}
+
+/**
+ * Place len bytes in an area, at a random alignment near its start or
+ * ending exactly at the inaccessible page
+ */
+static unsigned char *test_place(int area, size_t len)
+{
+  if (test_rand_n(2)) {
+    return test_areas[area] + TEST_AREA_LEN - len;
+  }
+  return test_areas[area] + test_rand_n(64);
+}
+
+/**
+ * Random bytes, half the time only a few letters so that matches and
+ * case variants are likely
+ */
+static void test_fill(unsigned char *p, size_t n, int nonzero)
+{
+  static const char few[] = "aAbB";
+  int narrow = test_rand_n(2);
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    p[i] = narrow ? (unsigned char) few[test_rand_n(4)] : (unsigned char) test_rand();
+    if (nonzero && !p[i]) {
+      p[i] = 'z';
+    }
+  }
+}
+
+/**
+ * Byte that often occurs in p, else any
+ */
+static int test_pick(const unsigned char *p, size_t n)
+{
+  return (n && test_rand_n(4)) ? p[test_rand_n((unsigned int) n)] : (int)(test_rand() & 0xFF);
+}
+
+/**
+ * Change at most one byte of p, and flip the case of letters if fold
+ */
+static void test_mutate(unsigned char *p, size_t n, int fold, int nonzero)
+{
+  size_t i;
+
+  if (fold) {
+    for (i = 0; i < n; i++) {
+      if ((((p[i] | 0x20) >= 'a') && ((p[i] | 0x20) <= 'z')) && test_rand_n(2)) {
+        p[i] ^= 0x20;
+      }
+    }
+  }
+  if (n && test_rand_n(2)) {
+    i = test_rand_n((unsigned int) n);
+    p[i] = (unsigned char) test_rand();
+    if (nonzero && !p[i]) {
+      p[i] = 0x80;
+    }
+  }
+}
+
+static long long test_off(const void *p, const void *base)
+{
+  return p ? (long long)((const unsigned char *) p - (const unsigned char *) base) : -1;
+}
+
+static int test_memeq(const unsigned char *a, const unsigned char *b, size_t n)
+{
+  size_t i;
+
+  for (i = 0; (i < n) && (a[i] == b[i]); i++) {
+  }
+  return i == n;
+}
+
+/**
+ * Run one random kernel call and its portable version on the same input
+ */
+static int test_kernels(char *msg)
+{
+  unsigned int k = test_rand_n(TEST_KERNELS);
+  size_t n = test_rand_len();
+  size_t m = 0;
+  size_t bad_ms = 0;
+  size_t bad_gen = 0;
+  long long r_ms = 0;
+  long long r_gen = 0;
+  int c = 0;
+  int same = 1;
+  unsigned char *a;
+  unsigned char *b;
+  unsigned char *d;
+  ms_charset set;
+
+  switch (k) {
+  case TEST_K_STRLEN:
+  case TEST_K_STRNLEN:
+  case TEST_K_STRCHR:
+  case TEST_K_STRCHRNUL:
+  case TEST_K_STRRCHR:
+    a = test_place(0, n + 1);
+    test_fill(a, n, 1);
+    a[n] = 0;
+    c = test_rand_n(8) ? test_pick(a, n) : 0;
+    m = test_rand_len();
+    if (k == TEST_K_STRLEN) {
+      r_ms  = (long long) test_ops.strlen((const char *) a);
+      r_gen = (long long) __ms_strlen_generic((const char *) a);
+    }
+    else if (k == TEST_K_STRNLEN) {
+      // max may stop inside the string, never reads past the terminator
+      r_ms  = (long long) test_ops.strnlen((const char *) a, m);
+      r_gen = (long long) __ms_strnlen_generic((const char *) a, m);
+    }
+    else if (k == TEST_K_STRCHR) {
+      r_ms  = test_off(test_ops.strchr((const char *) a, c), a);
+      r_gen = test_off(__ms_strchr_generic((const char *) a, c), a);
+    }
+    else if (k == TEST_K_STRCHRNUL) {
+      r_ms  = test_off(test_ops.strchrnul((const char *) a, c), a);
+      r_gen = test_off(__ms_strchrnul_generic((const char *) a, c), a);
+    }
+    else {
+      r_ms  = test_off(test_ops.strrchr((const char *) a, c), a);
+      r_gen = test_off(__ms_strrchr_generic((const char *) a, c), a);
+    }
+    break;
+
+  case TEST_K_MEMCHR:
+  case TEST_K_MEMRCHR:
+    a = test_place(0, n);
+    test_fill(a, n, 0);
+    c = test_pick(a, n);
+    if (k == TEST_K_MEMCHR) {
+      r_ms  = test_off(test_ops.memchr(a, c, n), a);
+      r_gen = test_off(__ms_memchr_generic(a, c, n), a);
+    }
+    else {
+      r_ms  = test_off(test_ops.memrchr(a, c, n), a);
+      r_gen = test_off(__ms_memrchr_generic(a, c, n), a);
+    }
+    break;
+
+  case TEST_K_STRCMP:
+  case TEST_K_STRNCMP:
+  case TEST_K_STRNCASECMP:
+    a = test_place(0, n + 1);
+    test_fill(a, n, 1);
+    a[n] = 0;
+    // the other string is a copy with a change, or of another length
+    m = test_rand_n(4) ? n : test_rand_len();
+    b = test_place(1, m + 1);
+    __builtin_memcpy(b, a, (m < n) ? m : n);
+    if (m > n) {
+      test_fill(b + n, m - n, 1);
+    }
+    b[m] = 0;
+    test_mutate(b, m, k == TEST_K_STRNCASECMP, 1);
+    m = test_rand_n(2) ? n : test_rand_len();
+    if (k == TEST_K_STRCMP) {
+      r_ms  = TEST_SIGN(test_ops.strcmp((const char *) a, (const char *) b));
+      r_gen = TEST_SIGN(__ms_strcmp_generic((const char *) a, (const char *) b));
+    }
+    else if (k == TEST_K_STRNCMP) {
+      r_ms  = TEST_SIGN(test_ops.strncmp((const char *) a, (const char *) b, m));
+      r_gen = TEST_SIGN(__ms_strncmp_generic((const char *) a, (const char *) b, m));
+    }
+    else {
+      r_ms  = TEST_SIGN(test_ops.strncasecmp((const char *) a, (const char *) b, m));
+      r_gen = TEST_SIGN(__ms_strncasecmp_generic((const char *) a, (const char *) b, m));
+    }
+    break;
+
+  case TEST_K_MEMCMP:
+  case TEST_K_MEMCASECMP:
+    a = test_place(0, n);
+    b = test_place(1, n);
+    test_fill(a, n, 0);
+    __builtin_memcpy(b, a, n);
+    test_mutate(b, n, k == TEST_K_MEMCASECMP, 0);
+    if (k == TEST_K_MEMCMP) {
+      r_ms  = TEST_SIGN(test_ops.memcmp(a, b, n));
+      r_gen = TEST_SIGN(__ms_memcmp_generic(a, b, n));
+    }
+    else {
+      r_ms  = TEST_SIGN(test_ops.memcasecmp(a, b, n));
+      r_gen = TEST_SIGN(__ms_memcasecmp_generic(a, b, n));
+    }
+    break;
+
+  case TEST_K_MEMMEM_SHORT:
+  case TEST_K_MEMCASEMEM:
+    // needle from the haystack, changed at times, at least 2 bytes for
+    // memmem_short and 1 for memcasemem
+    n += 2;
+    a = test_place(0, n);
+    test_fill(a, n, 0);
+    m = (k == TEST_K_MEMCASEMEM) ? 1 : 2;
+    m += test_rand_n((test_rand_n(2) && (n - m >= 4)) ? 4 : (unsigned int)(n - m + 1));
+    b = test_place(1, m);
+    __builtin_memcpy(b, a + test_rand_n((unsigned int)(n - m + 1)), m);
+    test_mutate(b, m, k == TEST_K_MEMCASEMEM, 0);
+    if (k == TEST_K_MEMMEM_SHORT) {
+      r_ms  = test_off(test_ops.memmem_short(a, n, b, m), a);
+      r_gen = test_off(__ms_memmem_short_generic(a, n, b, m), a);
+    }
+    else {
+      r_ms  = test_off(test_ops.memcasemem(a, n, b, m), a);
+      r_gen = test_off(__ms_memcasemem_generic(a, n, b, m), a);
+    }
+    break;
+
+  case TEST_K_SPAN_SET:
+  case TEST_K_SPAN_SET_N:
+  case TEST_K_SET_BITMAP: {
+    uint64_t bits_ms[1200 / 64 + 1];
+    uint64_t bits_gen[1200 / 64 + 1];
+    size_t words = (n + 63) / 64;
+    unsigned int i;
+
+    a = test_place(0, n + 1);
+    test_fill(a, n, k == TEST_K_SPAN_SET);
+    a[n] = 0;
+    // span_set() takes sets without the terminator, as from strspn()
+    ms_charset_init(&set, "");
+    for (i = test_rand_n(8); i > 0; i--) {
+      c = test_pick(a, n);
+      if (c || (k != TEST_K_SPAN_SET)) {
+        ms_charset_add(&set, c);
+      }
+    }
+    c = test_rand_n(2);
+    if (k == TEST_K_SPAN_SET) {
+      r_ms  = (long long) test_ops.span_set((const char *) a, &set, c);
+      r_gen = (long long) __ms_span_set_generic((const char *) a, &set, c);
+    }
+    else if (k == TEST_K_SPAN_SET_N) {
+      r_ms  = (long long) test_ops.span_set_n((const char *) a, n, &set, c);
+      r_gen = (long long) __ms_span_set_n_generic((const char *) a, n, &set, c);
+    }
+    else {
+      test_ops.set_bitmap((const char *) a, n, &set, bits_ms);
+      __ms_set_bitmap_generic((const char *) a, n, &set, bits_gen);
+      same = test_memeq((const unsigned char *) bits_ms, (const unsigned char *) bits_gen,
+                        words * sizeof(uint64_t));
+    }
+    break;
+  }
+
+  case TEST_K_MEMCPY:
+  case TEST_K_MEMSET:
+  case TEST_K_HEX_ENCODE:
+  case TEST_K_BASE64_ENCODE:
+    // the kernel writes to the area, the portable version to a copy
+    a = test_place(0, n);
+    test_fill(a, n, 0);
+    m = (k == TEST_K_HEX_ENCODE) ? MS_HEX_ENCODE_LEN(n) :
+        (k == TEST_K_BASE64_ENCODE) ? MS_BASE64_ENCODE_LEN(n) : n;
+    d = test_place(2, m);
+    test_fill(d, m, 0);
+    __builtin_memcpy(test_save, d, m);
+    c = test_pick(a, n);
+    if (k == TEST_K_MEMCPY) {
+      r_ms  = test_off(test_ops.memcpy(d, a, n), d);
+      r_gen = test_off(__ms_memcpy_generic(test_save, a, n), test_save);
+    }
+    else if (k == TEST_K_MEMSET) {
+      r_ms  = test_off(test_ops.memset(d, c, n), d);
+      r_gen = test_off(__ms_memset_generic(test_save, c, n), test_save);
+    }
+    else if (k == TEST_K_HEX_ENCODE) {
+      r_ms  = (long long) test_ops.hex_encode((char *) d, a, n, c & 1);
+      r_gen = (long long) __ms_hex_encode_generic((char *) test_save, a, n, c & 1);
+    }
+    else {
+      r_ms  = (long long) test_ops.base64_encode((char *) d, a, n);
+      r_gen = (long long) __ms_base64_encode_generic((char *) test_save, a, n);
+    }
+    same = test_memeq(d, test_save, m);
+    break;
+
+  case TEST_K_MEMMOVE: {
+    // source and destination overlapping in either direction, or not
+    size_t span = n + test_rand_n(80);
+    size_t src = test_rand_n((unsigned int)(span - n + 1));
+    size_t dst = test_rand_n((unsigned int)(span - n + 1));
+
+    d = test_place(2, span);
+    test_fill(d, span, 0);
+    __builtin_memcpy(test_save, d, span);
+    r_ms  = test_off(test_ops.memmove(d + dst, d + src, n), d);
+    r_gen = test_off(__ms_memmove_generic(test_save + dst, test_save + src, n), test_save);
+    same = test_memeq(d, test_save, span);
+    break;
+  }
+
+  case TEST_K_HEX_DECODE:
+  case TEST_K_BASE64_DECODE:
+    // valid text from the portable encoder, then a change at times
+    a = test_place(0, n);
+    test_fill(a, n, 0);
+    b = test_save;
+    if (k == TEST_K_HEX_DECODE) {
+      m = __ms_hex_encode_generic((char *) b, a, n, test_rand_n(2));
+      // mixed case, odd lengths
+      test_mutate(b, m, 1, 0);
+      m -= (m && test_rand_n(4) == 0);
+    }
+    else {
+      m = __ms_base64_encode_generic((char *) b, a, n);
+      // unpadded, junk after the padding
+      while (m && test_rand_n(2) && (b[m - 1] == '=')) {
+        m--;
+      }
+      if (test_rand_n(8) == 0) {
+        b[m++] = (unsigned char) "=A/"[test_rand_n(3)];
+      }
+      if (test_rand_n(4) == 0) {
+        test_mutate(b, m, 0, 0);
+      }
+    }
+    a = test_place(0, m);
+    __builtin_memcpy(a, b, m);
+    n = (k == TEST_K_HEX_DECODE) ? MS_HEX_DECODE_LEN(m) : MS_BASE64_DECODE_LEN(m);
+    d = test_place(2, n);
+    b = test_areas[1];
+    if (k == TEST_K_HEX_DECODE) {
+      r_ms  = (long long) test_ops.hex_decode(d, (const char *) a, m, &bad_ms);
+      r_gen = (long long) __ms_hex_decode_generic(b, (const char *) a, m, &bad_gen);
+    }
+    else {
+      r_ms  = (long long) test_ops.base64_decode(d, (const char *) a, m, &bad_ms);
+      r_gen = (long long) __ms_base64_decode_generic(b, (const char *) a, m, &bad_gen);
+    }
+    same = (bad_ms == bad_gen) && (r_ms == r_gen) && test_memeq(d, b, (size_t) r_gen);
+    n = m;
+    break;
+
+  default:
+    break;
+  }
+
+  if (same && (r_ms == r_gen)) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "%s length %zu, %zu: %lld, portable %lld%s",
+                test_kernel_names[k], n, m, r_ms, r_gen, same ? "" : ", output differs");
+  return 1;
+}
+
+//----------------------------------------------------------------------
+// Substring search against a naive reference
+
+#define TEST_HAY_LEN    (4096)
+#define TEST_NEEDLE_LEN (320)
+
+static const unsigned char *test_naive_memmem(const unsigned char *h, size_t hlen,
+                                              const unsigned char *n, size_t nlen)
+{
+  size_t i;
+
+  for (i = 0; i + nlen <= hlen; i++) {
+    if (test_memeq(h + i, n, nlen)) {
+      return h + i;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Needle and haystack over a small alphabet. Needles are random,
+ * periodic with a changed byte at times, or cut from the haystack.
+ * Haystacks repeat needle prefixes, so near matches are everywhere.
+ */
+static int test_memmem(char *msg)
+{
+  static unsigned char hay[TEST_HAY_LEN + 1];
+  static unsigned char needle[TEST_NEEDLE_LEN + 1];
+  const char *alpha = "abcd" + test_rand_n(3);
+  unsigned int nalpha = 1 + test_rand_n(4 - (unsigned int)(alpha - "abcd"));
+  size_t nlen = test_rand_n(4) ? test_rand_n(test_rand_n(2) ? 40 : TEST_NEEDLE_LEN) : 0;
+  size_t hlen = test_rand_n(test_rand_n(2) ? 200 : TEST_HAY_LEN);
+  size_t i;
+  long long r_ms;
+  long long r_ref;
+
+  // needle
+  switch (test_rand_n(2)) {
+  case 0:
+    for (i = 0; i < nlen; i++) {
+      needle[i] = (unsigned char) alpha[test_rand_n(nalpha)];
+    }
+    break;
+  default: {
+    // period p, like "abaabaaba" or "aaaaab"
+    size_t p = 1 + test_rand_n(8);
+
+    for (i = 0; i < nlen; i++) {
+      needle[i] = (i < p) ? (unsigned char) alpha[test_rand_n(nalpha)] : needle[i - p];
+    }
+    if (nlen && test_rand_n(2)) {
+      needle[test_rand_n(2) ? (nlen - 1) : test_rand_n((unsigned int) nlen)] = 'e';
+    }
+    break;
+  }
+  }
+
+  // haystack, prefixes of the needle and noise
+  for (i = 0; i < hlen;) {
+    if (nlen && test_rand_n(4)) {
+      // often almost the whole needle, which periodic needles overlap
+      size_t k = test_rand_n(2) ? (nlen - test_rand_n((nlen < 8) ? (unsigned int) nlen : 8)) :
+                                  (1 + test_rand_n((unsigned int) nlen));
+
+      k = (k < hlen - i) ? k : (hlen - i);
+      __builtin_memcpy(hay + i, needle, k);
+      i += k;
+    }
+    else {
+      hay[i++] = (unsigned char) alpha[test_rand_n(nalpha)];
+    }
+  }
+  if (nlen && (nlen <= hlen) && test_rand_n(2)) {
+    __builtin_memcpy(hay + test_rand_n((unsigned int)(hlen - nlen + 1)), needle, nlen);
+  }
+  if (test_rand_n(3) == 0) {
+    // needle from the haystack, possibly longer than what is left
+    size_t at = hlen ? test_rand_n((unsigned int) hlen) : 0;
+
+    nlen = (nlen < hlen - at) ? nlen : (hlen - at);
+    __builtin_memcpy(needle, hay + at, nlen);
+  }
+
+  r_ms  = test_off(memmem(hay, hlen, needle, nlen), hay);
+  r_ref = test_off(test_naive_memmem(hay, hlen, needle, nlen), hay);
+  if (r_ms != r_ref) {
+    libc.snprintf(msg, TEST_BUF_LEN, "memmem hay %zu \"%.100s\" needle %zu \"%.100s\": %lld, "
+                  "naive %lld", hlen, hay, nlen, needle, r_ms, r_ref);
+    return 1;
+  }
+
+  // the same as strings
+  hay[hlen] = 0;
+  needle[nlen] = 0;
+  r_ms = test_off(strstr((const char *) hay, (const char *) needle), hay);
+  if (r_ms != r_ref) {
+    libc.snprintf(msg, TEST_BUF_LEN, "strstr hay %zu \"%.100s\" needle %zu \"%.100s\": %lld, "
+                  "naive %lld", hlen, hay, nlen, needle, r_ms, r_ref);
+    return 1;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------
+// Aho-Corasick matches against every keyword tried at every offset
+
+#define TEST_AC_PATTERNS (40)
+#define TEST_AC_PAT_LEN  (8)
+#define TEST_AC_HAY_LEN  (2000)
+
+struct test_ac_ctx {
+  size_t count;             // keywords
+  size_t calls;
+  size_t stop;              // stop at this many matches, 0 never
+  size_t last_end;          // end of the last match reported
+  int ordered;              // 0 once a match came out of end order
+  // reports per offset and keyword
+  unsigned char seen[TEST_AC_HAY_LEN * TEST_AC_PATTERNS];
+};
+
+static size_t test_ac_lens[TEST_AC_PATTERNS];
+
+static int test_ac_match(void *ctx, size_t pattern_id, size_t offset)
+{
+  struct test_ac_ctx *c = (struct test_ac_ctx *) ctx;
+  size_t end = offset + test_ac_lens[pattern_id];
+
+  c->ordered &= (end >= c->last_end);
+  c->last_end = end;
+  c->seen[(offset * c->count) + pattern_id]++;
+  return ++c->calls == c->stop;
+}
+
+/**
+ * Keyword byte, over a few letters or more than 16 of them, and at
+ * times zero if the keywords have lengths
+ */
+static char test_ac_byte(unsigned int nalpha, int terminated)
+{
+  if (!terminated && (test_rand_n(16) == 0)) {
+    return 0;
+  }
+  return (char)('a' + test_rand_n(nalpha));
+}
+
+/**
+ * Random keyword lists with repeats and empty keywords. Alphabets of
+ * more than 16 letters turn the first byte prefilter off. At times the
+ * callback stops the search early, then exactly the matches ending
+ * before the last one reported must have been reported.
+ */
+static int test_ac(char *msg)
+{
+  static char pats[TEST_AC_PATTERNS][TEST_AC_PAT_LEN + 1];
+  static unsigned char hay[TEST_AC_HAY_LEN];
+  static struct test_ac_ctx c;
+  const char *ptrs[TEST_AC_PATTERNS];
+  unsigned int nalpha = test_rand_n(2) ? (2 + test_rand_n(3)) : (8 + test_rand_n(40));
+  int terminated = (test_rand_n(4) == 0);
+  int with_cb = (test_rand_n(8) != 0);
+  size_t count = 1 + test_rand_n(test_rand_n(4) ? 12 : TEST_AC_PATTERNS);
+  size_t hlen = test_rand_n(test_rand_n(8) ? 200 : TEST_AC_HAY_LEN);
+  size_t expected = 0;
+  size_t found;
+  size_t i;
+  size_t j;
+  int stopped;
+  ms_ac *ac;
+
+  for (i = 0; i < count; i++) {
+    if (i && (test_rand_n(8) == 0)) {
+      // the same keyword again
+      j = test_rand_n((unsigned int) i);
+      __builtin_memcpy(pats[i], pats[j], sizeof(pats[i]));
+      test_ac_lens[i] = test_ac_lens[j];
+    }
+    else {
+      test_ac_lens[i] = test_rand_n(16) ? (1 + test_rand_n(test_rand_n(2) ? 3 : TEST_AC_PAT_LEN)) : 0;
+      for (j = 0; j < test_ac_lens[i]; j++) {
+        pats[i][j] = test_ac_byte(nalpha, terminated);
+      }
+      pats[i][j] = 0;
+    }
+    ptrs[i] = pats[i];
+  }
+
+  // haystack with keywords planted in it
+  for (i = 0; i < hlen;) {
+    j = test_rand_n((unsigned int) count);
+    if (test_rand_n(4) == 0) {
+      size_t k = (test_ac_lens[j] < hlen - i) ? test_ac_lens[j] : (hlen - i);
+
+      __builtin_memcpy(hay + i, pats[j], k);
+      i += k;
+    }
+    else {
+      hay[i++] = (unsigned char) test_ac_byte(nalpha, terminated);
+    }
+  }
+
+  ac = ms_ac_create(ptrs, terminated ? NULL : test_ac_lens, count);
+  if (!ac) {
+    libc.snprintf(msg, TEST_BUF_LEN, "ms_ac_create() of %zu keywords failed", count);
+    return 1;
+  }
+  __builtin_memset(c.seen, 0, hlen * count);
+  c.count = count;
+  c.calls = 0;
+  c.stop = test_rand_n(4) ? 0 : (1 + test_rand_n(8));
+  c.last_end = 0;
+  c.ordered = 1;
+  found = ms_ac_search(ac, (const char *) hay, hlen, with_cb ? test_ac_match : NULL, &c);
+  ms_ac_destroy(ac);
+  stopped = with_cb && c.stop && (c.calls == c.stop);
+
+  // every keyword at every offset, the reports are cleared on the way
+  for (i = 0; i < hlen; i++) {
+    for (j = 0; j < count; j++) {
+      size_t end = i + test_ac_lens[j];
+      unsigned char *seen = &c.seen[(i * count) + j];
+
+      if (!test_ac_lens[j] || (end > hlen) || !test_memeq(hay + i, (const unsigned char *) pats[j],
+                                                         test_ac_lens[j])) {
+        continue;
+      }
+      expected++;
+      if (!with_cb) {
+        continue;
+      }
+      if ((*seen > 1) || ((*seen == 0) && (!stopped || (end < c.last_end))) ||
+          ((*seen == 1) && stopped && (end > c.last_end))) {
+        libc.snprintf(msg, TEST_BUF_LEN, "%zu keywords, haystack %zu: keyword %zu \"%s\" at %zu "
+                      "reported %u times%s", count, hlen, j, pats[j], i, *seen,
+                      stopped ? " before the stop" : "");
+        return 1;
+      }
+      *seen = 0;
+    }
+  }
+  for (i = 0; with_cb && (i < hlen * count); i++) {
+    if (c.seen[i]) {
+      libc.snprintf(msg, TEST_BUF_LEN, "%zu keywords, haystack %zu: keyword %zu \"%s\" at %zu "
+                    "reported, but not there", count, hlen, i % count, pats[i % count], i / count);
+      return 1;
+    }
+  }
+  if ((with_cb && ((found != c.calls) || !c.ordered)) || (!stopped && (found != expected))) {
+    libc.snprintf(msg, TEST_BUF_LEN, "%zu keywords, haystack %zu: %zu found, %zu reported, %zu "
+                  "expected%s", count, hlen, found, c.calls, expected,
+                  c.ordered ? "" : ", out of end order");
+    return 1;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------
+// Hex and base64 round trips, and where decoding stops on bad input
+
+#define TEST_CODEC_LEN (300)
+
+static const char test_b64_chars[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int test_is_hex(unsigned char c)
+{
+  return ((c >= '0') && (c <= '9')) || (((c | 0x20) >= 'a') && ((c | 0x20) <= 'f'));
+}
+
+static int test_is_b64(unsigned char c)
+{
+  size_t i;
+
+  for (i = 0; (i < 64) && (test_b64_chars[i] != c); i++) {
+  }
+  return i < 64;
+}
+
+/**
+ * Reference base64 encoder, six bits at a time
+ */
+static size_t test_b64_encode(char *dst, const unsigned char *src, size_t n)
+{
+  size_t bits = 8 * n;
+  size_t i;
+  size_t o = 0;
+
+  for (i = 0; i < bits; i += 6) {
+    unsigned int v = 0;
+    size_t b;
+
+    for (b = i; b < i + 6; b++) {
+      v = (v << 1) | ((b < bits) ? ((src[b / 8] >> (7 - (b % 8))) & 1) : 0);
+    }
+    dst[o++] = test_b64_chars[v];
+  }
+  while (o % 4) {
+    dst[o++] = '=';
+  }
+  return o;
+}
+
+/**
+ * Where base64 decoding must stop, and the bytes decoded before it: all
+ * whole groups, a padded final group, or an unpadded tail of 2 or 3
+ * characters. A group with a bad character is not decoded.
+ */
+static size_t test_b64_model(const char *t, size_t n, size_t *bad)
+{
+  const unsigned char *s = (const unsigned char *) t;
+  size_t j;
+  size_t i;
+  size_t k;
+
+  for (j = 0; (j < n) && test_is_b64(s[j]); j++) {
+  }
+  i = j - (j % 4);
+  k = j - i;
+  if (j == n) {
+    // no bad character, a tail of one is less than a byte
+    *bad = (k == 1) ? i : n;
+    return (3 * (i / 4)) + (k ? (k - 1) : 0);
+  }
+  if ((s[j] == '=') && (i + 4 <= n) && (k >= 2) && ((k == 3) || (s[i + 3] == '='))) {
+    *bad = (i + 4 < n) ? (i + 4) : n;
+    return (3 * (i / 4)) + k - 1;
+  }
+  *bad = ((s[j] == '=') && (k == 2) && (i + 4 <= n)) ? (i + 3) : j;
+  return 3 * (i / 4);
+}
+
+/**
+ * Encode random bytes, change the text at times, and decode it again
+ */
+static int test_codec(char *msg)
+{
+  static const char junk[] = "!-_ .\n=\x80\xff";
+  static unsigned char data[TEST_CODEC_LEN];
+  unsigned char out[TEST_CODEC_LEN + 4];
+  char text[MS_HEX_ENCODE_LEN(TEST_CODEC_LEN) + 4];
+  char ref[MS_HEX_ENCODE_LEN(TEST_CODEC_LEN) + 4];
+  size_t n = test_rand_n(test_rand_n(4) ? 40 : TEST_CODEC_LEN);
+  int upper = test_rand_n(2);
+  size_t len;
+  size_t want;
+  size_t got;
+  size_t bad;
+  size_t bad_ref;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    data[i] = (unsigned char) test_rand();
+  }
+
+  // hex, both cases, a bad digit or an odd length
+  len = ms_hex_encode(text, data, n, upper);
+  for (i = 0; i < n; i++) {
+    libc.snprintf(ref + (2 * i), 3, upper ? "%02X" : "%02x", data[i]);
+  }
+  if ((len != 2 * n) || !test_memeq((const unsigned char *) text, (const unsigned char *) ref, len)) {
+    libc.snprintf(msg, TEST_BUF_LEN, "hex encode of %zu bytes: \"%.*s\"", n, (int) len, text);
+    return 1;
+  }
+  for (i = 0; i < len; i++) {
+    if ((text[i] > '9') && test_rand_n(2)) {
+      text[i] ^= 0x20;
+    }
+  }
+  switch (test_rand_n(4)) {
+  case 0:
+    if (len) {
+      text[test_rand_n((unsigned int) len)] = junk[test_rand_n(sizeof(junk) - 1)];
+    }
+    break;
+  case 1:
+    len -= (len > 0);
+    break;
+  default:
+    break;
+  }
+  for (bad_ref = 0; (bad_ref < len) && test_is_hex((unsigned char) text[bad_ref]); bad_ref++) {
+  }
+  bad_ref = (bad_ref < (len & ~(size_t) 1)) ? bad_ref : (len & ~(size_t) 1);
+  got = ms_hex_decode(out, text, len, &bad);
+  if ((got != bad_ref / 2) || (bad != bad_ref) || !test_memeq(out, data, got) ||
+      (ms_hex_decode(out, text, len, NULL) != got)) {
+    libc.snprintf(msg, TEST_BUF_LEN, "hex decode \"%.*s\": %zu bytes bad %zu, expected %zu bad %zu",
+                  (int) len, text, got, bad, bad_ref / 2, bad_ref);
+    return 1;
+  }
+
+  // base64, unpadded, data after the padding, a bad character, cut short
+  len = ms_base64_encode(text, data, n);
+  want = test_b64_encode(ref, data, n);
+  if ((len != want) || (len != MS_BASE64_ENCODE_LEN(n)) ||
+      !test_memeq((const unsigned char *) text, (const unsigned char *) ref, len)) {
+    libc.snprintf(msg, TEST_BUF_LEN, "base64 encode of %zu bytes: \"%.*s\"", n, (int) len, text);
+    return 1;
+  }
+  switch (test_rand_n(6)) {
+  case 0:
+    while (len && (text[len - 1] == '=')) {
+      len--;
+    }
+    break;
+  case 1:
+    text[len++] = test_rand_n(2) ? '=' : test_b64_chars[test_rand_n(64)];
+    break;
+  case 2:
+    if (len) {
+      text[test_rand_n((unsigned int) len)] = junk[test_rand_n(sizeof(junk) - 1)];
+    }
+    break;
+  case 3:
+    len = test_rand_n((unsigned int) len + 1);
+    break;
+  default:
+    break;
+  }
+  want = test_b64_model(text, len, &bad_ref);
+  got = ms_base64_decode(out, text, len, &bad);
+  if ((got != want) || (bad != bad_ref) || !test_memeq(out, data, (got < n) ? got : n) ||
+      (ms_base64_decode(out, text, len, NULL) != got)) {
+    libc.snprintf(msg, TEST_BUF_LEN, "base64 decode \"%.*s\": %zu bytes bad %zu, expected %zu "
+                  "bad %zu", (int) len, text, got, bad, want, bad_ref);
+    return 1;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------
+// Compiled formats against the interpreting snprintf() and sscanf()
+
+#define TEST_CF_PIECES (8)
+#define TEST_CF_LEN    (256)
+
+static const char * const test_cf_strs[] = { "", "a", "abcdef", "0123456789abcdefghijklmnopqrstuvwxyz" };
+
+// literal run of 1 to 6 characters, never '%'
+static char *test_cf_lit(char *p, const char *chars)
+{
+  unsigned int n = 1 + test_rand_n(6);
+
+  while (n--) {
+    *p++ = chars[test_rand_n((unsigned int) __builtin_strlen(chars))];
+  }
+  return p;
+}
+
+/**
+ * Conversion taking an int, or a string if str. '0' is not combined
+ * with '-', %s or %c, and %c has no precision, where libc differs.
+ */
+static char *test_cf_conv(char *p, int str)
+{
+  static const char * const ints[] = { "d", "i", "u", "x", "X", "hd", "hhu", "c" };
+  const char *conv = str ? "s" : ints[test_rand_n(sizeof(ints) / sizeof(ints[0]))];
+  int plain = str || (*conv == 'c');
+
+  *p++ = '%';
+  switch (test_rand_n(3)) {
+  case 0: *p++ = '-'; break;
+  case 1: *p++ = plain ? '-' : '0'; break;
+  default: break;
+  }
+  if (test_rand_n(2)) {
+    p += libc.snprintf(p, 8, "%u", test_rand_n(20));
+  }
+  if ((*conv != 'c') && !test_rand_n(3)) {
+    p += libc.snprintf(p, 8, ".%u", test_rand_n(12));
+  }
+  return p + libc.snprintf(p, 8, "%s", conv);
+}
+
+/**
+ * ms_fmt_compile() against the format run through snprintf(), and
+ * against libc unless the format ends in a lone '%'. Conversions
+ * alternate int and string arguments, with literal runs and "%%"
+ * between them to be joined.
+ */
+static int test_fmt_compiled(char *msg)
+{
+  char format[TEST_BUF_LEN];
+  char out_ms[TEST_BUF_LEN];
+  char out_rt[TEST_BUF_LEN];
+  char out_lc[TEST_BUF_LEN];
+  const char *s[3];
+  int v[3];
+  char *p = format;
+  int nconv = 0;
+  int trailing = !test_rand_n(8);
+  unsigned int pieces = test_rand_n(TEST_CF_PIECES + 1);
+  size_t size;
+  ms_sink sink;
+  ms_fmt *fmt;
+  int r_ms;
+  int r_rt;
+  int r_lc;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    v[i] = (int)(test_rand() >> test_rand_n(64));
+    s[i] = test_cf_strs[test_rand_n(sizeof(test_cf_strs) / sizeof(test_cf_strs[0]))];
+  }
+  while (pieces--) {
+    switch (test_rand_n(4)) {
+    case 0:  p = test_cf_lit(p, "ab :-9."); break;
+    case 1:  p += libc.snprintf(p, 8, "%s", test_rand_n(2) ? "%%" : "%%%%"); break;
+    default:
+      if (nconv < 6) {
+        p = test_cf_conv(p, nconv++ & 1);
+      }
+      break;
+    }
+  }
+  if (trailing) {
+    *p++ = '%';
+  }
+  *p = 0;
+
+  fmt = ms_fmt_compile(format);
+  size = test_rand_n(4) ? sizeof(out_ms) : test_rand_n(40);
+  __builtin_memset(out_ms, 0x55, sizeof(out_ms));
+  __builtin_memset(out_rt, 0x55, sizeof(out_rt));
+  ms_sink_buf(&sink, size ? out_ms : NULL, size);
+  r_ms = fmt ? ms_fmt_print(fmt, &sink, v[0], s[0], v[1], s[1], v[2], s[2]) : -2;
+  r_rt = snprintf(size ? out_rt : NULL, size, format, v[0], s[0], v[1], s[1], v[2], s[2]);
+  r_lc = trailing ? r_rt :
+         libc.snprintf(out_lc, sizeof(out_lc), format, v[0], s[0], v[1], s[1], v[2], s[2]);
+  ms_fmt_destroy(fmt);
+
+  // %c may write a zero, compare bytes
+  if ((r_ms == r_rt) && (r_ms == r_lc) &&
+      test_memeq((const unsigned char *) out_ms, (const unsigned char *) out_rt, sizeof(out_ms)) &&
+      (trailing || !size || test_memeq((const unsigned char *) out_ms, (const unsigned char *) out_lc,
+                                       ((size_t) r_ms < size) ? (size_t) r_ms : (size - 1)))) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "\"%s\" size %zu: \"%.*s\" %d, snprintf \"%.*s\" %d, libc %d",
+                format, size, size ? r_ms : 0, out_ms, r_ms, size ? r_rt : 0, out_rt, r_rt, r_lc);
+  return 1;
+}
+
+/**
+ * ms_scan_compile() against the format run through sscanf(), on text
+ * that mostly matches. Conversions alternate int and char buffer
+ * arguments, "%*" skips take none.
+ */
+static int test_scan_compiled(char *msg)
+{
+  static const char * const ints[] = { "%d", "%i", "%u", "%x", "%3d", "%n" };
+  static const char * const strs[] = { "%s", "%5s", "%:s", "%c", "%3c" };
+  char format[TEST_BUF_LEN];
+  char text[TEST_BUF_LEN];
+  char b_ms[3][TEST_CF_LEN];
+  char b_rt[3][TEST_CF_LEN];
+  int v_ms[3];
+  int v_rt[3];
+  char *f = format;
+  char *t = text;
+  int nconv = 0;
+  unsigned int pieces = test_rand_n(TEST_CF_PIECES + 1);
+  ms_scan *scan;
+  int r_ms;
+  int r_rt;
+  int i;
+
+  while (pieces--) {
+    char *lit = f;
+
+    switch (test_rand_n(6)) {
+    case 0:
+      f = test_cf_lit(f, "ab:;");
+      __builtin_memcpy(t, lit, (size_t)(f - lit));
+      t += f - lit;
+      break;
+    case 1:
+      f += libc.snprintf(f, 8, "%s", test_rand_n(2) ? " " : " \t");
+      t += libc.snprintf(t, 8, "%.*s", (int) test_rand_n(3), "  ");
+      break;
+    case 2:
+      f += libc.snprintf(f, 8, "%%%%");
+      *t++ = '%';
+      break;
+    case 3:
+      // a skip runs to white space in the format, and in the text
+      f += libc.snprintf(f, 8, "%%*d ");
+      t += libc.snprintf(t, 8, "zz ");
+      break;
+    default:
+      if (nconv >= 6) {
+        break;
+      }
+      if (nconv++ & 1) {
+        f += libc.snprintf(f, 8, "%s", strs[test_rand_n(sizeof(strs) / sizeof(strs[0]))]);
+        t = test_cf_lit(t, "xy:;");
+      } else {
+        f += libc.snprintf(f, 8, "%s", ints[test_rand_n(sizeof(ints) / sizeof(ints[0]))]);
+        t += libc.snprintf(t, 16, test_rand_n(4) ? "%d" : "%#x", (int)(test_rand() >> test_rand_n(64)));
+      }
+      break;
+    }
+  }
+  if (!test_rand_n(8)) {
+    *f++ = '%';
+  }
+  *f = 0;
+  *t = 0;
+  switch (test_rand_n(4)) {
+  case 0:
+    if (t != text) {
+      text[test_rand_n((unsigned int)(t - text))] = "a:% 7"[test_rand_n(5)];
+    }
+    break;
+  case 1:
+    text[test_rand_n((unsigned int)(t - text) + 1)] = 0;
+    break;
+  default:
+    break;
+  }
+
+  __builtin_memset(b_ms, 0x55, sizeof(b_ms));
+  __builtin_memset(b_rt, 0x55, sizeof(b_rt));
+  for (i = 0; i < 3; i++) {
+    v_ms[i] = v_rt[i] = -7;
+  }
+  scan = ms_scan_compile(format);
+  r_ms = scan ? ms_scan_read(scan, text, &v_ms[0], b_ms[0], &v_ms[1], b_ms[1], &v_ms[2], b_ms[2]) : -2;
+  r_rt = sscanf(text, format, &v_rt[0], b_rt[0], &v_rt[1], b_rt[1], &v_rt[2], b_rt[2]);
+  ms_scan_destroy(scan);
+
+  if ((r_ms == r_rt) && test_memeq((const unsigned char *) v_ms, (const unsigned char *) v_rt, sizeof(v_ms)) &&
+      test_memeq((const unsigned char *) b_ms, (const unsigned char *) b_rt, sizeof(b_ms))) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "\"%s\" on \"%s\": %d %d %d %d, sscanf %d %d %d %d", format, text,
+                r_ms, v_ms[0], v_ms[1], v_ms[2], r_rt, v_rt[0], v_rt[1], v_rt[2]);
+  return 1;
+}
+
+//----------------------------------------------------------------------
+// Sinks, several ms_print() calls to one sink against libc snprintf()
+
+#define TEST_SINK_CALLS (4)
+#define TEST_SINK_LEN   (4 * TEST_BUF_LEN * TEST_SINK_CALLS)
+
+enum { TEST_SINK_MEM, TEST_SINK_BUF, TEST_SINK_FILE, TEST_SINK_FD, TEST_SINK_FN, TEST_SINK_KINDS };
+
+static const char * const test_sink_names[TEST_SINK_KINDS] = {
+  "mem", "buf", "file", "fd", "callback"
+};
+
+// the file sink writes to one temporary file, the fd sink to another
+static FILE *test_sink_fp;
+static FILE *test_sink_fd_fp;
+
+struct test_sink_ctx {
+  char *out;
+  size_t n;
+  size_t limit;     // fail the span that would pass this many bytes
+  int call;         // ms_print() call in progress
+  int failed;       // call during which the callback failed, -1 if none
+  int late;         // spans handed over after the failure
+  int empty;        // empty spans
+};
+
+static int test_sink_fn(void *ctx, const char *s, size_t n)
+{
+  struct test_sink_ctx *c = ctx;
+
+  if (c->failed >= 0) {
+    c->late++;
+    return -1;
+  }
+  c->empty += (n == 0);
+  if (c->n + n > c->limit) {
+    c->failed = c->call;
+    return -1;
+  }
+  __builtin_memcpy(c->out + c->n, s, n);
+  c->n += n;
+  return 0;
+}
+
+static int test_sink_setup(void)
+{
+  test_sink_fp    = tmpfile();
+  test_sink_fd_fp = tmpfile();
+  return test_sink_fp && test_sink_fd_fp;
+}
+
+// read back and empty a temporary file
+static size_t test_sink_drain(FILE *fp, char *out, size_t size)
+{
+  ssize_t n;
+
+  fflush(fp);
+  n = pread(fileno(fp), out, size, 0);
+  if (ftruncate(fileno(fp), 0) != 0) {
+    n = -1;
+  }
+  fseek(fp, 0, SEEK_SET);
+  return (n < 0) ? 0 : (size_t) n;
+}
+
+/**
+ * Up to TEST_SINK_CALLS ms_print() calls to one sink of random kind.
+ * Strings and padding longer than MS_SINK_STAGE take the bypass, the
+ * callback may fail part way, the bounded buffer may be short.
+ */
+static int test_sinks(char *msg)
+{
+  static char str[3 * MS_SINK_STAGE + 1];
+  static char out[TEST_SINK_LEN];
+  static char ref[TEST_SINK_LEN];
+  struct test_sink_ctx ctx = { out, 0, SIZE_MAX, 0, -1, 0, 0 };
+  int kind = (int) test_rand_n(TEST_SINK_KINDS);
+  int calls = 1 + (int) test_rand_n(TEST_SINK_CALLS);
+  int r_ms[TEST_SINK_CALLS];
+  int r_lc[TEST_SINK_CALLS];
+  size_t ends[TEST_SINK_CALLS];
+  char fmt[32];
+  size_t len = 0;
+  size_t size = 0;
+  size_t got = 0;
+  ms_sink sink;
+  int ok = 1;
+  int i;
+
+  switch (kind) {
+  case TEST_SINK_MEM:  ms_sink_mem(&sink, out); break;
+  case TEST_SINK_FILE: ms_sink_file(&sink, test_sink_fp); break;
+  case TEST_SINK_FD:   ms_sink_fd(&sink, fileno(test_sink_fd_fp)); break;
+  case TEST_SINK_FN:
+    ctx.limit = test_rand_n(2) ? SIZE_MAX : test_rand_n(3 * TEST_BUF_LEN);
+    ms_sink_callback(&sink, test_sink_fn, &ctx);
+    break;
+  default:
+    // the size is picked once the whole text is known
+    break;
+  }
+  if (kind == TEST_SINK_BUF) {
+    size = test_rand_n(8) ? test_rand_n(TEST_SINK_LEN) : 0;
+    ms_sink_buf(&sink, size ? out : NULL, size);
+  }
+
+  for (i = 0; i < calls; i++) {
+    size_t n = test_rand_n(4) ? test_rand_n(40) : test_rand_n(sizeof(str));
+    unsigned int width = test_rand_n(4) ? test_rand_n(20) : test_rand_n(3 * MS_SINK_STAGE);
+    int d = (int) test_rand();
+
+    // no '*' widths, the padding goes in the format
+    libc.snprintf(fmt, sizeof(fmt), "%%s|%%d|%%%us", width);
+    __builtin_memset(str, 'a' + i, n);
+    str[n] = 0;
+    ctx.call = i;
+    r_ms[i] = ms_print(&sink, fmt, str, d, "x");
+    r_lc[i] = libc.snprintf(ref + len, TEST_SINK_LEN - len, fmt, str, d, "x");
+    len += (size_t) r_lc[i];
+    ends[i] = len;
+  }
+
+  switch (kind) {
+  case TEST_SINK_MEM:
+    got = len;
+    ok = (out[len] == 0);
+    break;
+  case TEST_SINK_BUF:
+    got = (size && (len >= size)) ? (size - 1) : (size ? len : 0);
+    ok = !size || (out[got] == 0);
+    break;
+  case TEST_SINK_FILE: got = test_sink_drain(test_sink_fp, out, TEST_SINK_LEN); break;
+  case TEST_SINK_FD:   got = test_sink_drain(test_sink_fd_fp, out, TEST_SINK_LEN); break;
+  default:             got = ctx.n; break;
+  }
+
+  // every call up to a failure returns its length, all from there -1
+  for (i = 0; i < calls; i++) {
+    int failed = (ctx.failed >= 0) && (i >= ctx.failed);
+    ok &= (r_ms[i] == (failed ? -1 : r_lc[i]));
+  }
+  ok &= !ctx.late && !ctx.empty && (sink.error == (ctx.failed >= 0));
+  if (ctx.failed < 0) {
+    ok &= (kind == TEST_SINK_BUF) || (got == len);
+  } else {
+    // the calls before the failure were flushed whole
+    ok &= (got <= ctx.limit) && (got >= (ctx.failed ? ends[ctx.failed - 1] : 0));
+  }
+  ok &= test_memeq((const unsigned char *) out, (const unsigned char *) ref, (got < len) ? got : len);
+  if (ok) {
+    return 0;
+  }
+  libc.snprintf(msg, TEST_BUF_LEN, "%s sink, %d calls, %zu bytes, size %zu limit %zu: got %zu, "
+                "failed in call %d, error %d, %d late and %d empty spans, returned %d, libc %d",
+                test_sink_names[kind], calls, len, size, ctx.limit, got, ctx.failed, sink.error,
+                ctx.late, ctx.empty, r_ms[0], r_lc[0]);
+  return 1;
+}
+
+static const struct test_case test_cases[] = {
+  { "strtod",       test_strtod,       NULL },
+  { "strtof",       test_strtof,       NULL },
+  { "strtold",      test_strtold,      NULL },
+  { "printf_float", test_printf_float, NULL },
+  { "printf_int",   test_printf_int,   NULL },
+  { "dtoa",         test_dtoa,         NULL },
+#if MS_HAVE_INT128
+  { "itoa128",      test_itoa128,      NULL },
+#endif
+  { "memmem",        test_memmem,      NULL },
+  { "ahocorasick",   test_ac,          NULL },
+  { "codec",         test_codec,       NULL },
+  { "fmt_compiled",  test_fmt_compiled, NULL },
+  { "scan_compiled", test_scan_compiled, NULL },
+  { "sinks",         test_sinks,       test_sink_setup },
+  { "kernels_sse2",  test_kernels,     test_setup_sse2 },
+  { "kernels_ssse3", test_kernels,     test_setup_ssse3 },
+  { "kernels_avx2",  test_kernels,     test_setup_avx2 },
+};
+
+//----------------------------------------------------------------------
+static int test_arg_is(const char *arg, const char *name)
+{
+  return test_streq(arg, name);
+}
+
+static unsigned long test_arg_num(const char *arg)
+{
+  unsigned long n = 0;
+
+  for (; (*arg >= '0') && (*arg <= '9'); arg++) {
+    n = (n * 10) + (unsigned long)(*arg - '0');
+  }
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  struct test_opts o = { 1000000, NULL };
+  char msg[TEST_BUF_LEN];
+  unsigned long failed_all = 0;
+  size_t i;
+  int k;
+
+  for (k = 1; k < argc; k++) {
+    if (test_arg_is(argv[k], "--quick")) {
+      o.count = 100000;
+    }
+    else if (test_arg_is(argv[k], "--count") && (k + 1 < argc)) {
+      o.count = test_arg_num(argv[++k]);
+    }
+    else if (test_arg_is(argv[k], "--seed") && (k + 1 < argc)) {
+      test_rand_state = test_arg_num(argv[++k]) | 1;
+    }
+    else if (test_arg_is(argv[k], "--filter") && (k + 1 < argc)) {
+      o.filter = argv[++k];
+    }
+    else {
+      fprintf(stderr, "usage: %s [--quick] [--count <per test>] [--seed <n>] "
+              "[--filter <name>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  libc.strtod   = (double (*)(const char *, char **)) dlsym(RTLD_NEXT, "strtod");
+  libc.strtof   = (float (*)(const char *, char **)) dlsym(RTLD_NEXT, "strtof");
+  libc.strtold  = (long double (*)(const char *, char **)) dlsym(RTLD_NEXT, "strtold");
+  libc.snprintf = (int (*)(char *, size_t, const char *, ...)) dlsym(RTLD_NEXT, "snprintf");
+  if (!libc.strtod || !libc.strtof || !libc.strtold || !libc.snprintf) {
+    fprintf(stderr, "host libc functions not found\n");
+    return 1;
+  }
+
+  for (i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); i++) {
+    const struct test_case *tc = &test_cases[i];
+    unsigned long failed = 0;
+    unsigned long n;
+
+    if (o.filter && !test_arg_is(o.filter, tc->name)) {
+      continue;
+    }
+    if (tc->setup && !tc->setup()) {
+      fprintf(stderr, "%-14s skipped, not supported here\n", tc->name);
+      continue;
+    }
+    for (n = 0; n < o.count; n++) {
+      if (tc->check(msg)) {
+        if (failed++ < TEST_SHOW_FAILS) {
+          fprintf(stderr, "%-14s FAIL %s\n", tc->name, msg);
+        }
+      }
+    }
+    fprintf(stderr, "%-14s %10lu checks %10lu failed\n", tc->name, o.count, failed);
+    failed_all += failed;
+  }
+  return failed_all ? 1 : 0;
+}
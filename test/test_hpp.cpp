@@ -0,0 +1,326 @@
+/**
+ * Tests of printf.hpp against the runtime formatter: every format below
+ * is run through ms::sprint() and ms::snprint() with MS_FMT(), and in
+ * C++20 through ms::print<"..."> to a callback sink, on random arguments,
+ * and compared with snprintf() of the library on the same format. The
+ * snprint() sizes include 0, where the sink only measures.
+ *
+ * Built as C++17 and as C++20. With TEST_HPP_PROBE=<n> defined, the file
+ * instead holds one argument mismatch that must not compile; the
+ * makefile checks that each probe is rejected.
+ *
+ * Usage: ms_test_hpp [--quick] [--count <rounds>] [--seed <n>]
+ *
+ * Results and the first failures go to stderr, the exit status is 1 if
+ * any check failed.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdarg>
+#include <cstdio>
+
+#include <printf.hpp>
+
+// Failures printed, the rest are only counted
+#define TEST_SHOW_FAILS (5)
+
+#define TEST_BUF_LEN (4096)
+
+#if __cplusplus >= 202002L
+#define TEST_NAME "printf_hpp20"
+#else
+#define TEST_NAME "printf_hpp17"
+#endif
+
+//----------------------------------------------------------------------
+// Inputs
+
+static std::uint64_t test_rand_state = 1;
+
+// xorshift64*, every bit is usable
+static std::uint64_t test_rand()
+{
+  test_rand_state ^= test_rand_state >> 12;
+  test_rand_state ^= test_rand_state << 25;
+  test_rand_state ^= test_rand_state >> 27;
+  return test_rand_state * 0x2545F4914F6CDD1Dull;
+}
+
+static unsigned int test_rand_n(unsigned int n)
+{
+  return (unsigned int)((test_rand() >> 32) % n);
+}
+
+// small, large and all-bits values alike
+static std::uint64_t test_rand_int()
+{
+  return test_rand() >> test_rand_n(64);
+}
+
+static double test_rand_double()
+{
+  static const double scales[] = { 1e-300, 1e-9, 1e-3, 1, 7, 1e6, 1e22, 1e300 };
+  double v = (double)(test_rand() >> 11) / (double)(1ull << 53);
+
+  v *= scales[test_rand_n(sizeof(scales) / sizeof(scales[0]))];
+  return test_rand_n(2) ? v : -v;
+}
+
+static const char * const test_strs[] = {
+  "", "a", "key", "abcdef", "0123456789abcdefghijklmnopqrstuvwxyz", nullptr
+};
+
+//----------------------------------------------------------------------
+// Checks
+
+static unsigned long test_checks;
+static unsigned long test_failed;
+
+static int test_memeq(const char *a, const char *b, std::size_t n)
+{
+  std::size_t i;
+
+  for (i = 0; (i < n) && (a[i] == b[i]); i++) {
+  }
+  return i == n;
+}
+
+// the runtime formatter, through a va_list so that the format is not
+// checked by the compiler against printf() of the host
+static int test_rt(char *out, std::size_t size, const char *fmt, ...)
+{
+  va_list args;
+  int ret;
+
+  va_start(args, fmt);
+  ret = vsnprintf(out, size, fmt, args);
+  va_end(args);
+  return ret;
+}
+
+/**
+ * Compare one output, n bytes of it
+ */
+static void test_check(const char *fmt, const char *form, std::size_t size, int r, const char *out,
+                       int r_rt, const char *out_rt, std::size_t n)
+{
+  test_checks++;
+  if ((r == r_rt) && test_memeq(out, out_rt, n)) {
+    return;
+  }
+  if (test_failed++ < TEST_SHOW_FAILS) {
+    std::fprintf(stderr, "%-14s FAIL \"%s\" %s size %zu: \"%.*s\" %d, snprintf \"%.*s\" %d\n",
+                 TEST_NAME, fmt, form, size, (int) n, out, r, (int) n, out_rt, r_rt);
+  }
+}
+
+// bytes both outputs must have, the terminator included
+static std::size_t test_span(int r, std::size_t size)
+{
+  if (!size) {
+    return 0;
+  }
+  return (((std::size_t) r < size) ? (std::size_t) r : (size - 1)) + 1;
+}
+
+// 0 to measure only, short to cut the text, or the whole buffer
+static std::size_t test_size()
+{
+  switch (test_rand_n(4)) {
+  case 0:  return 0;
+  case 1:  return 1 + test_rand_n(40);
+  default: return TEST_BUF_LEN;
+  }
+}
+
+#if __cplusplus >= 202002L
+// callback sink collecting the text
+struct test_collect {
+  char buf[TEST_BUF_LEN];
+  std::size_t n;
+};
+
+static int test_collect_fn(void *ctx, const char *s, std::size_t n)
+{
+  test_collect *c = (test_collect *) ctx;
+
+  if (c->n + n >= sizeof(c->buf)) {
+    return -1;
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    c->buf[c->n + i] = s[i];
+  }
+  c->n += n;
+  return 0;
+}
+
+#define TEST_PRINT20(f, ...)                                                   \
+  do {                                                                         \
+    static test_collect collect;                                               \
+    ms_sink sink;                                                              \
+                                                                               \
+    collect.n = 0;                                                             \
+    ms_sink_callback(&sink, test_collect_fn, &collect);                        \
+    r = ms::print<f>(&sink, __VA_ARGS__);                                      \
+    test_check(f, "print<>", 0, r, collect.buf, r_rt, out_rt,                  \
+               (r == r_rt) ? collect.n : 0);                                   \
+  } while (0)
+#else
+#define TEST_PRINT20(f, ...)
+#endif
+
+// one format, every form of the call against the runtime formatter
+#define TEST_FMT(f, ...)                                                       \
+  do {                                                                         \
+    static char out[TEST_BUF_LEN];                                             \
+    static char out_rt[TEST_BUF_LEN];                                          \
+    std::size_t size = test_size();                                            \
+    int r_rt = test_rt(out_rt, sizeof(out_rt), f, __VA_ARGS__);                \
+    int r = ms::sprint(out, MS_FMT(f), __VA_ARGS__);                           \
+                                                                               \
+    test_check(f, "sprint", 0, r, out, r_rt, out_rt, test_span(r_rt, sizeof(out))); \
+    TEST_PRINT20(f, __VA_ARGS__);                                              \
+    r_rt = test_rt(size ? out_rt : nullptr, size, f, __VA_ARGS__);             \
+    r = ms::snprint(size ? out : nullptr, size, MS_FMT(f), __VA_ARGS__);       \
+    test_check(f, "snprint", size, r, out, r_rt, out_rt, test_span(r_rt, size)); \
+  } while (0)
+
+/**
+ * All formats on one set of random arguments
+ */
+static void test_round()
+{
+  const int i = (int) test_rand_int();
+  const int j = (int) test_rand_int();
+  const unsigned int u = (unsigned int) test_rand_int();
+  const long l = (long) test_rand_int();
+  const unsigned long ul = (unsigned long) test_rand_int();
+  const long long ll = (long long) test_rand_int();
+  const unsigned long long ull = test_rand_int();
+  const signed char sc = (signed char) test_rand();
+  const short sh = (short) test_rand();
+  const std::size_t z = (std::size_t) test_rand_int();
+  const std::ptrdiff_t pd = (std::ptrdiff_t) test_rand_int();
+  const std::intmax_t im = (std::intmax_t) test_rand_int();
+  const char c = (char)(' ' + test_rand_n(95));
+  const char *s = test_strs[test_rand_n(sizeof(test_strs) / sizeof(test_strs[0]))];
+  const char *s2 = test_strs[test_rand_n(sizeof(test_strs) / sizeof(test_strs[0]) - 1)];
+  const void *p = test_rand_n(4) ? (const void *)(std::uintptr_t) test_rand_int() : nullptr;
+  const double d = test_rand_double();
+  const double d2 = test_rand_double();
+  const long double ld = (long double) test_rand_double();
+
+  TEST_FMT("[%-12s|%08d|%6x]", s, i, u);
+  TEST_FMT("%d %i %u %x %X", i, j, u, u, u);
+  TEST_FMT("%ld %lu %lx %lld %llu %llX", l, ul, ul, ll, ull, ull);
+  TEST_FMT("%zu %zd %jd %td", z, pd, im, pd);
+  // narrowed from int, and in their own types
+  TEST_FMT("%hhd %hhu %hd %hu %hhx %hX", i, j, i, j, sc, sh);
+  TEST_FMT("%-08d|%05d|%-5d|%5d|%0d", i, j, i & 255, -(i & 255), j);
+  TEST_FMT("%.5d|%.0d|%8.3d|%-8.3d|%08.3d|%.12lld|%.3hhd|%.0x", i, i & 1, j, i, -(j & 99), ll, sc, u & 1);
+  TEST_FMT("%s|%10s|%-10s|%.3s|%10.2s|%.0s|", s, s2, s, s2, s, s2);
+  TEST_FMT("%c|%3c|%-3c|%03c|", c, c, c, c);
+  TEST_FMT("%p %20p %-20p|", p, p, p);
+  TEST_FMT("%f %.3f %10.2e %-10g|%G %08.3f", d, d2, d, d2, d, d2);
+  TEST_FMT("%a %.2A %e %Lf", d, d2, d2, ld);
+  TEST_FMT("100%% %d%%%%", i);
+  TEST_FMT("a literal run longer than thirty-two bytes, %d, and another one after it", i);
+  // spans and padding longer than the stage of the callback sink
+  TEST_FMT("%600d|%-700s|%.600d", i, s2, j);
+#if MS_HAVE_INT128
+  {
+    const ms_i128 q = (ms_i128)(((ms_u128) test_rand() << 64) | test_rand()) >> test_rand_n(128);
+    const ms_u128 uq = (ms_u128) q;
+
+    TEST_FMT("%I128d %I128u %I128x %050I128d %.45I128d|%42.40I128X", q, uq, uq, q, q, uq);
+  }
+#endif
+}
+
+//----------------------------------------------------------------------
+#ifdef TEST_HPP_PROBE
+// Mismatches that must not compile, one per build
+static int test_probe(char *buf)
+{
+#if TEST_HPP_PROBE == 1
+  return ms::sprint(buf, MS_FMT("%d"), "text");      // string for an integer
+#elif TEST_HPP_PROBE == 2
+  return ms::sprint(buf, MS_FMT("%s"), 1);           // integer for a string
+#elif TEST_HPP_PROBE == 3
+  return ms::sprint(buf, MS_FMT("%d %d"), 1);        // too few arguments
+#elif TEST_HPP_PROBE == 4
+  return ms::sprint(buf, MS_FMT("%d"), 1, 2);        // too many arguments
+#elif TEST_HPP_PROBE == 5
+  return ms::sprint(buf, MS_FMT("%d"), 1LL << 40);   // wider than the conversion
+#elif TEST_HPP_PROBE == 6
+  return ms::sprint(buf, MS_FMT("%hhd"), 1L);        // wider than int for hh
+#elif TEST_HPP_PROBE == 7
+  return ms::sprint(buf, MS_FMT("%d"), true);        // bool for an integer
+#elif TEST_HPP_PROBE == 8
+  return ms::sprint(buf, MS_FMT("%c"), false);       // bool for a character
+#elif TEST_HPP_PROBE == 9
+  return ms::sprint(buf, MS_FMT("%f"), 1);           // integer for a double
+#elif TEST_HPP_PROBE == 10
+  return ms::sprint(buf, MS_FMT("%f"), 1.0L);        // long double without L
+#elif TEST_HPP_PROBE == 11
+  return ms::sprint(buf, MS_FMT("%p"), 1);           // integer for a pointer
+#elif TEST_HPP_PROBE == 12
+  return ms::sprint(buf, MS_FMT("%q"), 1);           // unsupported conversion
+#elif TEST_HPP_PROBE == 13
+  return ms::sprint(buf, MS_FMT("%ls"), "text");     // length modifier on %s
+#elif TEST_HPP_PROBE == 14
+  return ms::sprint<"%d">(buf, "text");              // C++20 form, string for an integer
+#else
+  return 0;
+#endif
+}
+#endif
+
+static int test_arg_is(const char *arg, const char *name)
+{
+  while (*arg && (*arg == *name)) {
+    arg++;
+    name++;
+  }
+  return *arg == *name;
+}
+
+static unsigned long test_arg_num(const char *arg)
+{
+  unsigned long n = 0;
+
+  for (; (*arg >= '0') && (*arg <= '9'); arg++) {
+    n = (n * 10) + (unsigned long)(*arg - '0');
+  }
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long rounds = 20000;
+  unsigned long n;
+  int k;
+
+  for (k = 1; k < argc; k++) {
+    if (test_arg_is(argv[k], "--quick")) {
+      rounds = 2000;
+    }
+    else if (test_arg_is(argv[k], "--count") && (k + 1 < argc)) {
+      rounds = test_arg_num(argv[++k]);
+    }
+    else if (test_arg_is(argv[k], "--seed") && (k + 1 < argc)) {
+      test_rand_state = test_arg_num(argv[++k]) | 1;
+    }
+    else {
+      std::fprintf(stderr, "usage: %s [--quick] [--count <rounds>] [--seed <n>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  for (n = 0; n < rounds; n++) {
+    test_round();
+  }
+  std::fprintf(stderr, "%-14s %10lu checks %10lu failed\n", TEST_NAME, test_checks, test_failed);
+  return test_failed ? 1 : 0;
+}